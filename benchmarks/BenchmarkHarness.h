@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Minimal self-registering benchmark runner, so benchmarks build with nothing but the standard library.
+// Every benchmark is a function registered with BENCHMARK, timing one or more variants with Measure
+namespace Benchmarks
+{
+
+struct Benchmark
+{
+	const char* m_name;
+	void (*m_function)();
+};
+
+std::vector<Benchmark>& GetBenchmarks();
+
+// Results are folded into it, so the compiler can't drop the measured work
+extern volatile uint64_t sink;
+
+// Runs the operation in batches and reports the fastest batch, per operation - it must return something
+// derived from its work. A batch is warmed up first, so caches and branch predictors are primed
+template<typename Operation>
+void Measure( const char* name, uint32_t operationsPerBatch, Operation&& operation )
+{
+	constexpr uint32_t NUM_BATCHES = 15;
+
+	uint64_t result = 0;
+	for ( uint32_t i = 0; i < operationsPerBatch; i++ )
+	{
+		result += static_cast<uint64_t>(operation());
+	}
+
+	double bestNanoseconds = 0.0;
+	for ( uint32_t batch = 0; batch < NUM_BATCHES; batch++ )
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for ( uint32_t i = 0; i < operationsPerBatch; i++ )
+		{
+			result += static_cast<uint64_t>(operation());
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+		const double nanoseconds = elapsed.count() / operationsPerBatch;
+		if ( batch == 0 || nanoseconds < bestNanoseconds )
+		{
+			bestNanoseconds = nanoseconds;
+		}
+	}
+	sink = sink + result;
+
+	printf( "  %-48s %10.2f ns\n", name, bestNanoseconds );
+}
+
+struct BenchmarkRegistrar
+{
+	BenchmarkRegistrar( const char* name, void (*function)() )
+	{
+		GetBenchmarks().push_back( { name, function } );
+	}
+};
+
+};
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static const Benchmarks::BenchmarkRegistrar name##Registrar( #name, &name ); \
+	static void name()
@@ -0,0 +1,28 @@
+#include "BenchmarkHarness.h"
+
+#include <cstring>
+
+volatile uint64_t Benchmarks::sink = 0;
+
+std::vector<Benchmarks::Benchmark>& Benchmarks::GetBenchmarks()
+{
+	// Function local, so registrars in other translation units never see it uninitialized
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+// Runs all benchmarks, or only those with names containing the first argument.
+// Only meaningful in optimized builds
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+
+	for ( const Benchmarks::Benchmark& benchmark : Benchmarks::GetBenchmarks() )
+	{
+		if ( filter != nullptr && strstr( benchmark.m_name, filter ) == nullptr ) continue;
+
+		printf( "%s\n", benchmark.m_name );
+		benchmark.m_function();
+	}
+	return 0;
+}
@@ -0,0 +1,116 @@
+#include "BenchmarkHarness.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <utility>
+
+#include "../source/effects/ShaderHashTable.h"
+
+using namespace Effects;
+
+namespace
+{
+
+constexpr size_t NUM_BUILT_IN = 10; // As many as AnnotatePixelShader knows about
+constexpr size_t NUM_ADDED = 256; // A generous shader manifest
+constexpr size_t NUM_QUERIES = 4096;
+
+ShaderHash RandomHash( std::mt19937& random )
+{
+	ShaderHash hash;
+	for ( uint32_t& word : hash.m_words )
+	{
+		word = random();
+	}
+	return hash;
+}
+
+// The table AnnotatePixelShader used to scan, checked with std::equal against the checksum in the bytecode
+struct LinearTable
+{
+	std::vector<std::pair<std::array<uint32_t, 4>, uint32_t>> m_entries;
+
+	void Add( const ShaderHash& hash, uint32_t value )
+	{
+		m_entries.push_back( { { hash.m_words[0], hash.m_words[1], hash.m_words[2], hash.m_words[3] }, value } );
+	}
+
+	uint32_t Find( const uint32_t* hash ) const
+	{
+		for ( const auto& entry : m_entries )
+		{
+			if ( std::equal( entry.first.begin(), entry.first.end(), hash ) ) return entry.second;
+		}
+		return 0;
+	}
+};
+
+struct Tables
+{
+	std::array<ShaderHashEntry<uint32_t>, NUM_BUILT_IN> m_builtIn;
+	ShaderHashTable<uint32_t> m_table { m_builtIn };
+	LinearTable m_linear;
+	std::vector<ShaderHash> m_queries;
+
+	// Most shaders the game creates are not interesting, so only one in eight queries hits
+	explicit Tables( size_t numAdded )
+	{
+		std::mt19937 random( 1234 );
+
+		std::vector<ShaderHash> known;
+		for ( size_t i = 0; i < NUM_BUILT_IN; i++ )
+		{
+			m_builtIn[i] = { RandomHash( random ), static_cast<uint32_t>(i + 1) };
+			known.push_back( m_builtIn[i].m_hash );
+		}
+		std::sort( m_builtIn.begin(), m_builtIn.end(), [](const auto& left, const auto& right) { return left.m_hash < right.m_hash; } );
+		for ( const auto& entry : m_builtIn )
+		{
+			m_linear.Add( entry.m_hash, entry.m_value );
+		}
+
+		for ( size_t i = 0; i < numAdded; i++ )
+		{
+			const ShaderHash hash = RandomHash( random );
+			m_table.Add( hash, static_cast<uint32_t>(NUM_BUILT_IN + i + 1) );
+			m_linear.Add( hash, static_cast<uint32_t>(NUM_BUILT_IN + i + 1) );
+			known.push_back( hash );
+		}
+
+		for ( size_t i = 0; i < NUM_QUERIES; i++ )
+		{
+			m_queries.push_back( i % 8 == 0 ? known[random() % known.size()] : RandomHash( random ) );
+		}
+	}
+};
+
+void CompareLookups( const Tables& tables, const char* linearName, const char* tableName )
+{
+	size_t linearQuery = 0;
+	Benchmarks::Measure( linearName, 1 << 20, [&] {
+		const ShaderHash& hash = tables.m_queries[linearQuery++ % NUM_QUERIES];
+		return tables.m_linear.Find( hash.m_words );
+	});
+
+	size_t tableQuery = 0;
+	Benchmarks::Measure( tableName, 1 << 20, [&] {
+		const ShaderHash& hash = tables.m_queries[tableQuery++ % NUM_QUERIES];
+		const uint32_t* value = tables.m_table.Find( hash );
+		return value != nullptr ? *value : 0;
+	});
+}
+
+}
+
+BENCHMARK(ShaderHashTable_BuiltInLookup)
+{
+	const Tables tables( 0 );
+	CompareLookups( tables, "Linear scan, 10 entries", "ShaderHashTable, 10 entries" );
+}
+
+BENCHMARK(ShaderHashTable_ExtendedLookup)
+{
+	const Tables tables( NUM_ADDED );
+	CompareLookups( tables, "Linear scan, 10 + 256 entries", "ShaderHashTable, 10 built-in + 256 added" );
+}
@@ -0,0 +1,84 @@
+#include "BenchmarkHarness.h"
+
+// Thunks patch vtables with generated x86/x64 code, so they can only be measured on Windows
+#if defined(_WIN32)
+
+#include <Windows.h>
+
+#include "../source/VtableThunks.h"
+
+#if VTABLE_THUNKS
+
+namespace
+{
+
+// COM-style interface, so thunks see the same calling convention as on the wrapped D3D11 interfaces
+struct ICounter
+{
+	virtual uint32_t STDMETHODCALLTYPE Add( uint32_t value ) = 0;
+};
+
+struct Counter final : ICounter
+{
+	uint32_t m_value = 0;
+
+	uint32_t STDMETHODCALLTYPE Add( uint32_t value ) override
+	{
+		m_value += value;
+		return m_value;
+	}
+};
+
+// A class per variant, as patching affects every object of the class
+template<int Variant>
+struct ForwardingWrapper final : ICounter
+{
+	ICounter* m_orig;
+
+	explicit ForwardingWrapper( ICounter* orig )
+		: m_orig( orig )
+	{
+	}
+
+	uint32_t STDMETHODCALLTYPE Add( uint32_t value ) override
+	{
+		return m_orig->Add( value );
+	}
+};
+
+// Read through a volatile pointer on every call, so the compiler can't devirtualize it
+ICounter* volatile target;
+
+void MeasureCalls( const char* name, ICounter* counter )
+{
+	target = counter;
+	Benchmarks::Measure( name, 1 << 22, [] {
+		ICounter* counter = target;
+		return counter->Add( 1 );
+	});
+}
+
+}
+
+BENCHMARK(VtableThunks_ForwardedCall)
+{
+	Counter counter;
+	MeasureCalls( "Direct call", &counter );
+
+	ForwardingWrapper<0> wrapper( &counter );
+	MeasureCalls( "Through a forwarding wrapper", &wrapper );
+
+	ForwardingWrapper<1> thunkedWrapper( &counter );
+	ICounter* thunkedInterface = &thunkedWrapper;
+	const uint16_t slots[] = { 0 };
+	if ( !VtableThunks::PatchForwardingSlots( thunkedInterface, reinterpret_cast<char*>(&thunkedWrapper.m_orig) - reinterpret_cast<char*>(thunkedInterface), slots ) )
+	{
+		printf( "  Patching the vtable failed\n" );
+		return;
+	}
+	MeasureCalls( "Through a thunked wrapper", thunkedInterface );
+}
+
+#endif
+
+#endif
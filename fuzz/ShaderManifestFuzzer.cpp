@@ -0,0 +1,50 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#include "../source/effects/ShaderManifest.h"
+
+using namespace Effects;
+
+// Manifests are written by hand, so any text must parse into entries which are safe to bind
+static void Check( bool condition )
+{
+	if ( !condition ) abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t* data, size_t size )
+{
+	const std::string_view text( reinterpret_cast<const char*>(data), size );
+
+	ShaderManifest manifest;
+	manifest.Parse( text );
+
+	const auto& constantBuffers = manifest.GetConstantBuffers();
+	const auto& values = manifest.GetValues();
+	for ( const ShaderManifestEntry& entry : manifest.GetEntries() )
+	{
+		Check( !entry.m_shaderPath.empty() );
+		Check( entry.m_shaderPath.data() >= text.data() && entry.m_shaderPath.data() + entry.m_shaderPath.size() <= text.data() + text.size() );
+
+		Check( entry.m_firstConstantBuffer + entry.m_numConstantBuffers <= constantBuffers.size() );
+		for ( uint32_t i = entry.m_firstConstantBuffer; i < entry.m_firstConstantBuffer + entry.m_numConstantBuffers; i++ )
+		{
+			const ShaderManifestEntry::ConstantBuffer& cb = constantBuffers[i];
+			Check( cb.m_slot < ShadowState::NUM_CONSTANT_BUFFERS );
+			Check( cb.m_size != 0 && cb.m_size % 16 == 0 && cb.m_size <= ShaderManifest::MAX_CONSTANT_BUFFER_SIZE );
+			Check( cb.m_numValues * sizeof(float) <= cb.m_size );
+			Check( size_t(cb.m_firstValue) + cb.m_numValues <= values.size() );
+		}
+
+		for ( int8_t sourceSlot : entry.m_shaderResourceRemap )
+		{
+			Check( sourceSlot == ShaderManifestEntry::KEEP_SLOT || (sourceSlot >= 0 && uint32_t(sourceSlot) < ShadowState::NUM_SHADER_RESOURCES) );
+		}
+
+		// Later sections with the same checksum take precedence, but whichever is found must have it
+		const ShaderManifestEntry* found = manifest.Find( entry.m_hash );
+		Check( found != nullptr && found->m_hash == entry.m_hash );
+	}
+	return 0;
+}
@@ -1,3 +1,8 @@
+newoption {
+	trigger = "no-vtable-thunks",
+	description = "Forward unhooked D3D11 methods through the wrapper implementations instead of vtable thunks"
+}
+
 workspace "DXHRDC-GFX"
 	platforms { "Win32" }
 
@@ -9,6 +14,42 @@ project "DXHRDC-GFX"
 	include "source/VersionInfo.lua"
 	files { "**/MemoryMgr.h", "**/Patterns.*", "**/HookInit.hpp" }
 
+	files { "source/*.h", "source/*.cpp", "source/resources/*.rc", "source/wil/*", "source/*.def",
+ 			"source/effects/*", "source/effects/shaders/*", "source/imgui/*" }
+
+-- Tests of the parts of the plugin which don't need the game, run the executable to run them all
+project "Tests"
+	kind "ConsoleApp"
+	language "C++"
+
+	files { "tests/*.h", "tests/*.cpp" }
+	files { "source/effects/ColorGradingLut.*", "source/effects/ShadowState.*", "source/effects/ScopedPassState.*" }
+	files { "source/effects/ShaderManifest.*", "source/effects/ShaderHashTable.*" }
+	files { "source/effects/LockFreeQueue.h", "source/effects/JobSystem.*" }
+	files { "source/effects/FilePoller.*", "source/effects/SettingsIni.*", "source/effects/TimingStatistics.*" }
+	files { "source/effects/TraceEncoding.*" }
+
+	-- Passes are tested on WARP
+	links { "d3d11" }
+
+-- Microbenchmarks of hot paths, only meaningful in Release
+project "Benchmarks"
+	kind "ConsoleApp"
+	language "C++"
+
+	files { "benchmarks/*.h", "benchmarks/*.cpp" }
+	files { "source/effects/ShaderHashTable.*", "source/VtableSlots.h", "source/VtableThunks.*" }
+
+-- libFuzzer target for the shader manifest parser, run the executable with a corpus directory
+project "ShaderManifestFuzzer"
+	kind "ConsoleApp"
+	language "C++"
+
+	files { "fuzz/ShaderManifestFuzzer.cpp" }
+	files { "source/effects/ShaderManifest.*", "source/effects/ShaderHashTable.*" }
+
+	sanitize { "Address", "Fuzzer" }
+
 
 workspace "*"
 	configurations { "Debug", "Release", "Master" }
@@ -19,8 +60,8 @@ workspace "*"
 			["Resources"] = "source/**.rc"
 	}
 
-	files { "source/*.h", "source/*.cpp", "source/resources/*.rc", "source/wil/*", "source/*.def",
- 			"source/effects/*", "source/imgui/*" }
+	-- Shaders compiled at build time are emitted as headers into the intermediate directory
+	includedirs { "%{cfg.objdir}" }
 
 	-- Disable exceptions in WIL
 	defines { "WIL_SUPPRESS_EXCEPTIONS" }
@@ -37,6 +78,28 @@ workspace "*"
 	defines { "rsc_Extension=\"%{prj.targetextension}\"",
 			"rsc_Name=\"%{prj.name}\"" }
 
+filter "files:**.hlsl"
+	shadermodel "5.0"
+	shaderentry "main"
+	shaderheaderfileoutput "%{cfg.objdir}/%{file.basename}.h"
+	shadervariablename "%{file.basename:upper()}_BYTECODE"
+
+-- Dear ImGui shaders keep the shader model of the upstream backend
+filter "files:source/imgui/*.hlsl"
+	shadermodel "4.0"
+
+filter "files:**_ps.hlsl"
+	shadertype "Pixel"
+
+filter "files:**_vs.hlsl"
+	shadertype "Vertex"
+
+filter "files:**_cs.hlsl"
+	shadertype "Compute"
+
+filter "options:no-vtable-thunks"
+	defines { "VTABLE_THUNKS=0" }
+
 filter "configurations:Debug"
 	defines { "DEBUG" }
 	runtime "Debug"
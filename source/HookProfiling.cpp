@@ -0,0 +1,119 @@
+#include "HookProfiling.h"
+
+#if HOOK_PROFILING
+
+#include <Windows.h>
+#include <Shlwapi.h>
+
+#include <cstdio>
+#include <iterator>
+
+#include "wil/resource.h"
+
+extern wchar_t wcModulePath[MAX_PATH];
+
+namespace HookProfiling
+{
+
+std::atomic<bool> enabled = false;
+thread_local uint32_t depth = 0;
+thread_local uint64_t forwardedTicks = 0;
+std::atomic<uint64_t> calls[static_cast<size_t>(EntryPoint::NumEntryPoints)];
+std::atomic<uint64_t> ticks[static_cast<size_t>(EntryPoint::NumEntryPoints)];
+
+static const char* const ENTRY_POINT_NAMES[] = {
+	"PSSetShader",
+	"Draw",
+	"DrawIndexed",
+	"OtherDraw",
+	"OMSetRenderTargets",
+	"OMSetBlendState",
+	"ClearRenderTargetView",
+};
+static_assert(std::size(ENTRY_POINT_NAMES) == static_cast<size_t>(EntryPoint::NumEntryPoints));
+
+static wil::unique_file logFile;
+static uint64_t frameNumber;
+static uint64_t lastTSC;
+static LARGE_INTEGER lastQPC;
+
+static void ResetCounters()
+{
+	for ( size_t i = 0; i < std::size(calls); i++ )
+	{
+		calls[i].store( 0, std::memory_order_relaxed );
+		ticks[i].store( 0, std::memory_order_relaxed );
+	}
+}
+
+static bool OpenLog()
+{
+	wchar_t path[MAX_PATH];
+	wcscpy_s( path, wcModulePath );
+	PathRemoveExtensionW( path );
+	if ( wcscat_s( path, L"_hooks.csv" ) != 0 ) return false;
+
+	if ( _wfopen_s( logFile.put(), path, L"w" ) != 0 ) return false;
+
+	fputs( "Frame,Frame time (ms)", logFile.get() );
+	for ( const char* name : ENTRY_POINT_NAMES )
+	{
+		fprintf( logFile.get(), ",%s calls,%s (us)", name, name );
+	}
+	fputc( '\n', logFile.get() );
+	return true;
+}
+
+void OnPresent()
+{
+	if ( !enabled.load( std::memory_order_relaxed ) )
+	{
+		logFile.reset();
+		return;
+	}
+
+	const uint64_t tsc = __rdtsc();
+	LARGE_INTEGER qpc, qpcFrequency;
+	QueryPerformanceCounter( &qpc );
+	QueryPerformanceFrequency( &qpcFrequency );
+
+	if ( !logFile )
+	{
+		// Counters gathered so far don't belong to a full frame, start logging from the next one
+		if ( !OpenLog() )
+		{
+			enabled.store( false, std::memory_order_relaxed );
+			return;
+		}
+		frameNumber = 0;
+		ResetCounters();
+	}
+	else if ( qpc.QuadPart > lastQPC.QuadPart && tsc > lastTSC )
+	{
+		// TSC frequency is not known upfront, so calibrate it against QPC every frame.
+		// Frames with no measurable TSC or QPC delta (like back to back Presents) are dropped
+		const double frameSeconds = static_cast<double>(qpc.QuadPart - lastQPC.QuadPart) / qpcFrequency.QuadPart;
+		const double ticksToMicroseconds = frameSeconds * 1000000.0 / (tsc - lastTSC);
+
+		fprintf( logFile.get(), "%llu,%.3f", frameNumber++, frameSeconds * 1000.0 );
+		for ( size_t i = 0; i < std::size(calls); i++ )
+		{
+			// Deferred contexts may still be recording on other threads, so counters are taken and reset in one go
+			const uint64_t frameCalls = calls[i].exchange( 0, std::memory_order_relaxed );
+			const uint64_t frameTicks = ticks[i].exchange( 0, std::memory_order_relaxed );
+			fprintf( logFile.get(), ",%llu,%.2f", frameCalls, frameTicks * ticksToMicroseconds );
+		}
+		fputc( '\n', logFile.get() );
+	}
+	else
+	{
+		ResetCounters();
+	}
+
+	lastTSC = tsc;
+	lastQPC = qpc;
+}
+
+}
+
+#endif
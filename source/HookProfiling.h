@@ -0,0 +1,125 @@
+#pragma once
+
+// CPU overhead counters for the wrapped D3D11DeviceContext entry points which call into effects.
+// Enabled from the F11 window, a row of call counts and time spent per entry point is then appended
+// to a CSV file next to the module on every Present.
+// Counters are shared by all threads, nesting is tracked per thread. Time spent in the call forwarded
+// to the original context is excluded, so only the overhead of the wrapper and effects is measured.
+// Never compiled into Master builds.
+
+#ifndef NDEBUG
+#define HOOK_PROFILING 1
+#else
+#define HOOK_PROFILING 0
+#endif
+
+#if HOOK_PROFILING
+
+#include <atomic>
+#include <cstdint>
+#include <intrin.h>
+
+namespace HookProfiling
+{
+
+enum class EntryPoint
+{
+	PSSetShader,
+	Draw,
+	DrawIndexed,
+	OtherDraw, // Instanced, indirect and auto draws
+	OMSetRenderTargets,
+	OMSetBlendState,
+	ClearRenderTargetView,
+
+	NumEntryPoints
+};
+
+extern std::atomic<bool> enabled;
+extern thread_local uint32_t depth; // Calls made by effects into the wrapped context are accounted to the outermost call
+extern thread_local uint64_t forwardedTicks; // Spent in forwarded calls on this thread
+extern std::atomic<uint64_t> calls[static_cast<size_t>(EntryPoint::NumEntryPoints)];
+extern std::atomic<uint64_t> ticks[static_cast<size_t>(EntryPoint::NumEntryPoints)];
+
+// Measures the whole wrapped call, minus the forwarded call to the original context
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer( EntryPoint entryPoint )
+		: m_entryPoint( entryPoint ), m_tracked( enabled.load( std::memory_order_relaxed ) ), m_measuring( m_tracked && depth++ == 0 )
+	{
+		if ( m_measuring )
+		{
+			m_forwardedStart = forwardedTicks;
+			m_start = __rdtsc();
+		}
+	}
+
+	~ScopedTimer()
+	{
+		if ( m_measuring )
+		{
+			const size_t index = static_cast<size_t>(m_entryPoint);
+			const uint64_t elapsed = __rdtsc() - m_start;
+			ticks[index].fetch_add( elapsed - (forwardedTicks - m_forwardedStart), std::memory_order_relaxed );
+			calls[index].fetch_add( 1, std::memory_order_relaxed );
+		}
+		if ( m_tracked )
+		{
+			depth--;
+		}
+	}
+
+	ScopedTimer( const ScopedTimer& ) = delete;
+	ScopedTimer& operator=( const ScopedTimer& ) = delete;
+
+private:
+	EntryPoint m_entryPoint;
+	bool m_tracked; // Depth was incremented
+	bool m_measuring;
+	uint64_t m_start = 0;
+	uint64_t m_forwardedStart = 0;
+};
+
+// Excludes the rest of the scope from the outermost measured call - declared right before forwarding to the original context
+class ScopedForward
+{
+public:
+	ScopedForward()
+		: m_measuring( depth != 0 )
+	{
+		if ( m_measuring )
+		{
+			m_start = __rdtsc();
+		}
+	}
+
+	~ScopedForward()
+	{
+		if ( m_measuring )
+		{
+			forwardedTicks += __rdtsc() - m_start;
+		}
+	}
+
+	ScopedForward( const ScopedForward& ) = delete;
+	ScopedForward& operator=( const ScopedForward& ) = delete;
+
+private:
+	bool m_measuring;
+	uint64_t m_start = 0;
+};
+
+void OnPresent();
+
+}
+
+#define PROFILE_HOOK(entryPoint) HookProfiling::ScopedTimer hookTimer( HookProfiling::EntryPoint::entryPoint )
+#define PROFILE_FORWARD() HookProfiling::ScopedForward hookForward
+
+#else
+
+#define PROFILE_HOOK(entryPoint) ((void)0)
+#define PROFILE_FORWARD() ((void)0)
+
+#endif
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+
+// Vtable slots of the D3D11 interfaces we wrap, in the order they are declared in d3d11.h.
+// This order is a part of the COM ABI, so it never changes.
+namespace VtableSlots
+{
+
+enum class Device : uint16_t
+{
+	// IUnknown
+	QueryInterface,
+	AddRef,
+	Release,
+
+	// ID3D11Device
+	CreateBuffer,
+	CreateTexture1D,
+	CreateTexture2D,
+	CreateTexture3D,
+	CreateShaderResourceView,
+	CreateUnorderedAccessView,
+	CreateRenderTargetView,
+	CreateDepthStencilView,
+	CreateInputLayout,
+	CreateVertexShader,
+	CreateGeometryShader,
+	CreateGeometryShaderWithStreamOutput,
+	CreatePixelShader,
+	CreateHullShader,
+	CreateDomainShader,
+	CreateComputeShader,
+	CreateClassLinkage,
+	CreateBlendState,
+	CreateDepthStencilState,
+	CreateRasterizerState,
+	CreateSamplerState,
+	CreateQuery,
+	CreatePredicate,
+	CreateCounter,
+	CreateDeferredContext,
+	OpenSharedResource,
+	CheckFormatSupport,
+	CheckMultisampleQualityLevels,
+	CheckCounterInfo,
+	CheckCounter,
+	CheckFeatureSupport,
+	GetPrivateData,
+	SetPrivateData,
+	SetPrivateDataInterface,
+	GetFeatureLevel,
+	GetCreationFlags,
+	GetDeviceRemovedReason,
+	GetImmediateContext,
+	SetExceptionMode,
+	GetExceptionMode,
+
+	NumSlots
+};
+
+enum class DeviceContext : uint16_t
+{
+	// IUnknown
+	QueryInterface,
+	AddRef,
+	Release,
+
+	// ID3D11DeviceChild
+	GetDevice,
+	GetPrivateData,
+	SetPrivateData,
+	SetPrivateDataInterface,
+
+	// ID3D11DeviceContext
+	VSSetConstantBuffers,
+	PSSetShaderResources,
+	PSSetShader,
+	PSSetSamplers,
+	VSSetShader,
+	DrawIndexed,
+	Draw,
+	Map,
+	Unmap,
+	PSSetConstantBuffers,
+	IASetInputLayout,
+	IASetVertexBuffers,
+	IASetIndexBuffer,
+	DrawIndexedInstanced,
+	DrawInstanced,
+	GSSetConstantBuffers,
+	GSSetShader,
+	IASetPrimitiveTopology,
+	VSSetShaderResources,
+	VSSetSamplers,
+	Begin,
+	End,
+	GetData,
+	SetPredication,
+	GSSetShaderResources,
+	GSSetSamplers,
+	OMSetRenderTargets,
+	OMSetRenderTargetsAndUnorderedAccessViews,
+	OMSetBlendState,
+	OMSetDepthStencilState,
+	SOSetTargets,
+	DrawAuto,
+	DrawIndexedInstancedIndirect,
+	DrawInstancedIndirect,
+	Dispatch,
+	DispatchIndirect,
+	RSSetState,
+	RSSetViewports,
+	RSSetScissorRects,
+	CopySubresourceRegion,
+	CopyResource,
+	UpdateSubresource,
+	CopyStructureCount,
+	ClearRenderTargetView,
+	ClearUnorderedAccessViewUint,
+	ClearUnorderedAccessViewFloat,
+	ClearDepthStencilView,
+	GenerateMips,
+	SetResourceMinLOD,
+	GetResourceMinLOD,
+	ResolveSubresource,
+	ExecuteCommandList,
+	HSSetShaderResources,
+	HSSetShader,
+	HSSetSamplers,
+	HSSetConstantBuffers,
+	DSSetShaderResources,
+	DSSetShader,
+	DSSetSamplers,
+	DSSetConstantBuffers,
+	CSSetShaderResources,
+	CSSetUnorderedAccessViews,
+	CSSetShader,
+	CSSetSamplers,
+	CSSetConstantBuffers,
+	VSGetConstantBuffers,
+	PSGetShaderResources,
+	PSGetShader,
+	PSGetSamplers,
+	VSGetShader,
+	PSGetConstantBuffers,
+	IAGetInputLayout,
+	IAGetVertexBuffers,
+	IAGetIndexBuffer,
+	GSGetConstantBuffers,
+	GSGetShader,
+	IAGetPrimitiveTopology,
+	VSGetShaderResources,
+	VSGetSamplers,
+	GetPredication,
+	GSGetShaderResources,
+	GSGetSamplers,
+	OMGetRenderTargets,
+	OMGetRenderTargetsAndUnorderedAccessViews,
+	OMGetBlendState,
+	OMGetDepthStencilState,
+	SOGetTargets,
+	RSGetState,
+	RSGetViewports,
+	RSGetScissorRects,
+	HSGetShaderResources,
+	HSGetShader,
+	HSGetSamplers,
+	HSGetConstantBuffers,
+	DSGetShaderResources,
+	DSGetShader,
+	DSGetSamplers,
+	DSGetConstantBuffers,
+	CSGetShaderResources,
+	CSGetUnorderedAccessViews,
+	CSGetShader,
+	CSGetSamplers,
+	CSGetConstantBuffers,
+	ClearState,
+	Flush,
+	GetType,
+	GetContextFlags,
+	FinishCommandList,
+
+	NumSlots
+};
+
+static_assert( static_cast<uint16_t>(Device::NumSlots) == 43 );
+static_assert( static_cast<uint16_t>(DeviceContext::NumSlots) == 115 );
+
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "VtableThunks.h"
+
+#if VTABLE_THUNKS
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace VtableThunks
+{
+
+// Every thunk is the same code with the offset of the wrapped object's pointer and the slot's vtable offset filled in
+#if defined(_M_IX86)
+// Arguments are on the stack - 'this' is swapped in place, so the callee cleans up the caller's arguments as usual
+static const uint8_t THUNK_CODE[] = {
+	0x8B, 0x44, 0x24, 0x04,				// mov eax, [esp+4]
+	0x8B, 0x80, 0x00, 0x00, 0x00, 0x00,	// mov eax, [eax+origOffset]
+	0x89, 0x44, 0x24, 0x04,				// mov [esp+4], eax
+	0x8B, 0x08,							// mov ecx, [eax]
+	0xFF, 0xA1, 0x00, 0x00, 0x00, 0x00,	// jmp [ecx+slotOffset]
+};
+static constexpr size_t ORIG_OFFSET_POS = 6;
+static constexpr size_t SLOT_OFFSET_POS = 18;
+#elif defined(_M_X64)
+// 'this' is in rcx and the stack is left untouched, so no unwind data is needed
+static const uint8_t THUNK_CODE[] = {
+	0x48, 0x8B, 0x89, 0x00, 0x00, 0x00, 0x00,	// mov rcx, [rcx+origOffset]
+	0x48, 0x8B, 0x01,							// mov rax, [rcx]
+	0xFF, 0xA0, 0x00, 0x00, 0x00, 0x00,			// jmp [rax+slotOffset]
+};
+static constexpr size_t ORIG_OFFSET_POS = 3;
+static constexpr size_t SLOT_OFFSET_POS = 12;
+#else
+#error Unsupported architecture
+#endif
+
+static constexpr size_t THUNK_SIZE = (sizeof(THUNK_CODE) + 15) & ~size_t(15);
+
+static std::mutex patchMutex;
+static std::vector<void**> patchedVtables; // Guarded by patchMutex
+
+bool PatchForwardingSlots(void* interfacePtr, ptrdiff_t origOffset, const uint16_t* slots, size_t numSlots)
+{
+	void** vtable = *static_cast<void***>(interfacePtr);
+
+	std::lock_guard<std::mutex> lock( patchMutex );
+	if ( std::find( patchedVtables.begin(), patchedVtables.end(), vtable ) != patchedVtables.end() ) return true;
+
+	if ( numSlots == 0 ) return true;
+
+	// Thunks are never freed, as the patched vtable keeps pointing at them until the process exits
+	const size_t thunksSize = numSlots * THUNK_SIZE;
+	uint8_t* thunks = static_cast<uint8_t*>(VirtualAlloc( nullptr, thunksSize, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE ));
+	if ( thunks == nullptr ) return false;
+
+	const int32_t origOffsetValue = static_cast<int32_t>(origOffset);
+	for ( size_t i = 0; i < numSlots; i++ )
+	{
+		uint8_t* thunk = thunks + i * THUNK_SIZE;
+		const int32_t slotOffset = static_cast<int32_t>(slots[i] * sizeof(void*));
+
+		memcpy( thunk, THUNK_CODE, sizeof(THUNK_CODE) );
+		memcpy( thunk + ORIG_OFFSET_POS, &origOffsetValue, sizeof(origOffsetValue) );
+		memcpy( thunk + SLOT_OFFSET_POS, &slotOffset, sizeof(slotOffset) );
+		memset( thunk + sizeof(THUNK_CODE), 0xCC, THUNK_SIZE - sizeof(THUNK_CODE) ); // int3 padding
+	}
+
+	DWORD oldProtect;
+	if ( VirtualProtect( thunks, thunksSize, PAGE_EXECUTE_READ, &oldProtect ) == FALSE )
+	{
+		VirtualFree( thunks, 0, MEM_RELEASE );
+		return false;
+	}
+	FlushInstructionCache( GetCurrentProcess(), thunks, thunksSize );
+
+	// Vtables live in read-only data
+	const size_t vtableSize = (*std::max_element( slots, slots + numSlots ) + 1) * sizeof(void*);
+	if ( VirtualProtect( vtable, vtableSize, PAGE_READWRITE, &oldProtect ) == FALSE )
+	{
+		VirtualFree( thunks, 0, MEM_RELEASE );
+		return false;
+	}
+
+	// Objects of this class may already be in use on other threads, so every slot is swapped with a single store
+	for ( size_t i = 0; i < numSlots; i++ )
+	{
+		InterlockedExchangePointer( &vtable[slots[i]], thunks + i * THUNK_SIZE );
+	}
+
+	VirtualProtect( vtable, vtableSize, oldProtect, &oldProtect );
+
+	patchedVtables.push_back( vtable );
+	return true;
+}
+
+}
+
+#endif
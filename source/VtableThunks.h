@@ -0,0 +1,60 @@
+#pragma once
+
+// Frameless forwarding of wrapper methods which do nothing but call the same method of the wrapped object.
+// Their vtable slots are patched to point at generated thunks, which replace 'this' with the wrapped object
+// and jump straight into its vtable - so the original object returns directly to the caller.
+// Wrappers keep their forwarding implementations, so calls the compiler devirtualized still work the same,
+// and so thunks can be turned off with the no-vtable-thunks premake option.
+
+#ifndef VTABLE_THUNKS
+#define VTABLE_THUNKS 1
+#endif
+
+#if VTABLE_THUNKS
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VtableThunks
+{
+
+// Patches the slots of the vtable used by the interface pointer, so it affects all objects of its class - patching it again does nothing.
+// origOffset is the offset from the interface pointer to the wrapped object's interface pointer, which must have the same vtable layout.
+// Returns false if the vtable couldn't be patched, the wrapper then keeps forwarding by itself.
+bool PatchForwardingSlots( void* interfacePtr, ptrdiff_t origOffset, const uint16_t* slots, size_t numSlots );
+
+template<typename Slot, size_t N>
+bool PatchForwardingSlots( void* interfacePtr, ptrdiff_t origOffset, const Slot (&slots)[N] )
+{
+	uint16_t indices[N];
+	for ( size_t i = 0; i < N; i++ )
+	{
+		indices[i] = static_cast<uint16_t>(slots[i]);
+	}
+	return PatchForwardingSlots( interfacePtr, origOffset, indices, N );
+}
+
+// Returns true if every slot of the interface is listed exactly once, either as forwarded or as wrapped -
+// so no method can be added to the wrapper without deciding whether it needs to see the calls
+template<typename Slot, size_t NumForwarded, size_t NumWrapped>
+constexpr bool PartitionsSlots( const Slot (&forwarded)[NumForwarded], const Slot (&wrapped)[NumWrapped] )
+{
+	for ( uint16_t slot = 0; slot < static_cast<uint16_t>(Slot::NumSlots); slot++ )
+	{
+		size_t count = 0;
+		for ( Slot listed : forwarded )
+		{
+			if ( static_cast<uint16_t>(listed) == slot ) count++;
+		}
+		for ( Slot listed : wrapped )
+		{
+			if ( static_cast<uint16_t>(listed) == slot ) count++;
+		}
+		if ( count != 1 ) return false;
+	}
+	return NumForwarded + NumWrapped == static_cast<size_t>(Slot::NumSlots);
+}
+
+}
+
+#endif
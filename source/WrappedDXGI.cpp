@@ -1,5 +1,8 @@
 #include "WrappedDXGI.h"
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <utility>
 #include <d3d11.h>
 
@@ -8,6 +11,8 @@
 #include "imgui/imgui_impl_dx11.h"
 
 #include "effects/Metadata.h"
+#include "WrappedDevice.h"
+#include "HookProfiling.h"
 
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -16,9 +21,23 @@ namespace UI
 {
 
 static bool imguiInitialized = false;
+static std::atomic_bool imguiActive { false }; // ImGui is suspended entirely while the overlay is hidden
+static std::atomic_bool toggleRequested { false };
 static WNDPROC orgWndProc;
 LRESULT WINAPI UIWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
+    // Detect the F11 press outside of ImGui, so it works while ImGui is suspended
+    // Bit 30 of lParam is set for auto-repeated key presses
+    if ( msg == WM_KEYDOWN && wParam == VK_F11 && (lParam & (1 << 30)) == 0 )
+    {
+        toggleRequested = true;
+    }
+
+    if ( !imguiActive )
+    {
+        return CallWindowProc(orgWndProc, hWnd, msg, wParam, lParam);
+    }
+
     LRESULT imguiResult = ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam);
     if ( imguiResult != 0 ) return imguiResult;
 
@@ -50,6 +69,25 @@ LRESULT WINAPI UIWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     return CallWindowProc(orgWndProc, hWnd, msg, wParam, lParam);
 }
 
+static void StartFrame()
+{
+    ImGui_ImplDX11_NewFrame();
+    ImGui_ImplWin32_NewFrame();
+    ImGui::NewFrame();
+}
+
+static void ResumeImGui()
+{
+    // ImGui received no input while suspended, so drop anything it still considers held
+    ImGuiIO& io = ImGui::GetIO();
+    std::fill( std::begin(io.KeysDown), std::end(io.KeysDown), false );
+    std::fill( std::begin(io.MouseDown), std::end(io.MouseDown), false );
+    io.MouseWheel = io.MouseWheelH = 0.0f;
+
+    imguiActive = true;
+    StartFrame();
+}
+
 static void SetUpImGuiStyle()
 {
     ImGuiStyle* style = &ImGui::GetStyle();
@@ -281,15 +319,17 @@ DXGISwapChain::DXGISwapChain(ComPtr<IDXGISwapChain> swapChain, ComPtr<DXGIFactor
         ImGui_ImplDX11_Init(d3dDevice.Get(), d3dDeviceContext.Get()); // Init holds a reference to both
     }
 
-    // Immediately start a new frame - we'll be starting new frames after each Present
-    ImGui_ImplDX11_NewFrame();
-    ImGui_ImplWin32_NewFrame();
-    ImGui::NewFrame();
+    // Frames are started on demand in Present, only while the overlay is shown
+
+    CreateBackBufferRTV();
 }
 
 DXGISwapChain::~DXGISwapChain()
 {
-    ImGui::EndFrame();
+    if ( UI::imguiActive.exchange(false) )
+    {
+        ImGui::EndFrame();
+    }
 
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplWin32_Shutdown();
@@ -332,26 +372,28 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::GetDevice(REFIID riid, void** ppDevice)
 
 HRESULT STDMETHODCALLTYPE DXGISwapChain::Present(UINT SyncInterval, UINT Flags)
 {
+    // Only available if the swap chain was created with our device
+    ComPtr<D3D11Device> wrappedDevice;
+    m_device.As(&wrappedDevice);
+
+    if ( UI::toggleRequested.exchange(false) )
+    {
+        Effects::SETTINGS.isShown = !Effects::SETTINGS.isShown;
+    }
+
+    // Resume ImGui immediately, so the overlay shows up on this frame already
+    if ( Effects::SETTINGS.isShown && !UI::imguiActive )
+    {
+        UI::ResumeImGui();
+    }
+
     // Draw all UI widgets
+    if ( UI::imguiActive )
     {
         using namespace Effects;
 
         ImGuiIO& io = ImGui::GetIO();
 
-        static bool keyPressed = false;
-        if ( io.KeysDown[VK_F11] )
-        {
-            if ( !keyPressed )
-            {
-                SETTINGS.isShown = !SETTINGS.isShown;
-                keyPressed = true;
-            }
-        }
-        else
-        {
-            keyPressed = false;
-        }
-
         if ( SETTINGS.isShown )
         {
             //ImGui::ShowDemoWindow();
@@ -406,6 +448,10 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::Present(UINT SyncInterval, UINT Flags)
 
                     if ( ImGui::CollapsingHeader( "Advanced settings" ) )
                     {
+                        needsToSave |= ImGui::Checkbox( "Use 3D LUT", &SETTINGS.colorGradingLut );
+                        needsToSave |= ImGui::Checkbox( "Filter redundant state changes", &SETTINGS.filterRedundantState );
+                        ImGui::NewLine();
+
                         ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.45f);
                         colorGradingDirty |= ImGui::DragFloat( "Intensity", &SETTINGS.colorGradingAttributes[0][0], 0.005f, 0.0f, FLT_MAX );
                         colorGradingDirty |= ImGui::DragFloat( "Saturation", &SETTINGS.colorGradingAttributes[0][1], 0.005f, 0.0f, FLT_MAX );
@@ -432,12 +478,102 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::Present(UINT SyncInterval, UINT Flags)
                         }
                     }
 
-                    SETTINGS.colorGradingDirty |= colorGradingDirty;
                     needsToSave |= colorGradingDirty;
 
                     ImGui::Dummy( ImVec2(0.0f, 20.0f) );
                 }
 
+                if ( wrappedDevice != nullptr && ImGui::CollapsingHeader( "GPU timings" ) )
+                {
+                    const GPUProfiler& profiler = wrappedDevice->GetGPUProfiler();
+
+                    ImGui::Columns( 4, "GPU timings", false );
+                    ImGui::TextDisabled( "Pass" ); ImGui::NextColumn();
+                    ImGui::TextDisabled( "Min" ); ImGui::NextColumn();
+                    ImGui::TextDisabled( "Avg" ); ImGui::NextColumn();
+                    ImGui::TextDisabled( "P99" ); ImGui::NextColumn();
+
+                    for ( size_t i = 0; i < static_cast<size_t>(GPUProfiler::Pass::NumPasses); i++ )
+                    {
+                        const GPUProfiler::Pass pass = static_cast<GPUProfiler::Pass>(i);
+                        const TimingStatistics::Summary summary = profiler.GetStatistics( pass ).GetSummary();
+
+                        ImGui::TextUnformatted( GPUProfiler::GetPassName( pass ) ); ImGui::NextColumn();
+                        if ( summary.m_count > 0 )
+                        {
+                            ImGui::Text( "%.3f ms", summary.m_min ); ImGui::NextColumn();
+                            ImGui::Text( "%.3f ms", summary.m_avg ); ImGui::NextColumn();
+                            ImGui::Text( "%.3f ms", summary.m_p99 ); ImGui::NextColumn();
+                        }
+                        else
+                        {
+                            ImGui::TextDisabled( "-" ); ImGui::NextColumn();
+                            ImGui::TextDisabled( "-" ); ImGui::NextColumn();
+                            ImGui::TextDisabled( "-" ); ImGui::NextColumn();
+                        }
+                    }
+                    ImGui::Columns( 1 );
+
+                    // Replacements which didn't fit the job queue are created on the render thread, which shows up as hitches
+                    if ( const size_t droppedJobs = wrappedDevice->GetDroppedShaderJobs(); droppedJobs != 0 )
+                    {
+                        ImGui::Text( "%zu shader replacements created on first use", droppedJobs );
+                    }
+                }
+
+                if ( wrappedDevice != nullptr && ImGui::CollapsingHeader( "Redundant state changes" ) )
+                {
+                    const StateFilterStatistics::Counts& counts = wrappedDevice->GetStateFilterStatistics().GetLastFrame();
+
+                    ImGui::Columns( 3, "Redundant state changes", false );
+                    ImGui::TextDisabled( "Call" ); ImGui::NextColumn();
+                    ImGui::TextDisabled( "Calls" ); ImGui::NextColumn();
+                    ImGui::TextDisabled( "Redundant" ); ImGui::NextColumn();
+
+                    uint32_t totalCalls = 0, totalRedundant = 0;
+                    for ( size_t i = 0; i < static_cast<size_t>(StateFilterStatistics::Call::NumCalls); i++ )
+                    {
+                        ImGui::TextUnformatted( StateFilterStatistics::GetCallName( static_cast<StateFilterStatistics::Call>(i) ) ); ImGui::NextColumn();
+                        ImGui::Text( "%u", counts.m_calls[i] ); ImGui::NextColumn();
+                        ImGui::Text( "%u", counts.m_redundant[i] ); ImGui::NextColumn();
+
+                        totalCalls += counts.m_calls[i];
+                        totalRedundant += counts.m_redundant[i];
+                    }
+                    ImGui::Columns( 1 );
+
+                    const float rate = totalCalls > 0 ? 100.0f * totalRedundant / totalCalls : 0.0f;
+                    ImGui::Text( SETTINGS.filterRedundantState ? "%.1f%% of calls elided" : "%.1f%% of calls could be elided", rate );
+                }
+
+                if ( wrappedDevice != nullptr && ImGui::CollapsingHeader( "Trace capture" ) )
+                {
+                    TraceCapture& traceCapture = wrappedDevice->GetTraceCapture();
+                    if ( traceCapture.IsCapturing() )
+                    {
+                        ImGui::Text( "Capturing, %u frames left...", traceCapture.GetRemainingFrames() );
+                    }
+                    else
+                    {
+                        static int numFramesToCapture = 1;
+                        ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.45f);
+                        ImGui::SliderInt( "Frames", &numFramesToCapture, 1, 60 );
+                        ImGui::PopItemWidth();
+                        if ( ImGui::Button( "Capture" ) )
+                        {
+                            traceCapture.Start( static_cast<uint32_t>(numFramesToCapture) );
+                        }
+                    }
+                }
+
+#if HOOK_PROFILING
+                bool hookProfiling = HookProfiling::enabled.load( std::memory_order_relaxed );
+                if ( ImGui::Checkbox( "Log hook overhead", &hookProfiling ) )
+                {
+                    HookProfiling::enabled.store( hookProfiling, std::memory_order_relaxed );
+                }
+#endif
+
                 if ( needsToSave )
                 {
                     SaveSettings();
@@ -450,38 +586,72 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::Present(UINT SyncInterval, UINT Flags)
         io.MouseDrawCursor = SETTINGS.isShown;
     }
 
-    ImGui::Render();
-
-    ImDrawData* drawData = ImGui::GetDrawData();
-    if ( drawData->TotalVtxCount > 0 )
+    if ( UI::imguiActive )
     {
-        // Only do this relatively heavy work if we actually render something
-        ComPtr<ID3D11Device> d3dDevice;
-        if ( SUCCEEDED(m_device.As(&d3dDevice)) )
+        ImGui::Render();
+
+        // Our own UI is not a part of the game's call stream
+        Effects::TraceCapture::CallGuard uiCalls( wrappedDevice != nullptr ? &wrappedDevice->GetTraceCapture() : nullptr, nullptr );
+
+        ImDrawData* drawData = ImGui::GetDrawData();
+        if ( drawData->TotalVtxCount > 0 && m_backBufferRTV != nullptr )
         {
-            ComPtr<ID3D11Resource> renderTarget;
-            if ( SUCCEEDED(GetBuffer(0, IID_PPV_ARGS(renderTarget.GetAddressOf())))  )
+            ComPtr<ID3D11Device> d3dDevice;
+            if ( SUCCEEDED(m_device.As(&d3dDevice)) )
             {
-                ComPtr<ID3D11RenderTargetView> rtv;
-                if ( SUCCEEDED(d3dDevice->CreateRenderTargetView( renderTarget.Get(), nullptr, rtv.GetAddressOf()) ) )
-                {
-                    ComPtr<ID3D11DeviceContext> d3dDeviceContext;
-                    d3dDevice->GetImmediateContext( d3dDeviceContext.GetAddressOf() );
+                ComPtr<ID3D11DeviceContext> d3dDeviceContext;
+                d3dDevice->GetImmediateContext( d3dDeviceContext.GetAddressOf() );
 
-                    d3dDeviceContext->OMSetRenderTargets( 1, rtv.GetAddressOf(), nullptr );
-                }
+                d3dDeviceContext->OMSetRenderTargets( 1, m_backBufferRTV.GetAddressOf(), nullptr );
             }
         }
+
+        if ( wrappedDevice != nullptr )
+        {
+            ComPtr<ID3D11DeviceContext> d3dDeviceContext;
+            wrappedDevice->GetImmediateContext( d3dDeviceContext.GetAddressOf() );
+
+            Effects::GPUProfiler::Scope profile( wrappedDevice->GetGPUProfiler(), d3dDeviceContext.Get(), Effects::GPUProfiler::Pass::UI );
+            ImGui_ImplDX11_RenderDrawData(drawData);
+        }
+        else
+        {
+            ImGui_ImplDX11_RenderDrawData(drawData);
+        }
+    }
+
+    if ( wrappedDevice != nullptr )
+    {
+        ComPtr<ID3D11DeviceContext> d3dDeviceContext;
+        wrappedDevice->GetImmediateContext( d3dDeviceContext.GetAddressOf() );
+
+        // Only measure while the results can be seen
+        wrappedDevice->GetGPUProfiler().OnPresent( d3dDeviceContext.Get(), Effects::SETTINGS.isShown );
+
+        wrappedDevice->GetTraceCapture().OnPresent( d3dDeviceContext.Get() );
+        wrappedDevice->GetRenderTargetPool().OnPresent();
+        wrappedDevice->GetStateFilterStatistics().OnPresent();
     }
 
-    ImGui_ImplDX11_RenderDrawData(drawData);
+    // Effects see settings edited this frame from the next frame on
+    Effects::ApplyReloadedSettings();
+    Effects::PublishSettings();
+
+#if HOOK_PROFILING
+    HookProfiling::OnPresent();
+#endif
 
     HRESULT hr = m_orig->Present(SyncInterval, Flags);
 
-    // Start the Dear ImGui frame
-    ImGui_ImplDX11_NewFrame();
-    ImGui_ImplWin32_NewFrame();
-    ImGui::NewFrame();
+    // Start the Dear ImGui frame, or suspend ImGui if the overlay has just been closed
+    if ( Effects::SETTINGS.isShown )
+    {
+        UI::StartFrame();
+    }
+    else
+    {
+        UI::imguiActive = false;
+    }
 
     return hr;
 }
@@ -508,7 +678,19 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::GetDesc(DXGI_SWAP_CHAIN_DESC* pDesc)
 
 HRESULT STDMETHODCALLTYPE DXGISwapChain::ResizeBuffers(UINT BufferCount, UINT Width, UINT Height, DXGI_FORMAT NewFormat, UINT SwapChainFlags)
 {
-	return m_orig->ResizeBuffers(BufferCount, Width, Height, NewFormat, SwapChainFlags);
+	// ResizeBuffers fails if any references to the back buffer are still held
+	m_backBufferRTV.Reset();
+
+	// Cached views may hold the back buffer too, and pooled targets are sized for the old resolution
+	ComPtr<D3D11Device> wrappedDevice;
+	if ( SUCCEEDED(m_device.As(&wrappedDevice)) )
+	{
+		wrappedDevice->GetRenderTargetPool().Purge();
+	}
+
+	HRESULT hr = m_orig->ResizeBuffers(BufferCount, Width, Height, NewFormat, SwapChainFlags);
+	CreateBackBufferRTV();
+	return hr;
 }
 
 HRESULT STDMETHODCALLTYPE DXGISwapChain::ResizeTarget(const DXGI_MODE_DESC* pNewTargetParameters)
@@ -534,4 +716,18 @@ HRESULT STDMETHODCALLTYPE DXGISwapChain::GetLastPresentCount(UINT* pLastPresentC
 HRESULT STDMETHODCALLTYPE DXGISwapChain::GetUnderlyingInterface(REFIID riid, void** ppvObject)
 {
     return m_orig.CopyTo(riid, ppvObject);
-}
\ No newline at end of file
+}
+
+void DXGISwapChain::CreateBackBufferRTV()
+{
+    // Buffer 0 always refers to the current back buffer, so a single view is enough for the entire lifetime of the buffers
+    ComPtr<ID3D11Device> d3dDevice;
+    if ( SUCCEEDED(m_device.As(&d3dDevice)) )
+    {
+        ComPtr<ID3D11Resource> backBuffer;
+        if ( SUCCEEDED(m_orig->GetBuffer(0, IID_PPV_ARGS(backBuffer.GetAddressOf()))) )
+        {
+            d3dDevice->CreateRenderTargetView( backBuffer.Get(), nullptr, m_backBufferRTV.ReleaseAndGetAddressOf() );
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <dxgi.h>
+#include <d3d11.h>
 
 #include <wrl/implements.h>
 #include <wrl/client.h>
@@ -69,7 +70,11 @@ public:
 	virtual HRESULT STDMETHODCALLTYPE GetUnderlyingInterface(REFIID riid, void** ppvObject) override;
 
 private:
+	void CreateBackBufferRTV();
+
 	ComPtr<DXGIFactory> m_factory;
 	ComPtr<IUnknown> m_device;
 	ComPtr<IDXGISwapChain> m_orig;
+
+	ComPtr<ID3D11RenderTargetView> m_backBufferRTV; // Recreated on ResizeBuffers
 };
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "WrappedDevice.h"
+#include "HookProfiling.h"
+#include "VtableSlots.h"
+#include "VtableThunks.h"
 
+#include <atomic>
+#include <new>
 #include <utility>
 
 extern HMODULE WINAPI LoadLibraryA_DXHR( LPCSTR lpLibFileName );
@@ -38,18 +43,271 @@ HRESULT WINAPI D3D11CreateDevice_Export( IDXGIAdapter* pAdapter, D3D_DRIVER_TYPE
     return DXGI_ERROR_SDK_COMPONENT_MISSING; // If either LoadLibrary or GetProcAddress fails
 }
 
+#if VTABLE_THUNKS
+
+// Methods whose implementations below only forward to m_orig with the same arguments.
+// Hooked methods must never be listed here, as their thunks would skip the wrapper - a method which gets a hook,
+// or starts tracking state, moves to the wrapped slots, and the static_asserts make sure each slot is in exactly one list
+static constexpr VtableSlots::Device DEVICE_FORWARDED_SLOTS[] = {
+    VtableSlots::Device::CreateBuffer,
+    VtableSlots::Device::CreateTexture1D,
+    VtableSlots::Device::CreateTexture2D,
+    VtableSlots::Device::CreateTexture3D,
+    VtableSlots::Device::CreateShaderResourceView,
+    VtableSlots::Device::CreateUnorderedAccessView,
+    VtableSlots::Device::CreateRenderTargetView,
+    VtableSlots::Device::CreateDepthStencilView,
+    VtableSlots::Device::CreateInputLayout,
+    VtableSlots::Device::CreateVertexShader,
+    VtableSlots::Device::CreateGeometryShader,
+    VtableSlots::Device::CreateGeometryShaderWithStreamOutput,
+    VtableSlots::Device::CreateHullShader,
+    VtableSlots::Device::CreateDomainShader,
+    VtableSlots::Device::CreateComputeShader,
+    VtableSlots::Device::CreateClassLinkage,
+    VtableSlots::Device::CreateBlendState,
+    VtableSlots::Device::CreateDepthStencilState,
+    VtableSlots::Device::CreateRasterizerState,
+    VtableSlots::Device::CreateSamplerState,
+    VtableSlots::Device::CreateQuery,
+    VtableSlots::Device::CreatePredicate,
+    VtableSlots::Device::CreateCounter,
+    VtableSlots::Device::OpenSharedResource,
+    VtableSlots::Device::CheckFormatSupport,
+    VtableSlots::Device::CheckMultisampleQualityLevels,
+    VtableSlots::Device::CheckCounterInfo,
+    VtableSlots::Device::CheckCounter,
+    VtableSlots::Device::CheckFeatureSupport,
+    VtableSlots::Device::GetPrivateData,
+    VtableSlots::Device::SetPrivateData,
+    VtableSlots::Device::SetPrivateDataInterface,
+    VtableSlots::Device::GetFeatureLevel,
+    VtableSlots::Device::GetCreationFlags,
+    VtableSlots::Device::GetDeviceRemovedReason,
+    VtableSlots::Device::SetExceptionMode,
+    VtableSlots::Device::GetExceptionMode,
+};
+
+static constexpr VtableSlots::Device DEVICE_WRAPPED_SLOTS[] = {
+    VtableSlots::Device::QueryInterface,
+    VtableSlots::Device::AddRef,
+    VtableSlots::Device::Release,
+    VtableSlots::Device::CreatePixelShader,
+    VtableSlots::Device::CreateDeferredContext,
+    VtableSlots::Device::GetImmediateContext,
+};
+static_assert( VtableThunks::PartitionsSlots( DEVICE_FORWARDED_SLOTS, DEVICE_WRAPPED_SLOTS ), "Every device slot must be either forwarded or wrapped" );
+
+static constexpr VtableSlots::DeviceContext DEVICE_CONTEXT_FORWARDED_SLOTS[] = {
+    VtableSlots::DeviceContext::GetPrivateData,
+    VtableSlots::DeviceContext::SetPrivateData,
+    VtableSlots::DeviceContext::SetPrivateDataInterface,
+    VtableSlots::DeviceContext::VSSetConstantBuffers,
+    VtableSlots::DeviceContext::Map,
+    VtableSlots::DeviceContext::Unmap,
+    VtableSlots::DeviceContext::IASetIndexBuffer,
+    VtableSlots::DeviceContext::GSSetConstantBuffers,
+    VtableSlots::DeviceContext::GSSetShader,
+    VtableSlots::DeviceContext::IASetPrimitiveTopology,
+    VtableSlots::DeviceContext::VSSetShaderResources,
+    VtableSlots::DeviceContext::VSSetSamplers,
+    VtableSlots::DeviceContext::Begin,
+    VtableSlots::DeviceContext::End,
+    VtableSlots::DeviceContext::GetData,
+    VtableSlots::DeviceContext::SetPredication,
+    VtableSlots::DeviceContext::GSSetShaderResources,
+    VtableSlots::DeviceContext::GSSetSamplers,
+    VtableSlots::DeviceContext::OMSetDepthStencilState,
+    VtableSlots::DeviceContext::SOSetTargets,
+    VtableSlots::DeviceContext::Dispatch,
+    VtableSlots::DeviceContext::DispatchIndirect,
+    VtableSlots::DeviceContext::RSSetViewports,
+    VtableSlots::DeviceContext::RSSetScissorRects,
+    VtableSlots::DeviceContext::CopySubresourceRegion,
+    VtableSlots::DeviceContext::CopyResource,
+    VtableSlots::DeviceContext::UpdateSubresource,
+    VtableSlots::DeviceContext::CopyStructureCount,
+    VtableSlots::DeviceContext::ClearUnorderedAccessViewUint,
+    VtableSlots::DeviceContext::ClearUnorderedAccessViewFloat,
+    VtableSlots::DeviceContext::ClearDepthStencilView,
+    VtableSlots::DeviceContext::GenerateMips,
+    VtableSlots::DeviceContext::SetResourceMinLOD,
+    VtableSlots::DeviceContext::GetResourceMinLOD,
+    VtableSlots::DeviceContext::ResolveSubresource,
+    VtableSlots::DeviceContext::HSSetShaderResources,
+    VtableSlots::DeviceContext::HSSetShader,
+    VtableSlots::DeviceContext::HSSetSamplers,
+    VtableSlots::DeviceContext::HSSetConstantBuffers,
+    VtableSlots::DeviceContext::DSSetShaderResources,
+    VtableSlots::DeviceContext::DSSetShader,
+    VtableSlots::DeviceContext::DSSetSamplers,
+    VtableSlots::DeviceContext::DSSetConstantBuffers,
+    VtableSlots::DeviceContext::CSSetShaderResources,
+    VtableSlots::DeviceContext::CSSetShader,
+    VtableSlots::DeviceContext::CSSetSamplers,
+    VtableSlots::DeviceContext::CSSetConstantBuffers,
+    VtableSlots::DeviceContext::VSGetConstantBuffers,
+    VtableSlots::DeviceContext::PSGetShaderResources,
+    VtableSlots::DeviceContext::PSGetShader,
+    VtableSlots::DeviceContext::PSGetSamplers,
+    VtableSlots::DeviceContext::VSGetShader,
+    VtableSlots::DeviceContext::PSGetConstantBuffers,
+    VtableSlots::DeviceContext::IAGetInputLayout,
+    VtableSlots::DeviceContext::IAGetVertexBuffers,
+    VtableSlots::DeviceContext::IAGetIndexBuffer,
+    VtableSlots::DeviceContext::GSGetConstantBuffers,
+    VtableSlots::DeviceContext::GSGetShader,
+    VtableSlots::DeviceContext::IAGetPrimitiveTopology,
+    VtableSlots::DeviceContext::VSGetShaderResources,
+    VtableSlots::DeviceContext::VSGetSamplers,
+    VtableSlots::DeviceContext::GetPredication,
+    VtableSlots::DeviceContext::GSGetShaderResources,
+    VtableSlots::DeviceContext::GSGetSamplers,
+    VtableSlots::DeviceContext::OMGetRenderTargets,
+    VtableSlots::DeviceContext::OMGetRenderTargetsAndUnorderedAccessViews,
+    VtableSlots::DeviceContext::OMGetBlendState,
+    VtableSlots::DeviceContext::OMGetDepthStencilState,
+    VtableSlots::DeviceContext::SOGetTargets,
+    VtableSlots::DeviceContext::RSGetState,
+    VtableSlots::DeviceContext::RSGetViewports,
+    VtableSlots::DeviceContext::RSGetScissorRects,
+    VtableSlots::DeviceContext::HSGetShaderResources,
+    VtableSlots::DeviceContext::HSGetShader,
+    VtableSlots::DeviceContext::HSGetSamplers,
+    VtableSlots::DeviceContext::HSGetConstantBuffers,
+    VtableSlots::DeviceContext::DSGetShaderResources,
+    VtableSlots::DeviceContext::DSGetShader,
+    VtableSlots::DeviceContext::DSGetSamplers,
+    VtableSlots::DeviceContext::DSGetConstantBuffers,
+    VtableSlots::DeviceContext::CSGetShaderResources,
+    VtableSlots::DeviceContext::CSGetUnorderedAccessViews,
+    VtableSlots::DeviceContext::CSGetShader,
+    VtableSlots::DeviceContext::CSGetSamplers,
+    VtableSlots::DeviceContext::CSGetConstantBuffers,
+    VtableSlots::DeviceContext::Flush,
+    VtableSlots::DeviceContext::GetType,
+    VtableSlots::DeviceContext::GetContextFlags,
+};
+
+static constexpr VtableSlots::DeviceContext DEVICE_CONTEXT_WRAPPED_SLOTS[] = {
+    VtableSlots::DeviceContext::QueryInterface,
+    VtableSlots::DeviceContext::AddRef,
+    VtableSlots::DeviceContext::Release,
+    VtableSlots::DeviceContext::GetDevice,
+    VtableSlots::DeviceContext::PSSetShaderResources,
+    VtableSlots::DeviceContext::PSSetShader,
+    VtableSlots::DeviceContext::PSSetSamplers,
+    VtableSlots::DeviceContext::VSSetShader,
+    VtableSlots::DeviceContext::DrawIndexed,
+    VtableSlots::DeviceContext::Draw,
+    VtableSlots::DeviceContext::PSSetConstantBuffers,
+    VtableSlots::DeviceContext::IASetInputLayout,
+    VtableSlots::DeviceContext::IASetVertexBuffers,
+    VtableSlots::DeviceContext::DrawIndexedInstanced,
+    VtableSlots::DeviceContext::DrawInstanced,
+    VtableSlots::DeviceContext::OMSetRenderTargets,
+    VtableSlots::DeviceContext::OMSetRenderTargetsAndUnorderedAccessViews,
+    VtableSlots::DeviceContext::OMSetBlendState,
+    VtableSlots::DeviceContext::DrawAuto,
+    VtableSlots::DeviceContext::DrawIndexedInstancedIndirect,
+    VtableSlots::DeviceContext::DrawInstancedIndirect,
+    VtableSlots::DeviceContext::RSSetState,
+    VtableSlots::DeviceContext::ClearRenderTargetView,
+    VtableSlots::DeviceContext::ExecuteCommandList,
+    VtableSlots::DeviceContext::CSSetUnorderedAccessViews,
+    VtableSlots::DeviceContext::ClearState,
+    VtableSlots::DeviceContext::FinishCommandList,
+};
+static_assert( VtableThunks::PartitionsSlots( DEVICE_CONTEXT_FORWARDED_SLOTS, DEVICE_CONTEXT_WRAPPED_SLOTS ), "Every device context slot must be either forwarded or wrapped" );
+
+static_assert(sizeof(ComPtr<ID3D11Device>) == sizeof(ID3D11Device*), "Thunks read m_orig as a raw pointer");
+
+#endif
+
 // ====================================================
 
+// Attached to classified pixel shaders as private data - the runtime releases it when the shader is destroyed,
+// before its memory can be reused by a new shader
+class __declspec(uuid("6501868A-468E-4C01-A3C7-912BCC97CD0E")) PixelShaderInfoTracker final : public IUnknown
+{
+public:
+    PixelShaderInfoTracker(std::shared_ptr<PixelShaderInfoTable> table, ID3D11PixelShader* shader)
+        : m_table(std::move(table)), m_shader(shader)
+    {
+    }
+
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+    {
+        if ( ppvObject == nullptr ) return E_POINTER;
+        if ( riid == __uuidof(IUnknown) || riid == __uuidof(PixelShaderInfoTracker) )
+        {
+            AddRef();
+            *ppvObject = this;
+            return S_OK;
+        }
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    virtual ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return ++m_refCount;
+    }
+
+    virtual ULONG STDMETHODCALLTYPE Release() override
+    {
+        const ULONG ref = --m_refCount;
+        if ( ref == 0 )
+        {
+            delete this;
+        }
+        return ref;
+    }
+
+private:
+    ~PixelShaderInfoTracker()
+    {
+        auto lock = m_table->m_lock.lock_exclusive();
+        m_table->m_entries.erase( m_shader );
+    }
+
+    std::atomic<ULONG> m_refCount { 1 };
+    std::shared_ptr<PixelShaderInfoTable> m_table;
+    ID3D11PixelShader* m_shader; // Not owned, the tracker is released by the shader
+};
+
 D3D11Device::D3D11Device(wil::unique_hmodule module, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> immediateContext)
     : m_d3dModule( std::move(module), device ), m_orig( std::move(device) ),
-      m_colorGrading( this ), m_bloom( this ), m_lighting( this )
+      m_gpuProfiler( this ), m_renderTargetPool( this ), m_colorGrading( this, m_gpuProfiler, m_renderTargetPool ), m_bloom( this, m_gpuProfiler ), m_lighting( this, m_gpuProfiler ),
+      m_shaderReplacements( this, m_gpuProfiler ),
+      m_effects{ &m_colorGrading, &m_bloom, &m_lighting, &m_shaderReplacements } // Color grading offers its constant buffer to bloom before it sees the merger
 {
     m_orig.As(&m_origDxgi);
 
+#if VTABLE_THUNKS
+    ID3D11Device* deviceInterface = this;
+    VtableThunks::PatchForwardingSlots( deviceInterface, reinterpret_cast<char*>(&m_orig) - reinterpret_cast<char*>(deviceInterface), DEVICE_FORWARDED_SLOTS );
+#endif
+
     ComPtr<D3D11DeviceContext> context = Make<D3D11DeviceContext>( std::move(immediateContext), this );
     m_immediateContext = context.Detach();
 
     Effects::LoadSettings();
+    Effects::LoadShaderHashes();
+    m_shaderReplacements.LoadManifest();
+
+    // The device is free-threaded, so replacements don't need to be created inside the game's own Create calls.
+    // Effects that need a replacement before its job ran create it themselves
+    for ( Effects::Effect* effect : m_effects )
+    {
+        effect->PrecreateShaders( m_jobSystem );
+    }
+}
+
+D3D11Device::~D3D11Device()
+{
+    // Don't lose changes made right before the game shut down
+    Effects::FlushSettings();
 }
 
 ULONG STDMETHODCALLTYPE D3D11Device::Release()
@@ -65,6 +323,13 @@ ULONG STDMETHODCALLTYPE D3D11Device::Release()
 
 HRESULT STDMETHODCALLTYPE D3D11Device::QueryInterface(REFIID riid, void** ppvObject)
 {
+    if ( riid == __uuidof(D3D11Device) && ppvObject != nullptr )
+    {
+        AddRef();
+        *ppvObject = this;
+        return S_OK;
+    }
+
     HRESULT hr = __super::QueryInterface(riid, ppvObject);
     if ( FAILED(hr) )
     {
@@ -138,10 +403,30 @@ HRESULT STDMETHODCALLTYPE D3D11Device::CreatePixelShader(const void* pShaderByte
     HRESULT hr = m_orig->CreatePixelShader(pShaderBytecode, BytecodeLength, pClassLinkage, ppPixelShader);
     if ( SUCCEEDED(hr) )
     {
-        Effects::AnnotatePixelShader( *ppPixelShader, pShaderBytecode, BytecodeLength );
+        using namespace Effects;
+
+        ID3D11PixelShader* shader = *ppPixelShader;
 
-        m_bloom.CreateAlternatePixelShader( *ppPixelShader );
-        m_lighting.CreateAlternatePixelShader( *ppPixelShader );
+        // Only classify the shader here, effects create their replacements once they need them
+        PixelShaderInfo info;
+        info.m_type = AnnotatePixelShader( shader, pShaderBytecode, BytecodeLength );
+        if ( info.m_type == ResourceMetadata::Type::None )
+        {
+            // Built-in swaps take precedence over the manifest
+            m_shaderReplacements.ClassifyPixelShader( shader, pShaderBytecode, BytecodeLength, info );
+        }
+
+        // The entry is only stored if it can be removed again, otherwise a new shader allocated at the same address would inherit it
+        if ( info.m_type != ResourceMetadata::Type::None )
+        {
+            ComPtr<PixelShaderInfoTracker> tracker;
+            tracker.Attach( new(std::nothrow) PixelShaderInfoTracker( m_pixelShaderInfo, shader ) );
+            if ( tracker != nullptr && SUCCEEDED(shader->SetPrivateDataInterface( __uuidof(PixelShaderInfoTracker), tracker.Get() )) )
+            {
+                auto lock = m_pixelShaderInfo->m_lock.lock_exclusive();
+                m_pixelShaderInfo->m_entries.insert_or_assign( shader, info );
+            }
+        }
     }
     return hr;
 }
@@ -334,11 +619,36 @@ HRESULT STDMETHODCALLTYPE D3D11Device::GetUnderlyingInterface(REFIID riid, void*
     return m_orig.CopyTo(riid, ppvObject);
 }
 
+Effects::PixelShaderInfo D3D11Device::GetPixelShaderInfo(ID3D11PixelShader* shader) const
+{
+    {
+        auto lock = m_pixelShaderInfo->m_lock.lock_shared();
+
+        auto it = m_pixelShaderInfo->m_entries.find( shader );
+        if ( it != m_pixelShaderInfo->m_entries.end() ) return it->second;
+    }
+
+    // Replacement bloom merger has to be recognized by color grading too, in case the game sets it back after a PSGetShader
+    if ( m_bloom.IsAlternateMergerShader( shader ) ) return Effects::PixelShaderInfo { Effects::ResourceMetadata::Type::BloomMergerShader };
+
+    return {};
+}
+
+Effects::StateFilterStatistics& D3D11Device::GetStateFilterStatistics()
+{
+    return m_immediateContext->GetStateFilterStatistics();
+}
+
 // ====================================================
 
 D3D11DeviceContext::D3D11DeviceContext(ComPtr<ID3D11DeviceContext> context, ComPtr<D3D11Device> device)
-    : m_device(std::move(device)), m_orig(std::move(context))
+    : m_device(std::move(device)), m_orig(std::move(context)), m_effectHooks(m_device->GetEffects())
 {
+#if VTABLE_THUNKS
+    // Patches the class once, deferred contexts share the immediate context's vtable
+    ID3D11DeviceContext* contextInterface = this;
+    VtableThunks::PatchForwardingSlots( contextInterface, reinterpret_cast<char*>(&m_orig) - reinterpret_cast<char*>(contextInterface), DEVICE_CONTEXT_FORWARDED_SLOTS );
+#endif
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContext::QueryInterface(REFIID riid, void** ppvObject)
@@ -378,43 +688,126 @@ void STDMETHODCALLTYPE D3D11DeviceContext::VSSetConstantBuffers(UINT StartSlot,
 
 void STDMETHODCALLTYPE D3D11DeviceContext::PSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView* const* ppShaderResourceViews)
 {
+    auto trace = BeginTrace();
+    if ( trace )
+    {
+        trace.Record( Effects::CallType::PSSetShaderResources, StartSlot, NumViews, trace.GetObjectId(NumViews > 0 && ppShaderResourceViews != nullptr ? ppShaderResourceViews[0] : nullptr) );
+    }
+
+    if ( IsFilteredStateChange( Effects::StateFilterStatistics::Call::PSSetShaderResources, m_shadowState.AreShaderResourcesBound(StartSlot, NumViews, ppShaderResourceViews) ) ) return;
+
     m_orig->PSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+    m_shadowState.OnPSSetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::PSSetShader(ID3D11PixelShader* pPixelShader, ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
 {
-    ComPtr<ID3D11PixelShader> replacedShader; 
-    replacedShader = m_device->GetBloom().BeforePixelShaderSet(this, pPixelShader); // Returns pPixelShader if no change required
-    replacedShader = m_device->GetLighting().BeforePixelShaderSet(this, replacedShader.Get());
-    m_orig->PSSetShader(replacedShader.Get(), ppClassInstances, NumClassInstances);
-    m_device->GetColorGrading().OnPixelShaderSet(replacedShader.Get());
+    PROFILE_HOOK(PSSetShader);
+
+    auto trace = BeginTrace();
+
+    m_effectHooks.Update();
+    const Effects::EffectHooks::HookList& beforeHooks = m_effectHooks.Get(Effects::HookPoint::BeforePSSetShader);
+    const Effects::EffectHooks::HookList& afterHooks = m_effectHooks.Get(Effects::HookPoint::AfterPSSetShader);
+
+    // One lookup serves all effects - replacements are never "interesting" to any other effect,
+    // and the replaced bloom merger retains the original shader type. Skipped if nothing needs it
+    Effects::PixelShaderSet shaderSet { pPixelShader };
+    if ( trace || !beforeHooks.empty() || !afterHooks.empty() )
+    {
+        shaderSet.m_info = m_device->GetPixelShaderInfo(pPixelShader);
+    }
+
+    if ( trace )
+    {
+        trace.Record( Effects::CallType::PSSetShader, trace.GetObjectId(pPixelShader), static_cast<uint32_t>(shaderSet.m_info.m_type) );
+    }
+
+    const Effects::HookContext hookContext { this, m_orig.Get(), m_shadowState, m_effectHooks.GetSettings() };
+    for ( const Effects::EffectHooks::Hook& hook : beforeHooks )
+    {
+        hook.m_effect->BeforePSSetShader(hookContext, *hook.m_state, shaderSet);
+    }
+
+    if ( !IsFilteredStateChange( Effects::StateFilterStatistics::Call::PSSetShader, NumClassInstances == 0 && m_shadowState.IsPixelShaderBound(shaderSet.m_shader) ) )
+    {
+        PROFILE_FORWARD();
+        m_orig->PSSetShader(shaderSet.m_shader, ppClassInstances, NumClassInstances);
+        m_shadowState.OnPSSetShader(shaderSet.m_shader);
+    }
+
+    for ( const Effects::EffectHooks::Hook& hook : afterHooks )
+    {
+        hook.m_effect->AfterPSSetShader(hookContext, *hook.m_state, shaderSet);
+    }
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::PSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState* const* ppSamplers)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		trace.Record( Effects::CallType::PSSetSamplers, StartSlot, NumSamplers, trace.GetObjectId(NumSamplers > 0 && ppSamplers != nullptr ? ppSamplers[0] : nullptr) );
+	}
+
 	m_orig->PSSetSamplers(StartSlot, NumSamplers, ppSamplers);
+	m_shadowState.OnPSSetSamplers(StartSlot, NumSamplers, ppSamplers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::VSSetShader(ID3D11VertexShader* pVertexShader, ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		trace.Record( Effects::CallType::VSSetShader, trace.GetObjectId(pVertexShader) );
+	}
+
 	m_orig->VSSetShader(pVertexShader, ppClassInstances, NumClassInstances);
+	m_shadowState.OnVSSetShader(pVertexShader);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::DrawIndexed(UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation)
 {
-    if ( !m_device->GetLighting().OnDrawIndexed(m_orig.Get(), IndexCount, StartIndexLocation, BaseVertexLocation) )
+    PROFILE_HOOK(DrawIndexed);
+
+    auto trace = BeginTrace();
+    if ( trace )
     {
-        m_orig->DrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation);
+        trace.Record( Effects::CallType::DrawIndexed, IndexCount, StartIndexLocation, static_cast<uint32_t>(BaseVertexLocation) );
     }
+
+    // The first effect drawing in place of the game ends the chain
+    m_effectHooks.Update();
+    const Effects::HookContext hookContext { this, m_orig.Get(), m_shadowState, m_effectHooks.GetSettings() };
+    for ( const Effects::EffectHooks::Hook& hook : m_effectHooks.Get(Effects::HookPoint::DrawIndexed) )
+    {
+        if ( hook.m_effect->OnDrawIndexed(hookContext, *hook.m_state, IndexCount, StartIndexLocation, BaseVertexLocation) ) return;
+    }
+
+    PROFILE_FORWARD();
+    m_orig->DrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::Draw(UINT VertexCount, UINT StartVertexLocation)
 {
-    m_device->GetColorGrading().BeforeDraw(this, VertexCount, StartVertexLocation);
-    if ( !m_device->GetBloom().OnDraw(m_orig.Get(), VertexCount, StartVertexLocation) )
+    PROFILE_HOOK(Draw);
+
+    auto trace = BeginTrace();
+    if ( trace )
     {
-        m_orig->Draw(VertexCount, StartVertexLocation);
+        trace.Record( Effects::CallType::Draw, VertexCount, StartVertexLocation );
     }
+
+    // The first effect drawing in place of the game ends the chain
+    m_effectHooks.Update();
+    const Effects::HookContext hookContext { this, m_orig.Get(), m_shadowState, m_effectHooks.GetSettings() };
+    for ( const Effects::EffectHooks::Hook& hook : m_effectHooks.Get(Effects::HookPoint::Draw) )
+    {
+        if ( hook.m_effect->OnDraw(hookContext, *hook.m_state, VertexCount, StartVertexLocation) ) return;
+    }
+
+    PROFILE_FORWARD();
+    m_orig->Draw(VertexCount, StartVertexLocation);
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContext::Map(ID3D11Resource* pResource, UINT Subresource, D3D11_MAP MapType, UINT MapFlags, D3D11_MAPPED_SUBRESOURCE* pMappedResource)
@@ -429,17 +822,42 @@ void STDMETHODCALLTYPE D3D11DeviceContext::Unmap(ID3D11Resource* pResource, UINT
 
 void STDMETHODCALLTYPE D3D11DeviceContext::PSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		trace.Record( Effects::CallType::PSSetConstantBuffers, StartSlot, NumBuffers, trace.GetObjectId(NumBuffers > 0 && ppConstantBuffers != nullptr ? ppConstantBuffers[0] : nullptr) );
+	}
+
+	if ( IsFilteredStateChange( Effects::StateFilterStatistics::Call::PSSetConstantBuffers, m_shadowState.AreConstantBuffersBound(StartSlot, NumBuffers, ppConstantBuffers) ) ) return;
+
 	m_orig->PSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+	m_shadowState.OnPSSetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::IASetInputLayout(ID3D11InputLayout* pInputLayout)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		trace.Record( Effects::CallType::IASetInputLayout, trace.GetObjectId(pInputLayout) );
+	}
+
 	m_orig->IASetInputLayout(pInputLayout);
+	m_shadowState.OnIASetInputLayout(pInputLayout);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::IASetVertexBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppVertexBuffers, const UINT* pStrides, const UINT* pOffsets)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		trace.Record( Effects::CallType::IASetVertexBuffers, StartSlot, NumBuffers, trace.GetObjectId(NumBuffers > 0 && ppVertexBuffers != nullptr ? ppVertexBuffers[0] : nullptr) );
+	}
+
+	if ( IsFilteredStateChange( Effects::StateFilterStatistics::Call::IASetVertexBuffers, m_shadowState.IsVertexBufferBound(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets) ) ) return;
+
 	m_orig->IASetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
+	m_shadowState.OnIASetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::IASetIndexBuffer(ID3D11Buffer* pIndexBuffer, DXGI_FORMAT Format, UINT Offset)
@@ -449,12 +867,23 @@ void STDMETHODCALLTYPE D3D11DeviceContext::IASetIndexBuffer(ID3D11Buffer* pIndex
 
 void STDMETHODCALLTYPE D3D11DeviceContext::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
 {
-	m_orig->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+    Effects::DrawCall drawCall { Effects::DrawCall::Type::DrawIndexedInstanced };
+    drawCall.m_args[0] = IndexCountPerInstance;
+    drawCall.m_args[1] = InstanceCount;
+    drawCall.m_args[2] = StartIndexLocation;
+    drawCall.m_args[3] = static_cast<UINT>(BaseVertexLocation);
+    drawCall.m_args[4] = StartInstanceLocation;
+    DispatchOtherDraw(drawCall);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
 {
-	m_orig->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+    Effects::DrawCall drawCall { Effects::DrawCall::Type::DrawInstanced };
+    drawCall.m_args[0] = VertexCountPerInstance;
+    drawCall.m_args[1] = InstanceCount;
+    drawCall.m_args[2] = StartVertexLocation;
+    drawCall.m_args[3] = StartInstanceLocation;
+    DispatchOtherDraw(drawCall);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::GSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers)
@@ -514,19 +943,65 @@ void STDMETHODCALLTYPE D3D11DeviceContext::GSSetSamplers(UINT StartSlot, UINT Nu
 
 void STDMETHODCALLTYPE D3D11DeviceContext::OMSetRenderTargets(UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView)
 {
-    m_device->GetColorGrading().BeforeOMSetRenderTargets( m_orig.Get(), NumViews, ppRenderTargetViews, pDepthStencilView );
+    PROFILE_HOOK(OMSetRenderTargets);
+
+    auto trace = BeginTrace();
+    if ( trace )
+    {
+        trace.Record( Effects::CallType::OMSetRenderTargets, NumViews, trace.GetObjectId(NumViews > 0 && ppRenderTargetViews != nullptr ? ppRenderTargetViews[0] : nullptr), trace.GetObjectId(pDepthStencilView) );
+    }
+
+    m_effectHooks.Update();
+    const Effects::HookContext hookContext { this, m_orig.Get(), m_shadowState, m_effectHooks.GetSettings() };
+    for ( const Effects::EffectHooks::Hook& hook : m_effectHooks.Get(Effects::HookPoint::BeforeOMSetRenderTargets) )
+    {
+        hook.m_effect->BeforeOMSetRenderTargets(hookContext, *hook.m_state, NumViews, ppRenderTargetViews, pDepthStencilView);
+    }
+
+    PROFILE_FORWARD();
     m_orig->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
+    m_shadowState.OnOMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::OMSetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView, UINT UAVStartSlot, UINT NumUAVs, ID3D11UnorderedAccessView* const* ppUnorderedAccessViews, const UINT* pUAVInitialCounts)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		// NumRTVs may be D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, in which case the views are not read
+		const bool setsRenderTargets = NumRTVs != D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL;
+		trace.Record( Effects::CallType::OMSetRenderTargetsAndUnorderedAccessViews, NumRTVs,
+			trace.GetObjectId(setsRenderTargets && NumRTVs > 0 && ppRenderTargetViews != nullptr ? ppRenderTargetViews[0] : nullptr),
+			trace.GetObjectId(setsRenderTargets ? pDepthStencilView : nullptr), UAVStartSlot, NumUAVs );
+	}
+
 	m_orig->OMSetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+	m_shadowState.OnOMSetRenderTargets(NumRTVs, ppRenderTargetViews, pDepthStencilView);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::OMSetBlendState(ID3D11BlendState* pBlendState, const FLOAT BlendFactor[4], UINT SampleMask)
 {
-    m_device->GetColorGrading().BeforeOMSetBlendState( this, pBlendState );
+    PROFILE_HOOK(OMSetBlendState);
+
+    auto trace = BeginTrace();
+    if ( trace )
+    {
+        trace.Record( Effects::CallType::OMSetBlendState, trace.GetObjectId(pBlendState) );
+    }
+
+    // Color grading heuristics need to see every call, including redundant ones
+    m_effectHooks.Update();
+    const Effects::HookContext hookContext { this, m_orig.Get(), m_shadowState, m_effectHooks.GetSettings() };
+    for ( const Effects::EffectHooks::Hook& hook : m_effectHooks.Get(Effects::HookPoint::BeforeOMSetBlendState) )
+    {
+        hook.m_effect->BeforeOMSetBlendState(hookContext, *hook.m_state, pBlendState);
+    }
+
+    if ( IsFilteredStateChange( Effects::StateFilterStatistics::Call::OMSetBlendState, m_shadowState.IsBlendStateBound(pBlendState, BlendFactor, SampleMask) ) ) return;
+
+    PROFILE_FORWARD();
     m_orig->OMSetBlendState(pBlendState, BlendFactor, SampleMask);
+    m_shadowState.OnOMSetBlendState(pBlendState, BlendFactor, SampleMask);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::OMSetDepthStencilState(ID3D11DepthStencilState* pDepthStencilState, UINT StencilRef)
@@ -541,17 +1016,23 @@ void STDMETHODCALLTYPE D3D11DeviceContext::SOSetTargets(UINT NumBuffers, ID3D11B
 
 void STDMETHODCALLTYPE D3D11DeviceContext::DrawAuto(void)
 {
-	m_orig->DrawAuto();
+    DispatchOtherDraw(Effects::DrawCall { Effects::DrawCall::Type::DrawAuto });
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::DrawIndexedInstancedIndirect(ID3D11Buffer* pBufferForArgs, UINT AlignedByteOffsetForArgs)
 {
-	m_orig->DrawIndexedInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+    Effects::DrawCall drawCall { Effects::DrawCall::Type::DrawIndexedInstancedIndirect };
+    drawCall.m_argsBuffer = pBufferForArgs;
+    drawCall.m_argsOffset = AlignedByteOffsetForArgs;
+    DispatchOtherDraw(drawCall);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::DrawInstancedIndirect(ID3D11Buffer* pBufferForArgs, UINT AlignedByteOffsetForArgs)
 {
-	m_orig->DrawInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+    Effects::DrawCall drawCall { Effects::DrawCall::Type::DrawInstancedIndirect };
+    drawCall.m_argsBuffer = pBufferForArgs;
+    drawCall.m_argsOffset = AlignedByteOffsetForArgs;
+    DispatchOtherDraw(drawCall);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
@@ -566,7 +1047,16 @@ void STDMETHODCALLTYPE D3D11DeviceContext::DispatchIndirect(ID3D11Buffer* pBuffe
 
 void STDMETHODCALLTYPE D3D11DeviceContext::RSSetState(ID3D11RasterizerState* pRasterizerState)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		trace.Record( Effects::CallType::RSSetState, trace.GetObjectId(pRasterizerState) );
+	}
+
+	if ( IsFilteredStateChange( Effects::StateFilterStatistics::Call::RSSetState, m_shadowState.IsRasterizerStateBound(pRasterizerState) ) ) return;
+
 	m_orig->RSSetState(pRasterizerState);
+	m_shadowState.OnRSSetState(pRasterizerState);
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::RSSetViewports(UINT NumViewports, const D3D11_VIEWPORT* pViewports)
@@ -601,7 +1091,22 @@ void STDMETHODCALLTYPE D3D11DeviceContext::CopyStructureCount(ID3D11Buffer* pDst
 
 void STDMETHODCALLTYPE D3D11DeviceContext::ClearRenderTargetView(ID3D11RenderTargetView* pRenderTargetView, const FLOAT ColorRGBA[4])
 {
-    m_device->GetColorGrading().BeforeClearRenderTargetView( this, pRenderTargetView, ColorRGBA );
+    PROFILE_HOOK(ClearRenderTargetView);
+
+    auto trace = BeginTrace();
+    if ( trace )
+    {
+        trace.Record( Effects::CallType::ClearRenderTargetView, trace.GetObjectId(pRenderTargetView) );
+    }
+
+    m_effectHooks.Update();
+    const Effects::HookContext hookContext { this, m_orig.Get(), m_shadowState, m_effectHooks.GetSettings() };
+    for ( const Effects::EffectHooks::Hook& hook : m_effectHooks.Get(Effects::HookPoint::BeforeClearRenderTargetView) )
+    {
+        hook.m_effect->BeforeClearRenderTargetView(hookContext, *hook.m_state, pRenderTargetView, ColorRGBA);
+    }
+
+    PROFILE_FORWARD();
     m_orig->ClearRenderTargetView(pRenderTargetView, ColorRGBA);
 }
 
@@ -642,7 +1147,18 @@ void STDMETHODCALLTYPE D3D11DeviceContext::ResolveSubresource(ID3D11Resource* pD
 
 void STDMETHODCALLTYPE D3D11DeviceContext::ExecuteCommandList(ID3D11CommandList* pCommandList, BOOL RestoreContextState)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		trace.Record( Effects::CallType::ExecuteCommandList, trace.GetObjectId(pCommandList), static_cast<uint32_t>(RestoreContextState) );
+	}
+
 	m_orig->ExecuteCommandList(pCommandList, RestoreContextState);
+	if ( RestoreContextState == FALSE )
+	{
+		// Context state is cleared after executing the command list
+		m_shadowState.OnClearState();
+	}
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::HSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView* const* ppShaderResourceViews)
@@ -692,7 +1208,14 @@ void STDMETHODCALLTYPE D3D11DeviceContext::CSSetShaderResources(UINT StartSlot,
 
 void STDMETHODCALLTYPE D3D11DeviceContext::CSSetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs, ID3D11UnorderedAccessView* const* ppUnorderedAccessViews, const UINT* pUAVInitialCounts)
 {
+	auto trace = BeginTrace();
+	if ( trace )
+	{
+		trace.Record( Effects::CallType::CSSetUnorderedAccessViews, StartSlot, NumUAVs, trace.GetObjectId(NumUAVs > 0 && ppUnorderedAccessViews != nullptr ? ppUnorderedAccessViews[0] : nullptr) );
+	}
+
 	m_orig->CSSetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+	m_shadowState.OnCSSetUnorderedAccessViews();
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::CSSetShader(ID3D11ComputeShader* pComputeShader, ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
@@ -902,8 +1425,20 @@ void STDMETHODCALLTYPE D3D11DeviceContext::CSGetConstantBuffers(UINT StartSlot,
 
 void STDMETHODCALLTYPE D3D11DeviceContext::ClearState(void)
 {
-    m_device->GetColorGrading().ClearState();
+    auto trace = BeginTrace();
+    if ( trace )
+    {
+        trace.Record( Effects::CallType::ClearState );
+    }
+
+    m_effectHooks.Update();
+    for ( const Effects::EffectHooks::Hook& hook : m_effectHooks.Get(Effects::HookPoint::ClearState) )
+    {
+        hook.m_effect->OnClearState(*hook.m_state);
+    }
+
     m_orig->ClearState();
+    m_shadowState.OnClearState();
 }
 
 void STDMETHODCALLTYPE D3D11DeviceContext::Flush(void)
@@ -923,10 +1458,76 @@ UINT STDMETHODCALLTYPE D3D11DeviceContext::GetContextFlags(void)
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContext::FinishCommandList(BOOL RestoreDeferredContextState, ID3D11CommandList** ppCommandList)
 {
-    return m_orig->FinishCommandList(RestoreDeferredContextState, ppCommandList);
+    auto trace = BeginTrace();
+
+    const HRESULT hr = m_orig->FinishCommandList(RestoreDeferredContextState, ppCommandList);
+    if ( trace )
+    {
+        // Recorded once the command list exists, so ExecuteCommandList calls can be matched to it
+        trace.Record( Effects::CallType::FinishCommandList, trace.GetObjectId(SUCCEEDED(hr) && ppCommandList != nullptr ? *ppCommandList : nullptr), static_cast<uint32_t>(RestoreDeferredContextState) );
+    }
+    if ( RestoreDeferredContextState == FALSE )
+    {
+        // Deferred context state is cleared after recording the command list
+        m_shadowState.OnClearState();
+    }
+    return hr;
 }
 
 HRESULT STDMETHODCALLTYPE D3D11DeviceContext::GetUnderlyingInterface(REFIID riid, void** ppvObject)
 {
     return m_orig.CopyTo(riid, ppvObject);
 }
+
+Effects::TraceCapture::CallGuard D3D11DeviceContext::BeginTrace()
+{
+    return m_device->GetTraceCapture().BeginCall(static_cast<ID3D11DeviceContext*>(this));
+}
+
+bool D3D11DeviceContext::IsFilteredStateChange(Effects::StateFilterStatistics::Call call, bool redundant)
+{
+    m_stateFilterStatistics.Count(call, redundant);
+    if ( !redundant ) return false;
+
+    m_effectHooks.Update();
+    return m_effectHooks.GetSettings().filterRedundantState;
+}
+
+void D3D11DeviceContext::DispatchOtherDraw(const Effects::DrawCall& drawCall)
+{
+    PROFILE_HOOK(OtherDraw);
+
+    auto trace = BeginTrace();
+    if ( trace )
+    {
+        switch ( drawCall.m_type )
+        {
+        case Effects::DrawCall::Type::DrawInstanced:
+            trace.Record( Effects::CallType::DrawInstanced, drawCall.m_args[0], drawCall.m_args[1], drawCall.m_args[2], drawCall.m_args[3] );
+            break;
+        case Effects::DrawCall::Type::DrawIndexedInstanced:
+            trace.Record( Effects::CallType::DrawIndexedInstanced, drawCall.m_args[0], drawCall.m_args[1], drawCall.m_args[2], drawCall.m_args[3], drawCall.m_args[4] );
+            break;
+        case Effects::DrawCall::Type::DrawInstancedIndirect:
+            trace.Record( Effects::CallType::DrawInstancedIndirect, trace.GetObjectId(drawCall.m_argsBuffer), drawCall.m_argsOffset );
+            break;
+        case Effects::DrawCall::Type::DrawIndexedInstancedIndirect:
+            trace.Record( Effects::CallType::DrawIndexedInstancedIndirect, trace.GetObjectId(drawCall.m_argsBuffer), drawCall.m_argsOffset );
+            break;
+        case Effects::DrawCall::Type::DrawAuto:
+            trace.Record( Effects::CallType::DrawAuto );
+            break;
+        }
+    }
+
+    // The first effect drawing in place of the game ends the chain
+    m_effectHooks.Update();
+    const Effects::HookContext hookContext { this, m_orig.Get(), m_shadowState, m_effectHooks.GetSettings() };
+    for ( const Effects::EffectHooks::Hook& hook : m_effectHooks.Get(Effects::HookPoint::OtherDraw) )
+    {
+        if ( hook.m_effect->OnOtherDraw(hookContext, *hook.m_state, drawCall) ) return;
+    }
+
+    PROFILE_FORWARD();
+    drawCall.Issue(m_orig.Get());
+}
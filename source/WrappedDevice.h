@@ -6,6 +6,7 @@
 #include <wrl/client.h>
 #include "wil/resource.h"
 #include <memory>
+#include <unordered_map>
 
 #include "WrappedExtension.h"
 
@@ -13,9 +14,26 @@
 #include "effects/ColorGrading.h"
 #include "effects/Bloom.h"
 #include "effects/Lighting.h"
+#include "effects/ShaderReplacements.h"
+#include "effects/EffectHooks.h"
+#include "effects/GPUProfiler.h"
+#include "effects/JobSystem.h"
+#include "effects/TraceCapture.h"
+#include "effects/RenderTargetPool.h"
+#include "effects/ShadowState.h"
+#include "effects/StateFilterStatistics.h"
 
 using namespace Microsoft::WRL;
 
+// Classification of "interesting" pixel shaders, filled on creation - unclassified shaders are not stored.
+// Shaders can be created from any thread, so the table needs a lock. Entries are removed when their shaders are destroyed
+// by a tracker attached to each shader, which shares the table - shaders may outlive the device wrapper.
+struct PixelShaderInfoTable
+{
+    wil::srwlock m_lock;
+    std::unordered_map<ID3D11PixelShader*, Effects::PixelShaderInfo> m_entries;
+};
+
 
 // Wrapped D3D11 device which is mostly passthrough,
 // but logs some additional information about shaders which need to be modified
@@ -24,10 +42,12 @@ using namespace Microsoft::WRL;
 // We implement ID3D11Device and ID3D11DeviceContext together with their corresponding DXGI interfaces,
 // and any additional data which has to be stored in D3D11 resources gets included as their private data.
 // This allows us to avoid wrapping them, while still allowing to associate additional data with them.
-class D3D11Device final : public RuntimeClass< RuntimeClassFlags<ClassicCom>, ID3D11Device, ChainInterfaces<IDXGIDevice1, IDXGIDevice, IDXGIObject>, IWrapperObject >
+// DXGI wrappers can query for D3D11Device itself to access the effects.
+class __declspec(uuid("8D3C4E1A-6B52-4F0E-9A7D-2C5B8E41F693")) D3D11Device final : public RuntimeClass< RuntimeClassFlags<ClassicCom>, ID3D11Device, ChainInterfaces<IDXGIDevice1, IDXGIDevice, IDXGIObject>, IWrapperObject >
 {
 public:
     D3D11Device( wil::unique_hmodule module, ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> immediateContext );
+    virtual ~D3D11Device() override;
 
     virtual ULONG STDMETHODCALLTYPE Release() override; // Overload to release immediate device context explicitly
     virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override; // Overload to allow DXGI to query for internal, undocumented interfaces
@@ -88,9 +108,14 @@ public:
     virtual HRESULT STDMETHODCALLTYPE GetUnderlyingInterface(REFIID riid, void** ppvObject) override;
 
     // DXHR effects accessors
-    Effects::ColorGrading& GetColorGrading() { return m_colorGrading; }
-    Effects::Bloom& GetBloom() { return m_bloom; }
-    Effects::Lighting& GetLighting() { return m_lighting; }
+    const std::vector<Effects::Effect*>& GetEffects() const { return m_effects; }
+    Effects::GPUProfiler& GetGPUProfiler() { return m_gpuProfiler; }
+    Effects::TraceCapture& GetTraceCapture() { return m_traceCapture; }
+    Effects::RenderTargetPool& GetRenderTargetPool() { return m_renderTargetPool; }
+    Effects::StateFilterStatistics& GetStateFilterStatistics(); // Of the immediate context
+    size_t GetDroppedShaderJobs() const { return m_jobSystem.GetDroppedJobs(); } // Replacements created on first use, as the job queue was full
+
+    Effects::PixelShaderInfo GetPixelShaderInfo( ID3D11PixelShader* shader ) const;
 
 private:
     SafeUniqueHmodule m_d3dModule;
@@ -101,10 +126,22 @@ private:
     // when D3D11Device's reference count has reached 1 (as in, only immediate context references it)
     class D3D11DeviceContext* m_immediateContext = nullptr;
 
+    std::shared_ptr<PixelShaderInfoTable> m_pixelShaderInfo = std::make_shared<PixelShaderInfoTable>();
+
+    // Must be declared before the effects, as they hold a reference to it
+    Effects::GPUProfiler m_gpuProfiler;
+    Effects::TraceCapture m_traceCapture;
+    Effects::RenderTargetPool m_renderTargetPool;
+
     // DXHR effects
     Effects::ColorGrading m_colorGrading;
     Effects::Bloom m_bloom;
     Effects::Lighting m_lighting;
+    Effects::ShaderReplacements m_shaderReplacements;
+    std::vector<Effects::Effect*> m_effects; // Contexts call their hooks in this order
+
+    // Precreates replacement shaders in the background - declared after the effects, so its jobs stop before they are destroyed
+    Effects::JobSystem m_jobSystem;
 };
 
 class D3D11DeviceContext final : public RuntimeClass< RuntimeClassFlags<ClassicCom>, ChainInterfaces<ID3D11DeviceContext, ID3D11DeviceChild>, IWrapperObject >
@@ -230,7 +267,25 @@ public:
     // IWrapperObject
     virtual HRESULT STDMETHODCALLTYPE GetUnderlyingInterface(REFIID riid, void** ppvObject) override;
 
+    Effects::StateFilterStatistics& GetStateFilterStatistics() { return m_stateFilterStatistics; }
+
 private:
+    // Recording scope of a call made on this context, see TraceCapture
+    Effects::TraceCapture::CallGuard BeginTrace();
+
+    // Counts the state setting call, returns true if it should not be forwarded to m_orig
+    bool IsFilteredStateChange( Effects::StateFilterStatistics::Call call, bool redundant );
+
+    // Runs the OtherDraw hooks, forwards the call to m_orig if no effect drew in place of the game
+    void DispatchOtherDraw( const Effects::DrawCall& drawCall );
+
     ComPtr<D3D11Device> m_device;
     ComPtr<ID3D11DeviceContext> m_orig;
+
+    // State bound by the game, so effects don't need to query it from m_orig
+    Effects::ShadowState m_shadowState;
+    Effects::StateFilterStatistics m_stateFilterStatistics;
+
+    // Effect state machines follow the calls made on this context only, so deferred contexts can be recorded in parallel
+    Effects::EffectHooks m_effectHooks;
 };
@@ -1,192 +1,149 @@
 #include "Bloom.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
 
-#include "../wil/resource.h"
+#include "ScopedPassState.h"
 
 #include "Bloom_shader.h"
+#include "bloom_merger_color_grading_ps.h"
 
-void Effects::Bloom::CreateAlternatePixelShader( ID3D11PixelShader* shader )
+static constexpr float SHADER1_CB_VALUES[4] = { 1.5f, 0.0f, 0.0f, 0.0f };
+static constexpr float SHADER4_CB_VALUES[4] = { 1.5f, 1.5f, 1.0f, 0.0f };
+
+// Shaders 1 and 4 only use 16 bytes of their constant buffer, but were defined to use 512 bytes
+static ID3D11Buffer* GetConstantBuffer( Effects::LazyResource<ID3D11Buffer>& buffer, ID3D11Device* device, const float (&values)[4] )
 {
-	const ResourceMetadata::Type shaderType = GetPixelShaderAnnotation( shader ).m_type;
+	return buffer.Get( [&]( ID3D11Buffer** constantBuffer ) {
+		float data[128] {};
+		std::copy( std::begin(values), std::end(values), data );
+
+		D3D11_BUFFER_DESC cbDesc {};
+		cbDesc.ByteWidth = sizeof(data);
+		cbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA initialData {};
+		initialData.pSysMem = data;
+		return device->CreateBuffer( &cbDesc, &initialData, constantBuffer );
+	} );
+}
 
-	if ( shaderType == ResourceMetadata::Type::BloomShader1 )
-	{
-		// Create an alternate shader
-		ComPtr<ID3D11PixelShader> alternateShader;
-		if ( SUCCEEDED(m_device->CreatePixelShader( BLOOM1_PS_BYTECODE, sizeof(BLOOM1_PS_BYTECODE), nullptr, alternateShader.GetAddressOf() )) )
-		{
-			shader->SetPrivateDataInterface( GUID_AlternateResource, alternateShader.Get() );
+void Effects::Bloom::PrecreateShaders( JobSystem& jobs )
+{
+	if ( GetSettingsSnapshot()->m_settings.bloomType == 0 ) return;
+
+	jobs.Submit( [this] { GetPixelShader( m_bloom1PS, m_device, BLOOM1_PS_BYTECODE ); } );
+	jobs.Submit( [this] { GetPixelShader( m_bloom3PS, m_device, BLOOM3_PS_BYTECODE ); } );
+	jobs.Submit( [this] { GetPixelShader( m_bloom4PS, m_device, BLOOM4_PS_BYTECODE ); } );
+	jobs.Submit( [this] { GetPixelShader( m_mergerPS, m_device, BLOOM_MERGER_PS_BYTECODE ); } );
+	jobs.Submit( [this] { GetPixelShader( m_mergerColorGradingPS, m_device, BLOOM_MERGER_COLOR_GRADING_PS_BYTECODE ); } );
+	jobs.Submit( [this] { GetConstantBuffer( m_shader1CB, m_device, SHADER1_CB_VALUES ); } );
+	jobs.Submit( [this] { GetConstantBuffer( m_shader4CB, m_device, SHADER4_CB_VALUES ); } );
+}
+
+Effects::HookMask Effects::Bloom::GetHooks( const Settings& settings ) const
+{
+	if ( settings.bloomType == 0 ) return 0;
+	return HookBit( HookPoint::BeforePSSetShader ) | HookBit( HookPoint::Draw );
+}
 
-			// CB used by this shader
-			const float data[128] = { 1.5f, 0.0f, 0.0f, 0.0f }; // Only 16 bytes are used but shader was defined to use 512 bytes
+void Effects::Bloom::BeforePSSetShader( const HookContext& hook, EffectContextState& effectState, PixelShaderSet& shaderSet )
+{
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	contextState.m_colorGradingCB = nullptr;
+	contextState.m_state = State::Initial;
 
-			D3D11_BUFFER_DESC cbDesc {};
-			cbDesc.ByteWidth = sizeof(data);
-			cbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-			cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	// Bound by the wrapped context, so the game's state is updated too
+	ID3D11DeviceContext* context = hook.m_wrappedContext;
+	const PixelShaderInfo& info = shaderSet.m_info;
 
-			D3D11_SUBRESOURCE_DATA initialData {};
-			initialData.pSysMem = data;
-			m_device->CreateBuffer( &cbDesc, &initialData, m_shader1CB.ReleaseAndGetAddressOf() );
+	if ( info.m_type == ResourceMetadata::Type::BloomShader1 ) // Bloom shader 1 - replace shader and bind a custom constant buffer
+	{
+		if ( ID3D11PixelShader* alternateShader = GetPixelShader( m_bloom1PS, m_device, BLOOM1_PS_BYTECODE ) )
+		{
+			ID3D11Buffer* constantBuffer = GetConstantBuffer( m_shader1CB, m_device, SHADER1_CB_VALUES );
+			context->PSSetConstantBuffers( 3, 1, &constantBuffer );
+			shaderSet.m_shader = alternateShader;
 		}
-		return;
 	}
-
-	if ( shaderType == ResourceMetadata::Type::BloomShader2 )
+	else if ( info.m_type == ResourceMetadata::Type::BloomShader2 ) // Bloom shader 2 - don't replace, but advance the state machine
 	{
-		// Alternate shader is not used instead of this one during the first draw, but it is during the following draw with the same shader
-		m_device->CreatePixelShader( BLOOM3_PS_BYTECODE, sizeof(BLOOM3_PS_BYTECODE), nullptr, m_bloom3PS.ReleaseAndGetAddressOf() );
-		return;
+		contextState.m_state = State::Bloom2Set;
 	}
-
-	if ( shaderType == ResourceMetadata::Type::BloomShader4 )
+	else if ( info.m_type == ResourceMetadata::Type::BloomShader4 ) // Bloom shader 4 - replace shader and bind a custom constant buffer
 	{
-		// Create an alternate shader
-		ComPtr<ID3D11PixelShader> alternateShader;
-		if ( SUCCEEDED(m_device->CreatePixelShader( BLOOM4_PS_BYTECODE, sizeof(BLOOM4_PS_BYTECODE), nullptr, alternateShader.GetAddressOf() )) )
+		if ( ID3D11PixelShader* alternateShader = GetPixelShader( m_bloom4PS, m_device, BLOOM4_PS_BYTECODE ) )
 		{
-			shader->SetPrivateDataInterface( GUID_AlternateResource, alternateShader.Get() );
-
-			// CB used by this shader
-			const float data[128] = { 1.5f, 1.5f, 1.0f, 0.0f }; // Only 16 bytes are used but shader was defined to use 512 bytes
-
-			D3D11_BUFFER_DESC cbDesc {};
-			cbDesc.ByteWidth = sizeof(data);
-			cbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-			cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-
-			D3D11_SUBRESOURCE_DATA initialData {};
-			initialData.pSysMem = data;
-			m_device->CreateBuffer( &cbDesc, &initialData, m_shader4CB.ReleaseAndGetAddressOf() );
+			ID3D11Buffer* constantBuffer = GetConstantBuffer( m_shader4CB, m_device, SHADER4_CB_VALUES );
+			context->PSSetConstantBuffers( 3, 1, &constantBuffer );
+			shaderSet.m_shader = alternateShader;
 		}
-		return;
 	}
-
-	if ( shaderType == ResourceMetadata::Type::BloomMergerShader )
+	else if ( info.m_type == ResourceMetadata::Type::BloomMergerShader && !IsAlternateMergerShader( shaderSet.m_shader ) ) // Bloom merger - replace shader, then rebind inputs before drawing
 	{
-		// Create an alternate shader and also annotate it as a blur merger shader
-		ComPtr<ID3D11PixelShader> alternateShader;
-		if ( SUCCEEDED(m_device->CreatePixelShader( BLOOM_MERGER_PS_BYTECODE, sizeof(BLOOM_MERGER_PS_BYTECODE), nullptr, alternateShader.GetAddressOf() )) )
+		if ( ID3D11PixelShader* alternateShader = GetPixelShader( m_mergerPS, m_device, BLOOM_MERGER_PS_BYTECODE ) )
 		{
-			shader->SetPrivateDataInterface( GUID_AlternateResource, alternateShader.Get() );
-			AnnotatePixelShader( alternateShader.Get(), shaderType, true );
+			contextState.m_state = State::MergerPSFound;
+			shaderSet.m_shader = alternateShader;
+			if ( shaderSet.m_colorGradingCB != nullptr )
+			{
+				if ( ID3D11PixelShader* colorGradingShader = GetPixelShader( m_mergerColorGradingPS, m_device, BLOOM_MERGER_COLOR_GRADING_PS_BYTECODE ) )
+				{
+					contextState.m_colorGradingCB = shaderSet.m_colorGradingCB;
+					shaderSet.m_shader = colorGradingShader;
+					shaderSet.m_colorGradingFused = true;
+				}
+			}
 		}
-		return;
 	}
 }
 
-ComPtr<ID3D11PixelShader> Effects::Bloom::BeforePixelShaderSet( ID3D11DeviceContext* context, ID3D11PixelShader* shader )
+bool Effects::Bloom::OnDraw( const HookContext& hook, EffectContextState& effectState, UINT VertexCount, UINT StartVertexLocation )
 {
-	ComPtr<ID3D11PixelShader> result(shader);
-
-	if ( SETTINGS.bloomType == 0 ) return result;
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	ID3D11DeviceContext* context = hook.m_context;
+	ShadowState& shadowState = hook.m_shadowState;
 
-	m_state = State::Initial;
-	
-	ResourceMetadata meta;
-	UINT size = sizeof(meta);
-	if ( SUCCEEDED(shader->GetPrivateData(__uuidof(meta), &size, &meta)) )
+	if ( contextState.m_state == State::Bloom2Drawn )
 	{
-		if ( meta.m_type == ResourceMetadata::Type::BloomShader1 ) // Bloom shader 1 - replace shader and bind a custom constant buffer
-		{
-			ComPtr<ID3D11PixelShader> replacedShader;
-			size = sizeof(ID3D11PixelShader*);
-			if ( SUCCEEDED(shader->GetPrivateData(GUID_AlternateResource, &size, replacedShader.GetAddressOf())) )
-			{
-				result = std::move(replacedShader);
-
-				context->PSSetConstantBuffers( 3, 1, m_shader1CB.GetAddressOf() );
-			}
-		}
-		else if ( meta.m_type == ResourceMetadata::Type::BloomShader2 ) // Bloom shader 2 - don't replace, but advance the state machine
-		{
-			m_state = State::Bloom2Set;
-		}
-		else if ( meta.m_type == ResourceMetadata::Type::BloomShader4 ) // Bloom shader 4 - replace shader and bind a custom constant buffer
-		{
-			ComPtr<ID3D11PixelShader> replacedShader;
-			size = sizeof(ID3D11PixelShader*);
-			if ( SUCCEEDED(shader->GetPrivateData(GUID_AlternateResource, &size, replacedShader.GetAddressOf())) )
-			{
-				result = std::move(replacedShader);
+		contextState.m_state = State::Initial;
 
-				context->PSSetConstantBuffers( 3, 1, m_shader4CB.GetAddressOf() );
-			}
-		}
-		else if ( meta.m_type == ResourceMetadata::Type::BloomMergerShader ) // Bloom merger - replace shader, then rebind inputs before drawing
+		// Replace with an alternate bloom3 shader - it stays bound, so the game's state is updated too
+		if ( ID3D11PixelShader* bloom3PS = GetPixelShader( m_bloom3PS, m_device, BLOOM3_PS_BYTECODE ) )
 		{
-			ComPtr<ID3D11PixelShader> replacedShader;
-			size = sizeof(ID3D11PixelShader*);
-			if ( SUCCEEDED(shader->GetPrivateData(GUID_AlternateResource, &size, replacedShader.GetAddressOf())) )
-			{
-				result = std::move(replacedShader);
-
-				m_state = State::MergerPSFound;
-			}	
+			context->PSSetShader( bloom3PS, nullptr, 0 );
+			shadowState.OnPSSetShader( bloom3PS );
 		}
 	}
-	return result;
-}
-
-bool Effects::Bloom::OnDraw( ID3D11DeviceContext* context, UINT VertexCount, UINT StartVertexLocation )
-{
-	if ( m_state == State::Bloom2Drawn )
+	else if ( contextState.m_state == State::MergerPSFound )
 	{
-		m_state = State::Initial;
+		contextState.m_state = State::Initial;
 
-		// Replace with an alternate bloom3 shader
-		context->PSSetShader( m_bloom3PS.Get(), nullptr, 0 );
-	}
-	else if ( m_state == State::MergerPSFound )
-	{
-		m_state = State::Initial;
+		GPUProfiler::Scope profile( m_profiler, context, GPUProfiler::Pass::BloomMerger );
 
-		// Rebind inputs to match the modified shader
-		ID3D11ShaderResourceView* view[3]; // Warning - raw pointers!
-		context->PSGetShaderResources( 0, 3, view );
-		auto releaseSRV = wil::scope_exit([&] {
-			for ( auto* r : view )
-			{
-				if ( r != nullptr )
-				{
-					r->Release();
-				}
-			}
-		});
+		// Rebind inputs to match the modified shader, original resources are rebound after the draw
+		const ShadowState::State& state = shadowState.Get();
+		ScopedPassState passState( context, shadowState );
 
 		// SRV2 goes to SRV0, SRV0 goes to SRV1
-		ID3D11ShaderResourceView* const reboundSRV[] = { view[2], view[0] };
-		context->PSSetShaderResources( 0, _countof(reboundSRV), reboundSRV );
+		passState.SetShaderResource( 0, state.m_shaderResources[2] );
+		passState.SetShaderResource( 1, state.m_shaderResources[0] );
 
-		ID3D11Buffer* cb[3]; // Warning - raw pointers!
-		context->PSGetConstantBuffers( 3, 3, cb );
-		auto releaseCB = wil::scope_exit([&] {
-			for ( auto* r : cb )
-			{
-				if ( r != nullptr )
-				{
-					r->Release();
-				}
-			}
-		});
-
-		// CB5 goes to CB3
-		context->PSSetConstantBuffers( 3, 1, &cb[2] );
-
-		// Rebind the original resources after the draw
-		auto restore = wil::scope_exit([&] {
-			context->PSSetConstantBuffers( 3, 1, &cb[0] );
-
-			context->PSSetShaderResources( 0, _countof(view), view );
-		});
+		// CB5 goes to CB3, color grading parameters go to CB4
+		passState.SetConstantBuffer( 3, state.m_constantBuffers[5] );
+		if ( contextState.m_colorGradingCB != nullptr )
+		{
+			passState.SetConstantBuffer( 4, contextState.m_colorGradingCB );
+		}
 
 		context->Draw( VertexCount, StartVertexLocation );
 		return true;
 	}
-	else if ( m_state == State::Bloom2Set )
+	else if ( contextState.m_state == State::Bloom2Set )
 	{
-		m_state = State::Bloom2Drawn;
+		contextState.m_state = State::Bloom2Drawn;
 	}
 
 	return false;
@@ -3,7 +3,9 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 
-#include "Metadata.h"
+#include "Effect.h"
+#include "GPUProfiler.h"
+#include "LazyResource.h"
 
 using namespace Microsoft::WRL;
 
@@ -15,20 +17,9 @@ namespace Effects
 // - DXHR bloom consists of 4 distinct shaders, DXHR DC - of 3
 // - Constant buffers are different for draw 1 and 4
 // - Merger shader is different and has different inputs
-class Bloom
+// - If color grading allows it, a variant of the merger shader applying color grading to its output is used
+class Bloom : public Effect
 {
-public:
-	Bloom( ID3D11Device* device )
-		: m_device( device )
-	{
-	}
-
-	void CreateAlternatePixelShader( ID3D11PixelShader* shader );
-
-	// Machine state functions
-	ComPtr<ID3D11PixelShader> BeforePixelShaderSet( ID3D11DeviceContext* context, ID3D11PixelShader* shader );
-	bool OnDraw( ID3D11DeviceContext* context, UINT VertexCount, UINT StartVertexLocation );
-
 private:
 	enum class State
 	{
@@ -39,12 +30,42 @@ private:
 		MergerPSFound,
 	};
 
-	State m_state = State::Initial;
+public:
+	// State machine of a single device context, owned by the context
+	struct ContextState : EffectContextState
+	{
+		State m_state = State::Initial;
+		ID3D11Buffer* m_colorGradingCB = nullptr; // Owned by ColorGrading, set only if the merger about to be drawn applies color grading
+	};
+
+	Bloom( ID3D11Device* device, GPUProfiler& profiler )
+		: m_device( device ), m_profiler( profiler )
+	{
+	}
+
+	void PrecreateShaders( JobSystem& jobs ) override;
+
+	HookMask GetHooks( const Settings& settings ) const override;
+	std::unique_ptr<EffectContextState> CreateContextState() const override { return std::make_unique<ContextState>(); }
+
+	// Machine state functions
+	void BeforePSSetShader( const HookContext& hook, EffectContextState& effectState, PixelShaderSet& shaderSet ) override;
+	bool OnDraw( const HookContext& hook, EffectContextState& effectState, UINT VertexCount, UINT StartVertexLocation ) override;
+
+	bool IsAlternateMergerShader( ID3D11PixelShader* shader ) const { return shader != nullptr && shader == m_mergerPS.Peek(); }
+
+private:
 	ID3D11Device* m_device; // Effect cannot outlive the device
+	GPUProfiler& m_profiler;
 
-	ComPtr<ID3D11PixelShader> m_bloom3PS; // Used instead of shader2 in the second draw
-	ComPtr<ID3D11Buffer> m_shader1CB; // (1.5, 0.0, 0.0, 0.0)
-	ComPtr<ID3D11Buffer> m_shader4CB; // (1.5, 1.5, 1.0, 0.0)
+	// Replacements are only created once bloom is enabled and the game sets the matching shader
+	LazyResource<ID3D11PixelShader> m_bloom1PS;
+	LazyResource<ID3D11PixelShader> m_bloom3PS; // Used instead of shader2 in the second draw
+	LazyResource<ID3D11PixelShader> m_bloom4PS;
+	LazyResource<ID3D11PixelShader> m_mergerPS;
+	LazyResource<ID3D11Buffer> m_shader1CB; // (1.5, 0.0, 0.0, 0.0)
+	LazyResource<ID3D11Buffer> m_shader4CB; // (1.5, 1.5, 1.0, 0.0)
+	LazyResource<ID3D11PixelShader> m_mergerColorGradingPS; // Used instead of the alternate merger shader if color grading is fused
 };
 
 };
\ No newline at end of file
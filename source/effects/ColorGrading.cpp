@@ -5,7 +5,12 @@
 
 #include "../wil/resource.h"
 
+#include "ColorGradingLut.h"
+#include "ScopedPassState.h"
 #include "ColorGrading_shader.h"
+#include "color_grading_lut_ps.h"
+#include "color_grading_cs.h"
+#include "color_grading_lut_cs.h"
 
 #define DEBUG_COLOR_GRADING_CALLS 0
 
@@ -24,90 +29,203 @@ static D3D11_TEXTURE2D_DESC GetTextureResourceDesc(const ComPtr<ID3D11Resource>&
 	return desc;
 }
 
-Effects::ColorGrading::ColorGrading(ID3D11Device* device)
-	: m_device(device)
+static bool IsBoundAsRenderTarget(const Effects::ShadowState& shadowState, ID3D11ShaderResourceView* view)
 {
-	m_device->CreatePixelShader( COLOR_GRADING_PS_BYTECODE, sizeof(COLOR_GRADING_PS_BYTECODE), nullptr, m_pixelShader.GetAddressOf() );
+	ComPtr<ID3D11Resource> viewResource;
+	view->GetResource( viewResource.GetAddressOf() );
 
-	D3D11_BUFFER_DESC cbDesc {};
-	cbDesc.ByteWidth = 512;
-	cbDesc.Usage = D3D11_USAGE_DYNAMIC;
-	cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	for ( ID3D11RenderTargetView* renderTarget : shadowState.Get().m_renderTargets )
+	{
+		if ( renderTarget != nullptr )
+		{
+			ComPtr<ID3D11Resource> renderTargetResource;
+			renderTarget->GetResource( renderTargetResource.GetAddressOf() );
+			if ( viewResource == renderTargetResource ) return true;
+		}
+	}
+	return false;
+}
 
-	m_device->CreateBuffer( &cbDesc, nullptr, m_constantBuffer.GetAddressOf() );
+// Color graded output is clamped and quantized the same way no matter if it's drawn in a separate pass or by the merger
+static bool IsUnormFormat(DXGI_FORMAT format)
+{
+	switch ( format )
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+		return true;
+	default:
+		return false;
+	}
 }
 
-void Effects::ColorGrading::OnPixelShaderSet(ID3D11PixelShader* shader)
+Effects::ColorGrading::ColorGrading(ID3D11Device* device, GPUProfiler& profiler, RenderTargetPool& renderTargets)
+	: m_device(device), m_profiler(profiler), m_renderTargets(renderTargets)
 {
-	if ( !SETTINGS.colorGradingEnabled ) return;
+}
+
+void Effects::ColorGrading::PrecreateShaders(JobSystem& jobs)
+{
+	jobs.Submit( [this] { GetPixelShader( m_pixelShader, m_device, COLOR_GRADING_PS_BYTECODE ); } );
+	jobs.Submit( [this] { GetComputeShader( m_computeShader, m_device, COLOR_GRADING_CS_BYTECODE ); } );
+	jobs.Submit( [this] { GetComputeShader( m_lutComputeShader, m_device, COLOR_GRADING_LUT_CS_BYTECODE ); } );
+}
+
+Effects::HookMask Effects::ColorGrading::GetHooks(const Settings& settings) const
+{
+	if ( !settings.colorGradingEnabled ) return 0;
+	return HookBit( HookPoint::BeforePSSetShader ) | HookBit( HookPoint::AfterPSSetShader ) | HookBit( HookPoint::Draw ) |
+		HookBit( HookPoint::BeforeOMSetRenderTargets ) | HookBit( HookPoint::BeforeOMSetBlendState ) | HookBit( HookPoint::BeforeClearRenderTargetView ) |
+		HookBit( HookPoint::ClearState );
+}
+
+void Effects::ColorGrading::BeforePSSetShader(const HookContext& /*hook*/, EffectContextState& effectState, PixelShaderSet& shaderSet)
+{
+	const ContextState& contextState = static_cast<const ContextState&>(effectState);
+	if ( contextState.m_mergerFusable )
+	{
+		shaderSet.m_colorGradingCB = contextState.m_constantBuffer.Get();
+	}
+}
 
-	const ResourceMetadata::Type shaderType = GetPixelShaderAnnotation( shader ).m_type;
+void Effects::ColorGrading::AfterPSSetShader(const HookContext& /*hook*/, EffectContextState& effectState, const PixelShaderSet& shaderSet)
+{
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	const ResourceMetadata::Type shaderType = shaderSet.m_info.m_type;
 
 	if ( shaderType == ResourceMetadata::Type::BloomMergerShader )
 	{
-		m_state = State::MergerCallFound;
+		// Previous frame never got to grading, so it can't vouch for fusing
+		if ( contextState.m_state != State::Initial )
+		{
+			contextState.m_mergerFusable = false;
+		}
+		contextState.m_state = State::MergerCallFound;
+		contextState.m_mergerFused = shaderSet.m_colorGradingFused;
 		return;
 	}
 
-	if ( m_state == State::MergerCallFound )
+	if ( contextState.m_state == State::MergerCallFound )
 	{
-		m_state = State::Initial; // Reset in case the required shader was "found" but changed before it was used
+		contextState.m_state = State::Initial; // Reset in case the required shader was "found" but changed before it was used
+		contextState.m_mergerFusable = false;
 		return;
 	}
 
-	if ( m_state == State::ResourcesGathered )
+	if ( contextState.m_state == State::ResourcesGathered )
 	{
 		// If setting to use Edge AA, ignore blend state changes
-		m_volatileData->m_edgeAADetected = shaderType == ResourceMetadata::Type::EdgeAA;
+		contextState.m_volatileData->m_edgeAADetected = shaderType == ResourceMetadata::Type::EdgeAA;
+		return;
+	}
+
+	if ( contextState.m_state == State::InputGraded )
+	{
+		// Edge AA is done and it has already output a color graded image
+		if ( shaderType != ResourceMetadata::Type::EdgeAA )
+		{
+			contextState.m_state = State::Initial;
+			contextState.m_volatileData.reset();
+		}
 	}
 }
 
-void Effects::ColorGrading::BeforeDraw( ID3D11DeviceContext* context, UINT VertexCount, UINT StartVertexLocation )
+bool Effects::ColorGrading::OnDraw( const HookContext& hook, EffectContextState& effectState, UINT VertexCount, UINT StartVertexLocation )
 {
-	if ( m_state == State::MergerCallFound )
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	ID3D11DeviceContext* context = hook.m_context;
+	const ShadowState& shadowState = hook.m_shadowState;
+
+	if ( contextState.m_state == State::MergerCallFound )
 	{
 		if ( VertexCount != 6 )
 		{
 			// Something went wrong, this draw call is not bloom postfx
-			m_state = State::Initial;
-			return;
+			contextState.m_state = State::Initial;
+			contextState.m_mergerFusable = false;
+			return false;
+		}
+
+		contextState.m_state = State::ResourcesGathered;
+
+		contextState.m_volatileData = std::make_optional<VolatileData>();
+		contextState.m_volatileData->m_fusedMerger = std::exchange( contextState.m_mergerFused, false );
+
+		const ShadowState::State& state = shadowState.Get();
+
+		ID3D11RenderTargetView* mergerOutputRTV = state.m_renderTargets[0];
+		if ( mergerOutputRTV != nullptr )
+		{
+			mergerOutputRTV->GetResource( contextState.m_volatileData->m_mergerOutputRT.GetAddressOf() );
+
+			D3D11_RENDER_TARGET_VIEW_DESC rtvDesc;
+			mergerOutputRTV->GetDesc( &rtvDesc );
+			contextState.m_volatileData->m_mergerOutputUnorm = IsUnormFormat( rtvDesc.Format );
+			contextState.m_volatileData->m_computeGrading = SupportsComputeGrading( contextState, GetTextureResourceDesc( contextState.m_volatileData->m_mergerOutputRT ) );
 		}
 
-		m_state = State::ResourcesGathered;
+		contextState.m_volatileData->m_blendState = state.m_blendState;
 
-		m_volatileData = std::make_optional<VolatileData>();
+		// DrawableBuffer and SceneBuffer, as the merger reads them - compute passes bind them themselves, so they can't be missing
+		contextState.m_volatileData->m_gameConstantBuffers[0] = state.m_constantBuffers[1];
+		contextState.m_volatileData->m_gameConstantBuffers[1] = state.m_constantBuffers[2];
+		if ( state.m_constantBuffers[1] == nullptr || state.m_constantBuffers[2] == nullptr )
+		{
+			contextState.m_volatileData->m_computeGrading = false;
+		}
+
+		// Only draws need the merger call state, but it's captured for compute passes too - a target which turns out
+		// not to support them is then drawn to in the same frame. The fused merger doesn't draw anything
+		if ( !contextState.m_volatileData->m_fusedMerger )
+		{
+			contextState.m_volatileData->m_vertexShader = state.m_vertexShader;
+			contextState.m_volatileData->m_inputLayout = state.m_inputLayout;
+			contextState.m_volatileData->m_rasterizerState = state.m_rasterizerState;
+			contextState.m_volatileData->m_vertexBuffer = std::make_tuple( state.m_vertexBuffer.m_buffer, state.m_vertexBuffer.m_stride, state.m_vertexBuffer.m_offset, StartVertexLocation );
+		}
 
-		context->VSGetShader( m_volatileData->m_vertexShader.GetAddressOf(), nullptr, nullptr );
-		context->IAGetInputLayout( m_volatileData->m_inputLayout.GetAddressOf() );
-		context->RSGetState( m_volatileData->m_rasterizerState.GetAddressOf() );
-		context->OMGetBlendState( m_volatileData->m_blendState.GetAddressOf(), nullptr, nullptr );
-		context->IAGetVertexBuffers( 0, 1, std::get<0>(m_volatileData->m_vertexBuffer).ReleaseAndGetAddressOf(),
-					&std::get<1>(m_volatileData->m_vertexBuffer), &std::get<2>(m_volatileData->m_vertexBuffer) );
-		std::get<3>(m_volatileData->m_vertexBuffer) = StartVertexLocation;
+		// Merger shader reads color grading parameters in this draw
+		if ( contextState.m_volatileData->m_fusedMerger )
+		{
+			UpdateConstantBuffer( context, contextState, hook.m_settings );
+		}
 
-		if ( !m_persistentData.has_value() )
+		if ( !contextState.m_persistentData.has_value() )
 		{
-			m_persistentData = std::make_optional<PersistentData>();
+			contextState.m_persistentData = std::make_optional<PersistentData>();
 		}
+		return false;
 	}
+
+	if ( contextState.m_state == State::ResourcesGathered || contextState.m_state == State::InputGraded )
+	{
+		if ( contextState.m_volatileData->m_edgeAADetected && !contextState.m_volatileData->m_fusedMerger )
+		{
+			return DrawWithGradedInput( context, contextState, shadowState, hook.m_settings, VertexCount, StartVertexLocation );
+		}
+	}
+
+	return false;
 }
 
-void Effects::ColorGrading::BeforeOMSetBlendState(ID3D11DeviceContext* context, ID3D11BlendState* pBlendState)
+void Effects::ColorGrading::BeforeOMSetBlendState(const HookContext& hook, EffectContextState& effectState, ID3D11BlendState* pBlendState)
 {
-	if ( m_state == State::ResourcesGathered )
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	ID3D11DeviceContext* context = hook.m_context;
+	const ShadowState& shadowState = hook.m_shadowState;
+
+	if ( contextState.m_state == State::ResourcesGathered )
 	{
 		// If setting to a different blend state to what we saved, draw
-		if ( !m_volatileData->m_edgeAADetected && m_volatileData->m_blendState.Get() != pBlendState )
+		if ( !contextState.m_volatileData->m_edgeAADetected && contextState.m_volatileData->m_blendState.Get() != pBlendState )
 		{
 			// Draw to current RTV0
-			ComPtr<ID3D11RenderTargetView> curRTV;
-			ComPtr<ID3D11DepthStencilView> curDSV;
-			context->OMGetRenderTargets( 1, curRTV.GetAddressOf(), curDSV.GetAddressOf() );
-			auto restoreRTV = wil::scope_exit([&] {
-				context->OMSetRenderTargets( 1, curRTV.GetAddressOf(), curDSV.Get() );
-			});
-
 #if DEBUG_COLOR_GRADING_CALLS
 			ComPtr<ID3DUserDefinedAnnotation> annotation;
 			if (SUCCEEDED(context->QueryInterface(IID_PPV_ARGS(annotation.GetAddressOf()))))
@@ -116,19 +234,23 @@ void Effects::ColorGrading::BeforeOMSetBlendState(ID3D11DeviceContext* context,
 			}
 #endif
 
-			DrawColorFilter( context, curRTV );
+			DrawColorFilter( context, contextState, shadowState, hook.m_settings, shadowState.Get().m_renderTargets[0] );
 		}
 	}
 }
 
-void Effects::ColorGrading::BeforeOMSetRenderTargets(ID3D11DeviceContext* context, UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView)
+void Effects::ColorGrading::BeforeOMSetRenderTargets(const HookContext& hook, EffectContextState& effectState, UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView)
 {
-	if ( m_state == State::ResourcesGathered )
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	ID3D11DeviceContext* context = hook.m_context;
+	const ShadowState& shadowState = hook.m_shadowState;
+
+	if ( contextState.m_state == State::ResourcesGathered )
 	{
 		// If unbinding the RTV, save it in case we need to render using our special case for additional blur
 		if ( NumViews == 0 && pDepthStencilView == nullptr )
 		{
-			context->OMGetRenderTargets( 1, m_volatileData->m_lastUnboundRTV.ReleaseAndGetAddressOf(), nullptr );
+			contextState.m_volatileData->m_lastUnboundRTV = shadowState.Get().m_renderTargets[0];
 			return;
 		}
 
@@ -140,10 +262,9 @@ void Effects::ColorGrading::BeforeOMSetRenderTargets(ID3D11DeviceContext* contex
 
 			const D3D11_TEXTURE2D_DESC desc = GetTextureResourceDesc( curRT );
 
-			if ( desc.Width < std::get<1>(m_persistentData->m_tempRT) && desc.Height < std::get<2>(m_persistentData->m_tempRT) )
+			if ( desc.Width < contextState.m_persistentData->m_tempRT.Get().m_desc.Width && desc.Height < contextState.m_persistentData->m_tempRT.Get().m_desc.Height )
 			{
 				// Draw to "last" RTV0
-				// No need to save/restore render targets as they will be overwritten
 #if DEBUG_COLOR_GRADING_CALLS
 				ComPtr<ID3DUserDefinedAnnotation> annotation;
 				if (SUCCEEDED(context->QueryInterface(IID_PPV_ARGS(annotation.GetAddressOf()))))
@@ -152,16 +273,20 @@ void Effects::ColorGrading::BeforeOMSetRenderTargets(ID3D11DeviceContext* contex
 				}
 #endif
 
-				DrawColorFilter( context, m_volatileData->m_lastUnboundRTV );
+				DrawColorFilter( context, contextState, shadowState, hook.m_settings, contextState.m_volatileData->m_lastUnboundRTV.Get() );
 			}
 			return;
 		}
 	}
 }
 
-void Effects::ColorGrading::BeforeClearRenderTargetView(ID3D11DeviceContext* context, ID3D11RenderTargetView* /*pRenderTargetView*/, const FLOAT /*ColorRGBA*/[4])
+void Effects::ColorGrading::BeforeClearRenderTargetView(const HookContext& hook, EffectContextState& effectState, ID3D11RenderTargetView* /*pRenderTargetView*/, const FLOAT /*ColorRGBA*/[4])
 {
-	if ( m_state == State::ResourcesGathered )
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	ID3D11DeviceContext* context = hook.m_context;
+	const ShadowState& shadowState = hook.m_shadowState;
+
+	if ( contextState.m_state == State::ResourcesGathered )
 	{
 		// If we got there before the other code paths, subtitles are disabled and we'd end up drawing the filter too late otherwise
 #if DEBUG_COLOR_GRADING_CALLS
@@ -172,80 +297,149 @@ void Effects::ColorGrading::BeforeClearRenderTargetView(ID3D11DeviceContext* con
 		}
 #endif
 
-		// Need to restore RTV/DSV afterwards in this case
-		ComPtr<ID3D11RenderTargetView> curRTV;
-		ComPtr<ID3D11DepthStencilView> curDSV;
-		context->OMGetRenderTargets( 1, curRTV.GetAddressOf(), curDSV.GetAddressOf() );
-		auto restoreRTV = wil::scope_exit([&] {
-			context->OMSetRenderTargets( 1, curRTV.GetAddressOf(), curDSV.Get() );
-		});
-
-		DrawColorFilter( context, m_volatileData->m_lastUnboundRTV );
+		DrawColorFilter( context, contextState, shadowState, hook.m_settings, contextState.m_volatileData->m_lastUnboundRTV.Get() );
 	}
 }
 
-void Effects::ColorGrading::ClearState()
+void Effects::ColorGrading::OnClearState(EffectContextState& effectState)
 {
-	m_persistentData.reset();
-	m_volatileData.reset();
-	m_state = State::Initial;
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	contextState.m_persistentData.reset();
+	contextState.m_volatileData.reset();
+	contextState.m_state = State::Initial;
+	contextState.m_mergerFusable = false;
+	contextState.m_mergerFused = false;
 }
 
-void Effects::ColorGrading::DrawColorFilter(ID3D11DeviceContext* context, const ComPtr<ID3D11RenderTargetView>& target)
+void Effects::ColorGrading::DrawColorFilter(ID3D11DeviceContext* context, ContextState& contextState, const ShadowState& shadowState, const Settings& settings, ID3D11RenderTargetView* target)
 {
-	m_state = State::Initial;
+	contextState.m_state = State::Initial;
 
 	ComPtr<ID3D11Resource> targetResource;
 	target->GetResource(targetResource.GetAddressOf());
 
-	const D3D11_TEXTURE2D_DESC desc = GetTextureResourceDesc( targetResource );
+	// Re-checked every frame, including fused ones - only fuse color grading into the merger if this frame graded exactly
+	// what the merger writes, and nothing (like Edge AA) read the merger output before grading
+	contextState.m_mergerFusable = !contextState.m_volatileData->m_edgeAADetected && targetResource == contextState.m_volatileData->m_mergerOutputRT &&
+		contextState.m_volatileData->m_mergerOutputUnorm;
+
+	// Bloom merger has already color graded its output and everything drawn from it
+	if ( contextState.m_volatileData->m_fusedMerger )
+	{
+		contextState.m_volatileData.reset();
+		return;
+	}
+
+	const D3D11_TEXTURE2D_DESC targetDesc = GetTextureResourceDesc( targetResource );
+	const bool compute = contextState.m_volatileData->m_computeGrading && SupportsComputeGrading( contextState, targetDesc );
+
+	CreateTempRT( contextState, targetDesc, compute );
 
-	// Recreate the temporary RT if dimensions don't match
-	if ( std::get<1>(m_persistentData->m_tempRT) != desc.Width || std::get<2>(m_persistentData->m_tempRT) != desc.Height )
+	// The game alternates between targets, so their views are cached by the pool
+	const RenderTargetPool::Target& tempRT = contextState.m_persistentData->m_tempRT.Get();
+	const ComPtr<ID3D11ShaderResourceView> targetSRV = m_renderTargets.GetShaderResourceView( targetResource.Get() );
+	if ( targetSRV != nullptr && (compute ? tempRT.m_uav != nullptr : tempRT.m_rtv != nullptr) )
 	{
-		m_device->CreateTexture2D( &desc, nullptr, std::get<0>(m_persistentData->m_tempRT).ReleaseAndGetAddressOf() );
-		m_device->CreateRenderTargetView( std::get<0>(m_persistentData->m_tempRT).Get(), nullptr, m_persistentData->m_tempRTV.ReleaseAndGetAddressOf() );
+		GPUProfiler::Scope profile( m_profiler, context, GPUProfiler::Pass::ColorGrading );
 
-		std::get<1>(m_persistentData->m_tempRT) = desc.Width;
-		std::get<2>(m_persistentData->m_tempRT) = desc.Height;
+		if ( compute )
+		{
+			DispatchColorFilterPass( context, contextState, shadowState, settings, targetSRV.Get(), tempRT, IsUnormFormat( targetDesc.Format ) );
+		}
+		else
+		{
+			DrawColorFilterPass( context, contextState, shadowState, settings, targetSRV.Get(), tempRT.m_rtv.Get(), IsUnormFormat( targetDesc.Format ) );
+		}
+		context->CopyResource( targetResource.Get(), tempRT.m_texture.Get() );
 	}
 
-	// Recreate the SRV if cached RT doesn't match
-	// It should be cheap to recreate so such low effort caching should be enough
-	if ( m_persistentData->m_lastOutputRT == nullptr || m_persistentData->m_lastOutputRT != targetResource )
+	contextState.m_volatileData.reset();
+}
+
+bool Effects::ColorGrading::DrawWithGradedInput(ID3D11DeviceContext* context, ContextState& contextState, const ShadowState& shadowState, const Settings& settings, UINT VertexCount, UINT StartVertexLocation)
+{
+	if ( contextState.m_volatileData->m_mergerOutputRT == nullptr ) return false;
+
+	// Find the bloom merger output among inputs of this draw
+	ID3D11ShaderResourceView* const (&views)[ShadowState::NUM_SHADER_RESOURCES] = shadowState.Get().m_shaderResources;
+
+	UINT inputSlot = 0;
+	for ( ; inputSlot < _countof(views); inputSlot++ )
 	{
-		m_persistentData->m_lastOutputRT = targetResource;
-		m_device->CreateShaderResourceView( targetResource.Get(), nullptr, m_persistentData->m_lastOutputSRV.ReleaseAndGetAddressOf() );
+		if ( views[inputSlot] != nullptr )
+		{
+			ComPtr<ID3D11Resource> resource;
+			views[inputSlot]->GetResource( resource.GetAddressOf() );
+			if ( resource == contextState.m_volatileData->m_mergerOutputRT ) break;
+		}
 	}
 
+	// Not reading from the bloom merger output, leave it to the regular path
+	if ( inputSlot == _countof(views) ) return false;
 
-	// Save states to restore them after drawing
-	ComPtr<ID3D11VertexShader> savedVertexShader;
-	ComPtr<ID3D11PixelShader> savedPixelShader;
-	ComPtr<ID3D11InputLayout> savedInputLayout;
-	ComPtr<ID3D11RasterizerState> savedRasterizerState;
-	ComPtr<ID3D11ShaderResourceView> savedSRV;
-	std::tuple< ComPtr<ID3D11Buffer>, UINT, UINT > savedInputBuffer;
-	ComPtr<ID3D11Buffer> savedConstantBuffer;
+	if ( contextState.m_state == State::ResourcesGathered )
+	{
+		CreateTempRT( contextState, GetTextureResourceDesc( contextState.m_volatileData->m_mergerOutputRT ), contextState.m_volatileData->m_computeGrading );
 
-	context->VSGetShader( savedVertexShader.GetAddressOf(), nullptr, nullptr );
-	context->PSGetShader( savedPixelShader.GetAddressOf(), nullptr, nullptr );
-	context->IAGetInputLayout( savedInputLayout.GetAddressOf() );
-	context->RSGetState( savedRasterizerState.GetAddressOf() );
-	context->PSGetShaderResources( 0, 1, savedSRV.GetAddressOf() );
-	context->IAGetVertexBuffers( 0, 1, std::get<0>(savedInputBuffer).GetAddressOf(), &std::get<1>(savedInputBuffer), &std::get<2>(savedInputBuffer) );
-	context->PSGetConstantBuffers( 5, 1, savedConstantBuffer.ReleaseAndGetAddressOf() );
+		// Temporary RT cannot be written to or read from, so leave it to the regular path
+		const RenderTargetPool::Target& tempRT = contextState.m_persistentData->m_tempRT.Get();
+		if ( (contextState.m_volatileData->m_computeGrading ? tempRT.m_uav == nullptr : tempRT.m_rtv == nullptr) || tempRT.m_srv == nullptr ) return false;
+	}
 
-	auto restore = wil::scope_exit([&] {
-		context->PSSetConstantBuffers( 5, 1, savedConstantBuffer.GetAddressOf() );
-		context->IASetVertexBuffers( 0, 1, std::get<0>(savedInputBuffer).GetAddressOf(), &std::get<1>(savedInputBuffer), &std::get<2>(savedInputBuffer) );
-		context->PSSetShaderResources( 0, 1, savedSRV.GetAddressOf() );
-		context->RSSetState( savedRasterizerState.Get() );
-		context->IASetInputLayout( savedInputLayout.Get() );
-		context->PSSetShader( savedPixelShader.Get(), nullptr, 0 );
-		context->VSSetShader( savedVertexShader.Get(), nullptr, 0 );		
+	// Park the state machine, so our own calls don't re-enter it
+	const State state = std::exchange( contextState.m_state, State::Initial );
+	auto restoreState = wil::scope_exit([&] {
+		contextState.m_state = State::InputGraded;
 	});
 
+	if ( state == State::ResourcesGathered )
+	{
+		GPUProfiler::Scope profile( m_profiler, context, GPUProfiler::Pass::ColorGrading );
+		if ( contextState.m_volatileData->m_computeGrading )
+		{
+			DispatchColorFilterPass( context, contextState, shadowState, settings, views[inputSlot], contextState.m_persistentData->m_tempRT.Get(), contextState.m_volatileData->m_mergerOutputUnorm );
+		}
+		else
+		{
+			DrawColorFilterPass( context, contextState, shadowState, settings, views[inputSlot], contextState.m_persistentData->m_tempRT.Get().m_rtv.Get(), contextState.m_volatileData->m_mergerOutputUnorm );
+		}
+	}
+
+	// Edge AA is in the way, so the next frame grades separately too
+	contextState.m_mergerFusable = false;
+
+	ScopedPassState passState( context, shadowState );
+	passState.SetShaderResource( inputSlot, contextState.m_persistentData->m_tempRT.Get().m_srv.Get() );
+	context->Draw( VertexCount, StartVertexLocation );
+
+	return true;
+}
+
+void Effects::ColorGrading::CreateTempRT(ContextState& contextState, const D3D11_TEXTURE2D_DESC& desc, bool compute)
+{
+	D3D11_TEXTURE2D_DESC tempDesc = desc;
+	if ( compute )
+	{
+		// Written by a compute shader and then copied or read from, never rendered to
+		tempDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE|D3D11_BIND_UNORDERED_ACCESS;
+		tempDesc.MiscFlags = 0;
+	}
+
+	// Borrow another temporary RT if dimensions don't match
+	if ( !contextState.m_persistentData->m_tempRT.Get().Matches( tempDesc ) )
+	{
+		contextState.m_persistentData->m_tempRT.Release();
+		contextState.m_persistentData->m_tempRT = m_renderTargets.Acquire( tempDesc );
+	}
+}
+
+void Effects::ColorGrading::DrawColorFilterPass(ID3D11DeviceContext* context, ContextState& contextState, const ShadowState& shadowState, const Settings& settings, ID3D11ShaderResourceView* source, ID3D11RenderTargetView* target, bool sourceUnorm)
+{
+	UpdateConstantBuffer( context, contextState, settings );
+
+	// LUT only covers 0.0-1.0 range, so other sources are always graded analytically
+	const bool useLut = settings.colorGradingLut && sourceUnorm && UpdateLut( context, settings );
+
 #if DEBUG_COLOR_GRADING_CALLS
 	ComPtr<ID3DUserDefinedAnnotation> annotation;
 	auto endEvent = wil::scope_exit([&] {
@@ -262,31 +456,199 @@ void Effects::ColorGrading::DrawColorFilter(ID3D11DeviceContext* context, const
 	}
 #endif
 
-	context->VSSetShader( m_volatileData->m_vertexShader.Get(), nullptr, 0 );
-	context->PSSetShader( m_pixelShader.Get(), nullptr, 0 );
-	context->IASetInputLayout( m_volatileData->m_inputLayout.Get() );
-	context->RSSetState( m_volatileData->m_rasterizerState.Get() );
+	// Game state is restored when this goes out of scope
+	ScopedPassState passState( context, shadowState );
 
-	context->OMSetRenderTargets( 1, m_persistentData->m_tempRTV.GetAddressOf(), nullptr );
+	passState.SetVertexShader( contextState.m_volatileData->m_vertexShader.Get() );
+	passState.SetPixelShader( useLut ? m_lutPixelShader.Get() : GetPixelShader( m_pixelShader, m_device, COLOR_GRADING_PS_BYTECODE ) );
+	passState.SetInputLayout( contextState.m_volatileData->m_inputLayout.Get() );
+	passState.SetRasterizerState( contextState.m_volatileData->m_rasterizerState.Get() );
 
-	context->IASetVertexBuffers( 0, 1, std::get<0>(m_volatileData->m_vertexBuffer).GetAddressOf(),
-			&std::get<1>(m_volatileData->m_vertexBuffer), &std::get<2>(m_volatileData->m_vertexBuffer) );
-	context->PSSetConstantBuffers( 5, 1, m_constantBuffer.GetAddressOf() );
-	context->PSSetShaderResources( 0, 1, m_persistentData->m_lastOutputSRV.GetAddressOf() );
+	passState.SetRenderTarget( target, nullptr );
 
-	if ( std::exchange(SETTINGS.colorGradingDirty, false) )
+	passState.SetVertexBuffer( std::get<0>(contextState.m_volatileData->m_vertexBuffer).Get(), std::get<1>(contextState.m_volatileData->m_vertexBuffer), std::get<2>(contextState.m_volatileData->m_vertexBuffer) );
+	passState.SetConstantBuffer( 5, contextState.m_constantBuffer.Get() );
+	passState.SetShaderResource( 0, source );
+	if ( useLut )
 	{
-		D3D11_MAPPED_SUBRESOURCE mapped;
-		if ( SUCCEEDED(context->Map( m_constantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped )) )
-		{
-			memcpy( mapped.pData, SETTINGS.colorGradingAttributes, sizeof(SETTINGS.colorGradingAttributes) );
-			context->Unmap( m_constantBuffer.Get(), 0 );
-		}
+		passState.SetShaderResource( 1, m_lutSRV.Get() );
+		passState.SetSampler( 1, m_lutSampler.Get() );
+	}
+
+	context->Draw( 6, std::get<3>(contextState.m_volatileData->m_vertexBuffer) );
+}
+
+void Effects::ColorGrading::DispatchColorFilterPass(ID3D11DeviceContext* context, ContextState& contextState, const ShadowState& shadowState, const Settings& settings, ID3D11ShaderResourceView* source, const RenderTargetPool::Target& target, bool sourceUnorm)
+{
+	UpdateConstantBuffer( context, contextState, settings );
+
+	// LUT only covers 0.0-1.0 range, so other sources are always graded analytically
+	ID3D11ComputeShader* lutComputeShader = settings.colorGradingLut && sourceUnorm ? GetComputeShader( m_lutComputeShader, m_device, COLOR_GRADING_LUT_CS_BYTECODE ) : nullptr;
+	const bool useLut = lutComputeShader != nullptr && UpdateLut( context, settings );
+
+	// Source may still be bound as a render target, which would make the runtime unbind it from the compute stage - only then are they unbound.
+	// Declared first, so render targets are only restored after the compute stage no longer reads from them
+	ScopedPassState passState( context, shadowState );
+	if ( IsBoundAsRenderTarget( shadowState, source ) )
+	{
+		passState.SetRenderTarget( nullptr, nullptr );
+	}
+
+	// Only the compute stage is touched, so there is much less to save than for a draw.
+	// The game never uses it, so it isn't shadowed
+	ComPtr<ID3D11ComputeShader> savedComputeShader;
+	ComPtr<ID3D11UnorderedAccessView> savedUAV;
+	ComPtr<ID3D11SamplerState> savedLutSampler;
+	ID3D11ShaderResourceView* savedSRVs[2]; // Warning - raw pointers!
+	ID3D11Buffer* savedConstantBuffers[5]; // b1-b5, warning - raw pointers!
+
+	context->CSGetShader( savedComputeShader.GetAddressOf(), nullptr, nullptr );
+	context->CSGetUnorderedAccessViews( 0, 1, savedUAV.GetAddressOf() );
+	context->CSGetSamplers( 1, 1, savedLutSampler.GetAddressOf() );
+	context->CSGetShaderResources( 0, _countof(savedSRVs), savedSRVs );
+	context->CSGetConstantBuffers( 1, _countof(savedConstantBuffers), savedConstantBuffers );
+
+	auto restore = wil::scope_exit([&] {
+		context->CSSetConstantBuffers( 1, _countof(savedConstantBuffers), savedConstantBuffers );
+		context->CSSetShaderResources( 0, _countof(savedSRVs), savedSRVs );
+		context->CSSetSamplers( 1, 1, savedLutSampler.GetAddressOf() );
+		context->CSSetUnorderedAccessViews( 0, 1, savedUAV.GetAddressOf(), nullptr );
+		context->CSSetShader( savedComputeShader.Get(), nullptr, 0 );
+
+		auto release = [](auto& objects) {
+			for ( auto* r : objects )
+			{
+				if ( r != nullptr )
+				{
+					r->Release();
+				}
+			}
+		};
+		release( savedSRVs );
+		release( savedConstantBuffers );
+	});
+
+	// DrawableBuffer and SceneBuffer of the merger call
+	ID3D11Buffer* const gameConstantBuffers[] = { contextState.m_volatileData->m_gameConstantBuffers[0].Get(), contextState.m_volatileData->m_gameConstantBuffers[1].Get() };
+
+	ID3D11ShaderResourceView* const sources[] = { source, useLut ? m_lutSRV.Get() : nullptr };
+	context->CSSetShader( useLut ? lutComputeShader : GetComputeShader( m_computeShader, m_device, COLOR_GRADING_CS_BYTECODE ), nullptr, 0 );
+	context->CSSetConstantBuffers( 1, _countof(gameConstantBuffers), gameConstantBuffers );
+	context->CSSetConstantBuffers( 5, 1, contextState.m_constantBuffer.GetAddressOf() );
+	context->CSSetShaderResources( 0, _countof(sources), sources );
+	context->CSSetUnorderedAccessViews( 0, 1, target.m_uav.GetAddressOf(), nullptr );
+	if ( useLut )
+	{
+		context->CSSetSamplers( 1, 1, m_lutSampler.GetAddressOf() );
+	}
+
+	context->Dispatch( (target.m_desc.Width + 7) / 8, (target.m_desc.Height + 7) / 8, 1 );
+}
+
+bool Effects::ColorGrading::SupportsComputeGrading(ContextState& contextState, const D3D11_TEXTURE2D_DESC& desc)
+{
+	if ( GetComputeShader( m_computeShader, m_device, COLOR_GRADING_CS_BYTECODE ) == nullptr ) return false;
+
+	// Targets keep the same format throughout the game, so a single cached result is enough
+	if ( contextState.m_computeFormatSupport.first != desc.Format )
+	{
+		const UINT requiredSupport = D3D11_FORMAT_SUPPORT_SHADER_LOAD|D3D11_FORMAT_SUPPORT_TYPED_UNORDERED_ACCESS_VIEW;
+		UINT formatSupport = 0;
+		const bool supported = SUCCEEDED(m_device->CheckFormatSupport( desc.Format, &formatSupport )) && (formatSupport & requiredSupport) == requiredSupport;
+		contextState.m_computeFormatSupport = { desc.Format, supported };
+	}
+
+	return contextState.m_computeFormatSupport.second && desc.SampleDesc.Count == 1 && desc.ArraySize == 1 && desc.MipLevels == 1;
+}
+
+void Effects::ColorGrading::UpdateConstantBuffer(ID3D11DeviceContext* context, ContextState& contextState, const Settings& settings)
+{
+	if ( contextState.m_constantBuffer == nullptr )
+	{
+		D3D11_BUFFER_DESC cbDesc {};
+		cbDesc.ByteWidth = 512;
+		cbDesc.Usage = D3D11_USAGE_DYNAMIC;
+		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		if ( FAILED(m_device->CreateBuffer( &cbDesc, nullptr, contextState.m_constantBuffer.GetAddressOf() )) ) return;
 	}
 
-	context->Draw( 6, std::get<3>(m_volatileData->m_vertexBuffer) );
-	context->CopyResource( targetResource.Get(), std::get<0>(m_persistentData->m_tempRT).Get() );
+	// Dynamic buffer contents don't carry over into command lists, so deferred contexts upload every time
+	const auto& attributes = settings.colorGradingAttributes;
+	if ( context->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE && contextState.m_constantBufferAttributes.has_value() &&
+		memcmp( contextState.m_constantBufferAttributes->data(), attributes, sizeof(attributes) ) == 0 ) return;
 
-	m_volatileData.reset();
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if ( SUCCEEDED(context->Map( contextState.m_constantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped )) )
+	{
+		memcpy( mapped.pData, attributes, sizeof(attributes) );
+		context->Unmap( contextState.m_constantBuffer.Get(), 0 );
+		contextState.m_constantBufferAttributes.emplace();
+		memcpy( contextState.m_constantBufferAttributes->data(), attributes, sizeof(attributes) );
+	}
 }
 
+bool Effects::ColorGrading::UpdateLut(ID3D11DeviceContext* context, const Settings& settings)
+{
+	constexpr UINT LUT_SIZE = COLOR_GRADING_LUT_SIZE;
+	constexpr DXGI_FORMAT LUT_FORMAT = DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+	std::lock_guard lock( m_lutMutex );
+	if ( !m_lutSupported ) return false;
+
+	if ( m_lut == nullptr )
+	{
+		// Filtering 32-bit float textures is optional on older feature levels
+		const UINT requiredSupport = D3D11_FORMAT_SUPPORT_TEXTURE3D|D3D11_FORMAT_SUPPORT_SHADER_SAMPLE;
+		UINT formatSupport = 0;
+		if ( FAILED(m_device->CheckFormatSupport( LUT_FORMAT, &formatSupport )) || (formatSupport & requiredSupport) != requiredSupport )
+		{
+			m_lutSupported = false;
+			return false;
+		}
+
+		D3D11_TEXTURE3D_DESC lutDesc {};
+		lutDesc.Width = lutDesc.Height = lutDesc.Depth = LUT_SIZE;
+		lutDesc.MipLevels = 1;
+		lutDesc.Format = LUT_FORMAT;
+		lutDesc.Usage = D3D11_USAGE_DEFAULT;
+		lutDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		D3D11_SAMPLER_DESC samplerDesc {};
+		samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+		samplerDesc.AddressU = samplerDesc.AddressV = samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+		if ( FAILED(m_device->CreateTexture3D( &lutDesc, nullptr, m_lut.GetAddressOf() )) ||
+			FAILED(m_device->CreateShaderResourceView( m_lut.Get(), nullptr, m_lutSRV.GetAddressOf() )) ||
+			FAILED(m_device->CreateSamplerState( &samplerDesc, m_lutSampler.GetAddressOf() )) ||
+			FAILED(m_device->CreatePixelShader( COLOR_GRADING_LUT_PS_BYTECODE, sizeof(COLOR_GRADING_LUT_PS_BYTECODE), nullptr, m_lutPixelShader.GetAddressOf() )) )
+		{
+			m_lut.Reset();
+			m_lutSRV.Reset();
+			m_lutSampler.Reset();
+			m_lutPixelShader.Reset();
+			m_lutSupported = false;
+			return false;
+		}
+
+		m_lutData.resize( LUT_SIZE * LUT_SIZE * LUT_SIZE * 4 );
+	}
+
+	// Baked once per color grading change - other settings changes don't re-bake it
+	const auto& attributes = settings.colorGradingAttributes;
+	if ( !m_lutAttributes.has_value() || memcmp( m_lutAttributes->data(), attributes, sizeof(attributes) ) != 0 )
+	{
+		// An upload recorded on a deferred context only lands when the game executes its command list, if ever,
+		// so only the immediate context uploads - deferred contexts grade analytically until it has
+		if ( context->GetType() != D3D11_DEVICE_CONTEXT_IMMEDIATE ) return false;
+
+		m_lutAttributes.emplace();
+		memcpy( m_lutAttributes->data(), attributes, sizeof(attributes) );
+		BakeColorGradingLut( attributes, LUT_SIZE, m_lutData.data() );
+		context->UpdateSubresource( m_lut.Get(), 0, nullptr, m_lutData.data(), LUT_SIZE * 4 * sizeof(float), LUT_SIZE * LUT_SIZE * 4 * sizeof(float) );
+	}
+	return true;
+}
@@ -2,12 +2,20 @@
 
 #include <d3d11.h>
 
+#include <array>
+#include <cstdint>
+#include <mutex>
 #include <optional>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include <wrl/client.h>
 
-#include "Metadata.h"
+#include "Effect.h"
+#include "GPUProfiler.h"
+#include "LazyResource.h"
+#include "RenderTargetPool.h"
 
 using namespace Microsoft::WRL;
 
@@ -20,64 +28,118 @@ namespace Effects
 // 2. From this draw call, save the following - vertex shader, input layout, rasterizer state, blend state (DS state seems to be same)
 // 3. Skip until the first blend state change - entire postprocessing uses the same blend state, subtitles/UI do not
 // 4. Output RT of the draw call to follow is the output we need to apply color grading on
-// TODO: CopyResource can be skipped if AA is performed - need to cache input of the bloom merger call and re-route the next non-indexed Draw call,
-//	     then apply color grading
-class ColorGrading
+// 5. If Edge AA is performed, its draws read the output of the bloom merger call - color grade that output into a temporary RT
+//    and re-route those draws to read from it instead. Edge AA then writes the graded result straight to the final target,
+//    so the whole target doesn't need to be copied back like in the regular path
+// 6. If the previous frame graded the bloom merger output directly, without Edge AA, and it's a UNORM target,
+//    bloom is given our constant buffer to apply color grading in the merger shader itself, and no separate pass is drawn.
+//    Every frame re-checks this, so a frame that doesn't match falls back to the separate pass from the next frame on
+// 7. In LUT mode, a separate pass over a UNORM source reads the filter from a 3D LUT re-baked on the CPU whenever settings change
+// 8. If the bloom merger output format can be written through a UAV, passes are compute dispatches into a temporary texture,
+//    reading constant buffers captured from the merger call. A target which can't be written through a UAV is drawn to instead
+class ColorGrading : public Effect
 {
-public:
-	ColorGrading(ID3D11Device* device);
-
-	// Machine state functions
-	void OnPixelShaderSet( ID3D11PixelShader* shader );
-	void BeforeDraw( ID3D11DeviceContext* context, UINT VertexCount, UINT StartVertexLocation );
-	void BeforeOMSetBlendState( ID3D11DeviceContext* context, ID3D11BlendState* pBlendState );
-	void BeforeOMSetRenderTargets( ID3D11DeviceContext* context, UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView );
-	void BeforeClearRenderTargetView( ID3D11DeviceContext* context, ID3D11RenderTargetView* pRenderTargetView, const FLOAT ColorRGBA[4] );
-	void ClearState();
-
 private:
-	void DrawColorFilter( ID3D11DeviceContext* context, const ComPtr<ID3D11RenderTargetView>& target );
-
 	enum class State
 	{
 		Initial,
 		MergerCallFound,
 		ResourcesGathered,
+		InputGraded, // Edge AA draws are being re-routed to read a color graded bloom merger output
 	};
 
-	State m_state = State::Initial;
-	ID3D11Device* m_device; // Effect cannot outlive the device
-
-	ComPtr<ID3D11PixelShader> m_pixelShader;
-	ComPtr<ID3D11Buffer> m_constantBuffer;
-
 	// Persistent data - created on demand and invalidated only on resolution/settings change
 	struct PersistentData
 	{
-
-		// Flushed if RTV doesn't match the current output
-		ComPtr<ID3D11Resource> m_lastOutputRT;
-		ComPtr<ID3D11ShaderResourceView> m_lastOutputSRV;
-		
-		// Flushed if RT dimensions don't match the current output
-		std::tuple< ComPtr<ID3D11Texture2D>, UINT, UINT > m_tempRT; // RT, Width, Height
-		ComPtr<ID3D11RenderTargetView> m_tempRTV;
+		// Leased from the pool again if RT description doesn't match the current output, so no other context shares it.
+		// Its SRV is only used when re-routing Edge AA input
+		RenderTargetPool::Lease m_tempRT;
 	};
 
 	// Volatile data - references obtained and released every frame, used for draw detection
 	struct VolatileData
 	{
 		bool m_edgeAADetected = false;
+		bool m_fusedMerger = false; // Bloom merger has already applied color grading
+		bool m_mergerOutputUnorm = false;
+		bool m_computeGrading = false; // Merger output supports compute passes, individual targets are still checked
+		ComPtr<ID3D11Buffer> m_gameConstantBuffers[2]; // b1-b2 of the merger call, bound by compute passes
 		ComPtr<ID3D11VertexShader> m_vertexShader;
 		ComPtr<ID3D11InputLayout> m_inputLayout;
 		ComPtr<ID3D11RasterizerState> m_rasterizerState;
 		ComPtr<ID3D11BlendState> m_blendState;
 		std::tuple< ComPtr<ID3D11Buffer>, UINT, UINT, UINT > m_vertexBuffer; // Buffer, Stride, Offset, StartLocation
 		ComPtr<ID3D11RenderTargetView> m_lastUnboundRTV; // We might need to re-bind an unbound RTV
+		ComPtr<ID3D11Resource> m_mergerOutputRT; // Input of Edge AA
+	};
+
+public:
+	// State machine of a single device context, owned by the context - only ColorGrading touches it
+	struct ContextState : EffectContextState
+	{
+		State m_state = State::Initial;
+
+		ComPtr<ID3D11Buffer> m_constantBuffer; // Created on first use, each context uploads settings into its own
+		std::optional<std::array<float, 5 * 4>> m_constantBufferAttributes; // Last uploaded
+		bool m_mergerFusable = false; // Previous frame graded the bloom merger output directly, without Edge AA
+		bool m_mergerFused = false; // Set between the merger shader being set and the merger draw
+
+		std::pair<DXGI_FORMAT, bool> m_computeFormatSupport { DXGI_FORMAT_UNKNOWN, false }; // Last checked format
+
+		std::optional<PersistentData> m_persistentData;
+		std::optional<VolatileData> m_volatileData;
 	};
 
-	std::optional<PersistentData> m_persistentData;
-	std::optional<VolatileData> m_volatileData;
+	ColorGrading(ID3D11Device* device, GPUProfiler& profiler, RenderTargetPool& renderTargets);
+
+	void PrecreateShaders( JobSystem& jobs ) override;
+
+	HookMask GetHooks( const Settings& settings ) const override;
+	std::unique_ptr<EffectContextState> CreateContextState() const override { return std::make_unique<ContextState>(); }
+
+	// Offers the constant buffer to a bloom merger which can apply color grading by itself
+	void BeforePSSetShader( const HookContext& hook, EffectContextState& effectState, PixelShaderSet& shaderSet ) override;
+
+	// Machine state functions
+	void AfterPSSetShader( const HookContext& hook, EffectContextState& effectState, const PixelShaderSet& shaderSet ) override;
+	bool OnDraw( const HookContext& hook, EffectContextState& effectState, UINT VertexCount, UINT StartVertexLocation ) override;
+	void BeforeOMSetBlendState( const HookContext& hook, EffectContextState& effectState, ID3D11BlendState* pBlendState ) override;
+	void BeforeOMSetRenderTargets( const HookContext& hook, EffectContextState& effectState, UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView ) override;
+	void BeforeClearRenderTargetView( const HookContext& hook, EffectContextState& effectState, ID3D11RenderTargetView* pRenderTargetView, const FLOAT ColorRGBA[4] ) override;
+	void OnClearState( EffectContextState& effectState ) override;
+
+private:
+	void DrawColorFilter( ID3D11DeviceContext* context, ContextState& contextState, const ShadowState& shadowState, const Settings& settings, ID3D11RenderTargetView* target );
+	bool DrawWithGradedInput( ID3D11DeviceContext* context, ContextState& contextState, const ShadowState& shadowState, const Settings& settings, UINT VertexCount, UINT StartVertexLocation );
+
+	void CreateTempRT( ContextState& contextState, const D3D11_TEXTURE2D_DESC& desc, bool compute );
+	void DrawColorFilterPass( ID3D11DeviceContext* context, ContextState& contextState, const ShadowState& shadowState, const Settings& settings, ID3D11ShaderResourceView* source, ID3D11RenderTargetView* target, bool sourceUnorm );
+	void DispatchColorFilterPass( ID3D11DeviceContext* context, ContextState& contextState, const ShadowState& shadowState, const Settings& settings, ID3D11ShaderResourceView* source, const RenderTargetPool::Target& target, bool sourceUnorm );
+	bool SupportsComputeGrading( ContextState& contextState, const D3D11_TEXTURE2D_DESC& desc );
+	void UpdateConstantBuffer( ID3D11DeviceContext* context, ContextState& contextState, const Settings& settings );
+	bool UpdateLut( ID3D11DeviceContext* context, const Settings& settings );
+
+	// Shared by all contexts - immutable, free-threaded or guarded
+	ID3D11Device* m_device; // Effect cannot outlive the device
+	GPUProfiler& m_profiler;
+	RenderTargetPool& m_renderTargets;
+
+	LazyResource<ID3D11PixelShader> m_pixelShader;
+
+	// Compute path - shaders are only available on feature level 11.0
+	LazyResource<ID3D11ComputeShader> m_computeShader;
+	LazyResource<ID3D11ComputeShader> m_lutComputeShader;
+
+	// LUT mode - created on first use and baked by the immediate context when it sees a settings change.
+	// Resources are never reset once created successfully, so they can be read without the lock after UpdateLut returns true
+	std::mutex m_lutMutex;
+	ComPtr<ID3D11PixelShader> m_lutPixelShader;
+	ComPtr<ID3D11Texture3D> m_lut;
+	ComPtr<ID3D11ShaderResourceView> m_lutSRV;
+	ComPtr<ID3D11SamplerState> m_lutSampler;
+	std::vector<float> m_lutData;
+	std::optional<std::array<float, 5 * 4>> m_lutAttributes; // Baked into the LUT
+	bool m_lutSupported = true;
 };
 
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "ColorGradingLut.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define COLOR_GRADING_LUT_SSE2 1
+#include <emmintrin.h>
+#else
+#define COLOR_GRADING_LUT_SSE2 0
+#endif
+
+// Operations are ordered the same way as in the shader bytecode, and the SIMD kernel follows the very same order
+void Effects::GradeColor(const float color[3], const float attributes[5][4], float result[3])
+{
+	const float luminance = (color[0] + color[1] + color[2]) * (1.0f / 3.0f);
+	const float temperature = std::min( std::max( luminance * attributes[0][2], 0.0f ), 1.0f );
+
+	const float coldWeight = std::max( 1.0f - temperature * 2.0f, 0.0f );
+	const float moderateWeight = 1.0f - std::abs( temperature * 2.0f - 1.0f );
+	const float warmWeight = std::max( temperature * 2.0f - 1.0f, 0.0f );
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		const float saturated = attributes[0][1] * (color[i] - luminance) + luminance;
+		const float tint = attributes[1][i] * coldWeight + attributes[2][i] * moderateWeight + attributes[3][i] * warmWeight;
+		result[i] = attributes[0][0] * (saturated * tint * 2.0f - saturated) + saturated;
+	}
+}
+
+#if COLOR_GRADING_LUT_SSE2
+
+static inline __m128 Saturate(__m128 value)
+{
+	return _mm_min_ps( _mm_max_ps( value, _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) );
+}
+
+static inline __m128 Abs(__m128 value)
+{
+	return _mm_andnot_ps( _mm_set1_ps( -0.0f ), value );
+}
+
+// Grades four texels of a row - red differs between them, green and blue are shared
+static void GradeRow4(__m128 red, float green, float blue, const float attributes[5][4], float* out)
+{
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 two = _mm_set1_ps( 2.0f );
+
+	const __m128 color[3] = { red, _mm_set1_ps( green ), _mm_set1_ps( blue ) };
+
+	const __m128 luminance = _mm_mul_ps( _mm_add_ps( _mm_add_ps( color[0], color[1] ), color[2] ), _mm_set1_ps( 1.0f / 3.0f ) );
+	const __m128 temperature = Saturate( _mm_mul_ps( luminance, _mm_set1_ps( attributes[0][2] ) ) );
+
+	const __m128 coldWeight = _mm_max_ps( _mm_sub_ps( one, _mm_mul_ps( temperature, two ) ), _mm_setzero_ps() );
+	const __m128 moderateWeight = _mm_sub_ps( one, Abs( _mm_sub_ps( _mm_mul_ps( temperature, two ), one ) ) );
+	const __m128 warmWeight = _mm_max_ps( _mm_sub_ps( _mm_mul_ps( temperature, two ), one ), _mm_setzero_ps() );
+
+	__m128 result[4];
+	for ( int i = 0; i < 3; i++ )
+	{
+		const __m128 saturated = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( attributes[0][1] ), _mm_sub_ps( color[i], luminance ) ), luminance );
+		const __m128 tint = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( attributes[1][i] ), coldWeight ),
+								_mm_mul_ps( _mm_set1_ps( attributes[2][i] ), moderateWeight ) ),
+								_mm_mul_ps( _mm_set1_ps( attributes[3][i] ), warmWeight ) );
+		const __m128 tinted = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( saturated, tint ), two ), saturated );
+		result[i] = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( attributes[0][0] ), tinted ), saturated );
+	}
+	result[3] = one;
+
+	// Planar to interleaved RGBA
+	_MM_TRANSPOSE4_PS( result[0], result[1], result[2], result[3] );
+	_mm_storeu_ps( out, result[0] );
+	_mm_storeu_ps( out + 4, result[1] );
+	_mm_storeu_ps( out + 8, result[2] );
+	_mm_storeu_ps( out + 12, result[3] );
+}
+
+#endif
+
+void Effects::BakeColorGradingLut(const float attributes[5][4], uint32_t size, float* lut)
+{
+	if ( size < 2 ) return;
+
+	const float scale = 1.0f / (size - 1);
+	for ( uint32_t b = 0; b < size; b++ )
+	{
+		for ( uint32_t g = 0; g < size; g++ )
+		{
+			uint32_t r = 0;
+
+#if COLOR_GRADING_LUT_SSE2
+			for ( ; r + 4 <= size; r += 4 )
+			{
+				const __m128 red = _mm_mul_ps( _mm_setr_ps( float(r), float(r + 1), float(r + 2), float(r + 3) ), _mm_set1_ps( scale ) );
+				GradeRow4( red, g * scale, b * scale, attributes, lut );
+				lut += 4 * 4;
+			}
+#endif
+
+			for ( ; r < size; r++ )
+			{
+				const float color[3] = { r * scale, g * scale, b * scale };
+				GradeColor( color, attributes, lut );
+				lut[3] = 1.0f;
+				lut += 4;
+			}
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+// Bakes the gold filter into a 3D LUT on the CPU, so the grading pass only has to do a single trilinear fetch.
+// Vignette depends on the screen position, so it is not a part of the LUT and is still evaluated per pixel.
+// Kept free of Windows headers, so it can be tested off Windows.
+namespace Effects
+{
+
+// Must match LUT_SIZE in shaders/color_grading_lut_ps.hlsl
+constexpr uint32_t COLOR_GRADING_LUT_SIZE = 32;
+
+// Scalar reference, mirrors ApplyColorGrading from shaders/color_grading.hlsli without the vignette
+void GradeColor( const float color[3], const float attributes[5][4], float result[3] );
+
+// Fills size^3 RGBA texels, red varying fastest and blue slowest - alpha is unused and set to 1.0
+// Results match GradeColor exactly, but are computed for four texels at a time where SSE2 is available
+void BakeColorGradingLut( const float attributes[5][4], uint32_t size, float* lut );
+
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "Metadata.h"
+#include "JobSystem.h"
+#include "ShadowState.h"
+
+namespace Effects
+{
+
+// Device context calls effects can hook
+enum class HookPoint
+{
+	BeforePSSetShader, // Chained, every effect can replace the shader
+	AfterPSSetShader,
+	Draw, // Chained until an effect draws in place of the game
+	DrawIndexed, // Chained until an effect draws in place of the game
+	OtherDraw, // Instanced, indirect and auto draws - chained until an effect draws in place of the game
+	BeforeOMSetRenderTargets,
+	BeforeOMSetBlendState,
+	BeforeClearRenderTargetView,
+	ClearState,
+
+	NumHookPoints
+};
+
+using HookMask = uint32_t;
+
+constexpr HookMask HookBit( HookPoint point )
+{
+	return HookMask(1) << static_cast<uint32_t>(point);
+}
+
+// State of a single device context, created by the effect and owned by the context
+struct EffectContextState
+{
+	virtual ~EffectContextState() = default;
+};
+
+// Context the hooked call was made on
+struct HookContext
+{
+	ID3D11DeviceContext* m_wrappedContext; // State set through it is seen by the shadow state
+	ID3D11DeviceContext* m_context; // Original context - passes drawn through it must restore what they change
+	ShadowState& m_shadowState;
+	const Settings& m_settings; // Of the snapshot the hooks were registered with
+};
+
+// Pixel shader being set, passed along the PSSetShader hooks in registration order
+struct PixelShaderSet
+{
+	ID3D11PixelShader* m_shader; // Shader to bind, effects replace it
+	PixelShaderInfo m_info; // Of the shader the game set
+	ID3D11Buffer* m_colorGradingCB = nullptr; // Offered by color grading for the bloom merger to apply it
+	bool m_colorGradingFused = false; // Bloom merger took the offer
+};
+
+// Draw call other than Draw and DrawIndexed, for effects which only need to wrap it in their own state
+struct DrawCall
+{
+	enum class Type
+	{
+		DrawInstanced, // VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation
+		DrawIndexedInstanced, // IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation
+		DrawInstancedIndirect, // Uses the arguments buffer
+		DrawIndexedInstancedIndirect, // Uses the arguments buffer
+		DrawAuto,
+	};
+
+	Type m_type;
+	UINT m_args[5] {}; // Signed arguments are stored as their two's complement representation
+	ID3D11Buffer* m_argsBuffer = nullptr;
+	UINT m_argsOffset = 0;
+
+	// Makes the same call on the given context
+	void Issue( ID3D11DeviceContext* context ) const
+	{
+		switch ( m_type )
+		{
+		case Type::DrawInstanced:
+			context->DrawInstanced( m_args[0], m_args[1], m_args[2], m_args[3] );
+			break;
+		case Type::DrawIndexedInstanced:
+			context->DrawIndexedInstanced( m_args[0], m_args[1], m_args[2], static_cast<INT>(m_args[3]), m_args[4] );
+			break;
+		case Type::DrawInstancedIndirect:
+			context->DrawInstancedIndirect( m_argsBuffer, m_argsOffset );
+			break;
+		case Type::DrawIndexedInstancedIndirect:
+			context->DrawIndexedInstancedIndirect( m_argsBuffer, m_argsOffset );
+			break;
+		case Type::DrawAuto:
+			context->DrawAuto();
+			break;
+		}
+	}
+};
+
+// Effects only get the calls they register for with the current settings - see EffectHooks.
+// Hooks are called with the state the effect created for the context, and must not call hooked methods of the wrapped context
+class Effect
+{
+public:
+	virtual ~Effect() = default;
+
+	// Queues creation of replacements the current settings use, anything else is still created on first use
+	virtual void PrecreateShaders( JobSystem& /*jobs*/ ) {}
+
+	// Hook points needed with the given settings - 0 disables the effect.
+	// Context state is recreated whenever they change, so state machines never resume halfway
+	virtual HookMask GetHooks( const Settings& settings ) const = 0;
+	virtual std::unique_ptr<EffectContextState> CreateContextState() const = 0;
+
+	virtual void BeforePSSetShader( const HookContext& /*hook*/, EffectContextState& /*effectState*/, PixelShaderSet& /*shaderSet*/ ) {}
+	virtual void AfterPSSetShader( const HookContext& /*hook*/, EffectContextState& /*effectState*/, const PixelShaderSet& /*shaderSet*/ ) {}
+	virtual bool OnDraw( const HookContext& /*hook*/, EffectContextState& /*effectState*/, UINT /*VertexCount*/, UINT /*StartVertexLocation*/ ) { return false; }
+	virtual bool OnDrawIndexed( const HookContext& /*hook*/, EffectContextState& /*effectState*/, UINT /*IndexCount*/, UINT /*StartIndexLocation*/, INT /*BaseVertexLocation*/ ) { return false; }
+	virtual bool OnOtherDraw( const HookContext& /*hook*/, EffectContextState& /*effectState*/, const DrawCall& /*drawCall*/ ) { return false; }
+	virtual void BeforeOMSetRenderTargets( const HookContext& /*hook*/, EffectContextState& /*effectState*/, UINT /*NumViews*/, ID3D11RenderTargetView* const* /*ppRenderTargetViews*/, ID3D11DepthStencilView* /*pDepthStencilView*/ ) {}
+	virtual void BeforeOMSetBlendState( const HookContext& /*hook*/, EffectContextState& /*effectState*/, ID3D11BlendState* /*pBlendState*/ ) {}
+	virtual void BeforeClearRenderTargetView( const HookContext& /*hook*/, EffectContextState& /*effectState*/, ID3D11RenderTargetView* /*pRenderTargetView*/, const FLOAT /*ColorRGBA*/[4] ) {}
+	virtual void OnClearState( EffectContextState& /*effectState*/ ) {}
+};
+
+};
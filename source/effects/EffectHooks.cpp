@@ -0,0 +1,43 @@
+#include "EffectHooks.h"
+
+Effects::EffectHooks::EffectHooks(const std::vector<Effect*>& effects)
+	: m_effects( effects ), m_hookMasks( effects.size(), 0 ), m_states( effects.size() )
+{
+	// Lists never need to reallocate when rebuilt
+	for ( HookList& list : m_lists )
+	{
+		list.reserve( effects.size() );
+	}
+}
+
+void Effects::EffectHooks::Update()
+{
+	if ( m_snapshot != nullptr && m_snapshot->m_generation == GetSettingsGeneration() ) return;
+	m_snapshot = GetSettingsSnapshot();
+	const SettingsSnapshot& snapshot = *m_snapshot;
+
+	for ( HookList& list : m_lists )
+	{
+		list.clear();
+	}
+
+	for ( size_t i = 0; i < m_effects.size(); i++ )
+	{
+		Effect* effect = m_effects[i];
+		const HookMask hooks = effect->GetHooks( snapshot.m_settings );
+		if ( hooks != m_hookMasks[i] )
+		{
+			// The effect may have been halfway through its state machine with hooks it won't get anymore
+			m_hookMasks[i] = hooks;
+			m_states[i] = hooks != 0 ? effect->CreateContextState() : nullptr;
+		}
+
+		for ( size_t point = 0; point < m_lists.size(); point++ )
+		{
+			if ( (hooks & HookBit( static_cast<HookPoint>(point) )) != 0 )
+			{
+				m_lists[point].push_back( { effect, m_states[i].get() } );
+			}
+		}
+	}
+}
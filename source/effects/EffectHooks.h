@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Effect.h"
+
+namespace Effects
+{
+
+// Per-context dispatch of effect hooks. Every hook point has a compact list of the effects registered for it,
+// rebuilt from the published settings when they change - so disabled effects cost no calls at all.
+// Effects are called in registration order.
+class EffectHooks
+{
+public:
+	struct Hook
+	{
+		Effect* m_effect;
+		EffectContextState* m_state;
+	};
+	using HookList = std::vector<Hook>;
+
+	// Effects are owned by the device, which outlives its contexts
+	explicit EffectHooks( const std::vector<Effect*>& effects );
+
+	// Rebuilds the lists if settings changed since the last call, must be called before dispatching a context call
+	void Update();
+
+	const HookList& Get( HookPoint point ) const { return m_lists[static_cast<size_t>(point)]; }
+
+	// Of the snapshot the lists were built from, only valid after Update
+	const Settings& GetSettings() const { return m_snapshot->m_settings; }
+
+private:
+	const std::vector<Effect*>& m_effects;
+	std::vector<HookMask> m_hookMasks; // Parallel to m_effects
+	std::vector<std::unique_ptr<EffectContextState>> m_states; // Parallel to m_effects, only set for enabled effects
+
+	std::array<HookList, static_cast<size_t>(HookPoint::NumHookPoints)> m_lists;
+	std::shared_ptr<const SettingsSnapshot> m_snapshot; // The lists were built from
+};
+
+};
@@ -0,0 +1,40 @@
+#include "FilePoller.h"
+
+#include <system_error>
+
+void Effects::FilePoller::Run(const std::function<void()>& onChanged)
+{
+	// Missing files just report an error
+	std::error_code error;
+	std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time( m_path, error );
+
+	std::unique_lock<std::mutex> lock( m_mutex );
+	while ( !m_cv.wait_for( lock, m_interval, [this] { return m_stopped; } ) )
+	{
+		lock.unlock();
+
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time( m_path, error );
+		if ( !error && writeTime != lastWriteTime )
+		{
+			lastWriteTime = writeTime;
+			onChanged();
+		}
+
+		lock.lock();
+	}
+}
+
+void Effects::FilePoller::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_stopped = true;
+	}
+	m_cv.notify_all();
+}
+
+void Effects::FilePoller::Reset()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_stopped = false;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+
+namespace Effects
+{
+
+// Reports changes of a file's write time by checking it at a fixed interval, for files whose directory cannot be watched.
+// Missing files count as changed once they appear.
+// Kept free of Windows headers, so it can be tested off Windows.
+class FilePoller
+{
+public:
+	FilePoller( std::filesystem::path path, std::chrono::milliseconds interval )
+		: m_path( std::move(path) ), m_interval( interval )
+	{
+	}
+
+	// Blocks the calling thread, calling OnChanged on it for every change until Stop is called
+	void Run( const std::function<void()>& onChanged );
+
+	// Makes Run return - also if it's called afterwards, until Reset is called
+	void Stop();
+	void Reset();
+
+private:
+	const std::filesystem::path m_path;
+	const std::chrono::milliseconds m_interval;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stopped = false; // Guarded by m_mutex
+};
+
+};
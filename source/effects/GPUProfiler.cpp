@@ -0,0 +1,153 @@
+#include "GPUProfiler.h"
+
+#include <utility>
+
+Effects::GPUProfiler::Scope::Scope(GPUProfiler& profiler, ID3D11DeviceContext* context, Pass pass)
+	: m_profiler(profiler), m_context(context), m_interval(profiler.BeginPass(context, pass))
+{
+}
+
+Effects::GPUProfiler::Scope::~Scope()
+{
+	m_profiler.EndPass( m_context, m_interval );
+}
+
+void Effects::GPUProfiler::OnPresent(ID3D11DeviceContext* context, bool enabled)
+{
+	if ( m_active )
+	{
+		context->End( m_frames[m_currentFrame].m_disjoint.Get() );
+		m_frames[m_currentFrame].m_pending = true;
+		m_currentFrame = (m_currentFrame + 1) % NUM_FRAMES;
+	}
+
+	// Oldest frame in flight, its slot is reused now
+	Frame& frame = m_frames[m_currentFrame];
+	if ( frame.m_pending )
+	{
+		ResolveFrame( context, m_currentFrame );
+	}
+
+	if ( !enabled )
+	{
+		if ( m_active )
+		{
+			// Results of the remaining frames would be stale by the time profiling is enabled again
+			for ( Frame& f : m_frames )
+			{
+				f.m_pending = false;
+			}
+			for ( TimingStatistics& stats : m_statistics )
+			{
+				stats.Reset();
+			}
+		}
+		m_active = false;
+		return;
+	}
+
+	if ( frame.m_disjoint == nullptr )
+	{
+		const D3D11_QUERY_DESC desc { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+		if ( FAILED(m_device->CreateQuery( &desc, frame.m_disjoint.GetAddressOf() )) )
+		{
+			m_active = false;
+			return;
+		}
+	}
+
+	frame.m_numIntervals = 0;
+	context->Begin( frame.m_disjoint.Get() );
+	m_active = true;
+}
+
+const char* Effects::GPUProfiler::GetPassName(Pass pass)
+{
+	switch ( pass )
+	{
+	case Pass::ColorGrading:
+		return "Gold Filter";
+	case Pass::BloomMerger:
+		return "Bloom";
+	case Pass::Lighting:
+		return "Lighting";
+	case Pass::UI:
+		return "UI";
+	case Pass::ManifestShaders:
+		return "Manifest Shaders";
+	default:
+		return "";
+	}
+}
+
+size_t Effects::GPUProfiler::BeginPass(ID3D11DeviceContext* context, Pass pass)
+{
+	// Frames are delimited on the immediate context only, so passes recorded into command lists are not measured
+	if ( context->GetType() != D3D11_DEVICE_CONTEXT_IMMEDIATE || !m_active ) return INVALID_INTERVAL;
+
+	Frame& frame = m_frames[m_currentFrame];
+	if ( frame.m_numIntervals == frame.m_intervals.size() )
+	{
+		if ( frame.m_intervals.size() >= MAX_INTERVALS_PER_FRAME ) return INVALID_INTERVAL;
+
+		const D3D11_QUERY_DESC desc { D3D11_QUERY_TIMESTAMP, 0 };
+		Interval interval;
+		if ( FAILED(m_device->CreateQuery( &desc, interval.m_begin.GetAddressOf() )) ||
+			FAILED(m_device->CreateQuery( &desc, interval.m_end.GetAddressOf() )) )
+		{
+			return INVALID_INTERVAL;
+		}
+		frame.m_intervals.emplace_back( std::move(interval) );
+	}
+
+	const size_t index = frame.m_numIntervals++;
+	Interval& interval = frame.m_intervals[index];
+	interval.m_pass = pass;
+	context->End( interval.m_begin.Get() );
+	return index;
+}
+
+void Effects::GPUProfiler::EndPass(ID3D11DeviceContext* context, size_t interval)
+{
+	if ( interval == INVALID_INTERVAL ) return;
+
+	context->End( m_frames[m_currentFrame].m_intervals[interval].m_end.Get() );
+}
+
+void Effects::GPUProfiler::ResolveFrame(ID3D11DeviceContext* context, size_t frameIndex)
+{
+	Frame& frame = m_frames[frameIndex];
+	frame.m_pending = false;
+
+	// Never stall - if results are not ready yet, drop this frame
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if ( context->GetData( frame.m_disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK ) return;
+	if ( disjoint.Disjoint ) return;
+
+	std::array<double, static_cast<size_t>(Pass::NumPasses)> passTimes {};
+	std::array<bool, static_cast<size_t>(Pass::NumPasses)> passUsed {};
+	for ( size_t i = 0; i < frame.m_numIntervals; i++ )
+	{
+		const Interval& interval = frame.m_intervals[i];
+
+		UINT64 begin, end;
+		if ( context->GetData( interval.m_begin.Get(), &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK ||
+			context->GetData( interval.m_end.Get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+		{
+			return;
+		}
+
+		const size_t pass = static_cast<size_t>(interval.m_pass);
+		passTimes[pass] += TicksToMilliseconds( begin, end, disjoint.Frequency );
+		passUsed[pass] = true;
+	}
+
+	// Passes that did not run this frame don't contribute samples
+	for ( size_t i = 0; i < passTimes.size(); i++ )
+	{
+		if ( passUsed[i] )
+		{
+			m_statistics[i].AddSample( passTimes[i] );
+		}
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <wrl/client.h>
+
+#include "TimingStatistics.h"
+
+using namespace Microsoft::WRL;
+
+namespace Effects
+{
+
+// GPU timings of our own passes, measured with timestamp queries.
+// Queries of NUM_FRAMES frames are kept in flight and read back without flushing when their slot is about to be reused,
+// so results are never waited for - frames whose results are not ready by then are dropped.
+class GPUProfiler
+{
+public:
+	enum class Pass
+	{
+		ColorGrading,
+		BloomMerger,
+		Lighting,
+		UI,
+		ManifestShaders,
+
+		NumPasses
+	};
+
+	// Brackets a pass for as long as it's in scope
+	class Scope
+	{
+	public:
+		Scope( GPUProfiler& profiler, ID3D11DeviceContext* context, Pass pass );
+		~Scope();
+
+		Scope( const Scope& ) = delete;
+		Scope& operator=( const Scope& ) = delete;
+
+	private:
+		GPUProfiler& m_profiler;
+		ID3D11DeviceContext* m_context;
+		size_t m_interval;
+	};
+
+	GPUProfiler( ID3D11Device* device )
+		: m_device( device )
+	{
+	}
+
+	// Frame boundary - reads back the oldest frame and starts a new one if profiling is enabled
+	void OnPresent( ID3D11DeviceContext* context, bool enabled );
+
+	const TimingStatistics& GetStatistics( Pass pass ) const { return m_statistics[static_cast<size_t>(pass)]; }
+	static const char* GetPassName( Pass pass );
+
+private:
+	static constexpr size_t NUM_FRAMES = 4;
+	static constexpr size_t MAX_INTERVALS_PER_FRAME = 256; // Passes beyond that are not measured
+	static constexpr size_t INVALID_INTERVAL = SIZE_MAX;
+
+	size_t BeginPass( ID3D11DeviceContext* context, Pass pass );
+	void EndPass( ID3D11DeviceContext* context, size_t interval );
+
+	void ResolveFrame( ID3D11DeviceContext* context, size_t frameIndex );
+
+	struct Interval
+	{
+		Pass m_pass;
+		ComPtr<ID3D11Query> m_begin;
+		ComPtr<ID3D11Query> m_end;
+	};
+
+	struct Frame
+	{
+		ComPtr<ID3D11Query> m_disjoint;
+		std::vector<Interval> m_intervals; // Queries are reused, only the first m_numIntervals are valid for this frame
+		size_t m_numIntervals = 0;
+		bool m_pending = false; // Disjoint query was issued and not read back yet
+	};
+
+	ID3D11Device* m_device; // Profiler cannot outlive the device
+	std::array<Frame, NUM_FRAMES> m_frames;
+	size_t m_currentFrame = 0;
+	bool m_active = false;
+
+	std::array<TimingStatistics, static_cast<size_t>(Pass::NumPasses)> m_statistics;
+};
+
+};
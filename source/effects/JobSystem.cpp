@@ -0,0 +1,60 @@
+#include "JobSystem.h"
+
+#include <utility>
+
+Effects::JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_quit.store( true, std::memory_order_relaxed );
+	}
+	m_cv.notify_one();
+
+	if ( m_thread.joinable() )
+	{
+		m_thread.join();
+	}
+}
+
+bool Effects::JobSystem::Submit(Job job)
+{
+	if ( !m_queue.TryPush( std::move(job) ) )
+	{
+		m_droppedJobs.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( !m_thread.joinable() )
+		{
+			m_thread = std::thread( &JobSystem::WorkerThread, this );
+		}
+		m_hasJobs = true;
+	}
+	m_cv.notify_one();
+	return true;
+}
+
+void Effects::JobSystem::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	while ( true )
+	{
+		m_cv.wait( lock, [this] { return m_hasJobs || m_quit.load( std::memory_order_relaxed ); } );
+		if ( m_quit.load( std::memory_order_relaxed ) ) break;
+
+		// Jobs pushed from now on set the flag again, so none of them can be missed
+		m_hasJobs = false;
+		lock.unlock();
+
+		Job job;
+		while ( !m_quit.load( std::memory_order_relaxed ) && m_queue.TryPop( job ) )
+		{
+			job();
+			job = nullptr;
+		}
+
+		lock.lock();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "LockFreeQueue.h"
+
+namespace Effects
+{
+
+// Runs jobs on a background worker thread, started by the first submitted job.
+// Jobs are queued and taken without locks, the mutex only parks the worker while there's nothing to do.
+// Jobs still queued when the job system is destroyed are dropped, the one already running is waited for.
+// Kept free of Windows headers, so it can be tested off Windows.
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	static constexpr size_t MAX_QUEUED_JOBS = 64;
+
+	~JobSystem();
+
+	// Returns false if the queue is full and counts the dropped job, callers must be able to do the work themselves then
+	bool Submit( Job job );
+
+	size_t GetDroppedJobs() const { return m_droppedJobs.load( std::memory_order_relaxed ); }
+
+private:
+	void WorkerThread();
+
+	LockFreeQueue<Job, MAX_QUEUED_JOBS> m_queue;
+	std::atomic<bool> m_quit { false };
+	std::atomic<size_t> m_droppedJobs { 0 };
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::thread m_thread;
+	bool m_hasJobs = false; // Guarded by m_mutex
+};
+
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+namespace Effects
+{
+
+// Resource created the first time it's needed, so effects that are never enabled don't cost load time or VRAM.
+// Free-threaded - if several threads race to create it, one result wins and the others are released.
+// After a failure creation is retried with exponential backoff, so a transient error (like running out of memory
+// during a level load) doesn't disable the effect for the rest of the session, and a persistent one costs next to nothing.
+template<typename T>
+class LazyResource
+{
+public:
+	LazyResource() = default;
+	~LazyResource()
+	{
+		if ( T* resource = m_resource.load( std::memory_order_relaxed ) )
+		{
+			resource->Release();
+		}
+	}
+
+	LazyResource( const LazyResource& ) = delete;
+	LazyResource& operator=( const LazyResource& ) = delete;
+
+	// Create is HRESULT(T** resource), it must be free-threaded
+	template<typename Create>
+	T* Get( Create&& create )
+	{
+		T* resource = m_resource.load( std::memory_order_acquire );
+		if ( resource != nullptr ) return resource;
+
+		const int64_t retryTime = m_retryTime.load( std::memory_order_relaxed );
+		if ( retryTime != 0 )
+		{
+			// Only one thread retries when the backoff expires
+			const int64_t now = Clock::now().time_since_epoch().count();
+			int64_t expected = retryTime;
+			if ( now < retryTime || !m_retryTime.compare_exchange_strong( expected, INT64_MAX, std::memory_order_relaxed ) ) return nullptr;
+		}
+
+		Microsoft::WRL::ComPtr<T> created;
+		if ( FAILED(create( created.GetAddressOf() )) || created == nullptr )
+		{
+			const uint32_t failures = m_failures.fetch_add( 1, std::memory_order_relaxed );
+			const Clock::duration backoff = INITIAL_BACKOFF * (1 << std::min( failures, MAX_BACKOFF_SHIFT ));
+			m_retryTime.store( (Clock::now() + backoff).time_since_epoch().count(), std::memory_order_relaxed );
+			return nullptr;
+		}
+
+		if ( m_resource.compare_exchange_strong( resource, created.Get(), std::memory_order_acq_rel, std::memory_order_acquire ) )
+		{
+			return created.Detach();
+		}
+		return resource;
+	}
+
+	// Returns nullptr if the resource hasn't been created yet
+	T* Peek() const
+	{
+		return m_resource.load( std::memory_order_acquire );
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+	static constexpr std::chrono::seconds INITIAL_BACKOFF { 1 };
+	static constexpr uint32_t MAX_BACKOFF_SHIFT = 6; // Retried at least every 64 seconds
+
+	std::atomic<T*> m_resource { nullptr };
+	std::atomic<uint32_t> m_failures { 0 };
+	std::atomic<int64_t> m_retryTime { 0 }; // Clock ticks after which creation may be retried, 0 if it hasn't failed
+};
+
+// Replacement pixel shader from embedded bytecode
+template<size_t N>
+ID3D11PixelShader* GetPixelShader( LazyResource<ID3D11PixelShader>& shader, ID3D11Device* device, const uint8_t (&bytecode)[N] )
+{
+	return shader.Get( [&]( ID3D11PixelShader** pixelShader ) {
+		return device->CreatePixelShader( bytecode, N, nullptr, pixelShader );
+	} );
+}
+
+template<size_t N>
+ID3D11ComputeShader* GetComputeShader( LazyResource<ID3D11ComputeShader>& shader, ID3D11Device* device, const uint8_t (&bytecode)[N] )
+{
+	return shader.Get( [&]( ID3D11ComputeShader** computeShader ) {
+		return device->CreateComputeShader( bytecode, N, nullptr, computeShader );
+	} );
+}
+
+};
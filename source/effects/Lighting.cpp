@@ -2,79 +2,45 @@
 
 #include <cstdint>
 
-#include "../wil/resource.h"
+#include "ScopedPassState.h"
 
 #include "Lighting_shader.h"
 
-void Effects::Lighting::CreateAlternatePixelShader(ID3D11PixelShader* shader)
+void Effects::Lighting::PrecreateShaders(JobSystem& jobs)
 {
-	const ResourceMetadata::Type shaderType = GetPixelShaderAnnotation( shader ).m_type;
+	const int lightingType = GetSettingsSnapshot()->m_settings.lightingType;
+	if ( lightingType == 0 ) return;
 
-	if ( shaderType == ResourceMetadata::Type::LightingShader1 )
+	jobs.Submit( [this] { GetAlternatePixelShader( ResourceMetadata::Type::LightingShader1 ); } );
+	jobs.Submit( [this] { GetAlternatePixelShader( ResourceMetadata::Type::LightingShader4 ); } );
+	if ( lightingType == 2 )
 	{
-		// Create an alternate shader
-		ComPtr<ID3D11PixelShader> alternateShader;
-		if ( SUCCEEDED(m_device->CreatePixelShader( LIGHTING1_PS_BYTECODE, sizeof(LIGHTING1_PS_BYTECODE), nullptr, alternateShader.GetAddressOf() )) )
-		{
-			shader->SetPrivateDataInterface( GUID_AlternateResource, alternateShader.Get() );
-		}
-		return;
-	}
-
-	if ( shaderType == ResourceMetadata::Type::LightingShader2 )
-	{
-		// Create an alternate shader
-		ComPtr<ID3D11PixelShader> alternateShader;
-		if ( SUCCEEDED(m_device->CreatePixelShader( LIGHTING2_PS_BYTECODE, sizeof(LIGHTING2_PS_BYTECODE), nullptr, alternateShader.GetAddressOf() )) )
-		{
-			shader->SetPrivateDataInterface( GUID_AlternateResource, alternateShader.Get() );
-		}
-		return;
-	}
-
-	if ( shaderType == ResourceMetadata::Type::LightingShader3 )
-	{
-		// Create an alternate shader
-		ComPtr<ID3D11PixelShader> alternateShader;
-		if ( SUCCEEDED(m_device->CreatePixelShader( LIGHTING3_PS_BYTECODE, sizeof(LIGHTING3_PS_BYTECODE), nullptr, alternateShader.GetAddressOf() )) )
-		{
-			shader->SetPrivateDataInterface( GUID_AlternateResource, alternateShader.Get() );
-		}
-		return;
+		jobs.Submit( [this] { GetAlternatePixelShader( ResourceMetadata::Type::LightingShader2 ); } );
+		jobs.Submit( [this] { GetAlternatePixelShader( ResourceMetadata::Type::LightingShader3 ); } );
 	}
+}
 
-	if ( shaderType == ResourceMetadata::Type::LightingShader4 )
-	{
-		// Create an alternate shader
-		ComPtr<ID3D11PixelShader> alternateShader;
-		if ( SUCCEEDED(m_device->CreatePixelShader( LIGHTING4_PS_BYTECODE, sizeof(LIGHTING4_PS_BYTECODE), nullptr, alternateShader.GetAddressOf() )) )
-		{
-			shader->SetPrivateDataInterface( GUID_AlternateResource, alternateShader.Get() );
-		}
-		return;
-	}
+Effects::HookMask Effects::Lighting::GetHooks(const Settings& settings) const
+{
+	if ( settings.lightingType == 0 ) return 0;
+	return HookBit( HookPoint::BeforePSSetShader ) | HookBit( HookPoint::DrawIndexed );
 }
 
-bool Effects::Lighting::OnDrawIndexed(ID3D11DeviceContext* context, UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation)
+bool Effects::Lighting::OnDrawIndexed(const HookContext& hook, EffectContextState& effectState, UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation)
 {
-	if ( m_swapSRVs )
+	const ContextState& contextState = static_cast<const ContextState&>(effectState);
+	ID3D11DeviceContext* context = hook.m_context;
+	const ShadowState& shadowState = hook.m_shadowState;
+
+	if ( contextState.m_swapSRVs )
 	{
-		// Swap SRV0 and SRV1 around, then restore
-		ID3D11ShaderResourceView* resources[2]; // Warning - raw pointers!
-		context->PSGetShaderResources( 0, _countof(resources), resources );
-		auto restore = wil::scope_exit([&] {
-			context->PSSetShaderResources( 0, _countof(resources), resources );
-			for ( auto* r : resources )
-			{
-				if ( r != nullptr )
-				{
-					r->Release();
-				}
-			}
-		});
+		GPUProfiler::Scope profile( m_profiler, context, GPUProfiler::Pass::Lighting );
 
-		ID3D11ShaderResourceView* const swappedResources[2] = { resources[1], resources[0] }; // Warning - raw pointers!
-		context->PSSetShaderResources( 0, _countof(swappedResources), swappedResources );
+		// Swap SRV0 and SRV1 around, then restore
+		const ShadowState::State& state = shadowState.Get();
+		ScopedPassState passState( context, shadowState );
+		passState.SetShaderResource( 0, state.m_shaderResources[1] );
+		passState.SetShaderResource( 1, state.m_shaderResources[0] );
 
 		context->DrawIndexed( IndexCount, StartIndexLocation, BaseVertexLocation );
 		return true;
@@ -82,29 +48,38 @@ bool Effects::Lighting::OnDrawIndexed(ID3D11DeviceContext* context, UINT IndexCo
 	return false;
 }
 
-ComPtr<ID3D11PixelShader> Effects::Lighting::BeforePixelShaderSet(ID3D11DeviceContext* context, ID3D11PixelShader* shader)
+void Effects::Lighting::BeforePSSetShader(const HookContext& hook, EffectContextState& effectState, PixelShaderSet& shaderSet)
 {
-	ComPtr<ID3D11PixelShader> result(shader);
-	m_swapSRVs = false;
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	contextState.m_swapSRVs = false;
 
-	if ( SETTINGS.lightingType == 0 ) return result;
+	const int lightingType = hook.m_settings.lightingType;
 
-	ResourceMetadata meta;
-	UINT size = sizeof(meta);
-	if ( SUCCEEDED(shader->GetPrivateData(__uuidof(meta), &size, &meta)) )
+	const PixelShaderInfo& info = shaderSet.m_info;
+	if ( (info.m_type == ResourceMetadata::Type::LightingShader1 || info.m_type == ResourceMetadata::Type::LightingShader4) ||
+		 (lightingType == 2 && (info.m_type == ResourceMetadata::Type::LightingShader2 || info.m_type == ResourceMetadata::Type::LightingShader3)) )
 	{
-		if ( (meta.m_type == ResourceMetadata::Type::LightingShader1 || meta.m_type == ResourceMetadata::Type::LightingShader4) ||
-			 (SETTINGS.lightingType == 2 && (meta.m_type == ResourceMetadata::Type::LightingShader2 || meta.m_type == ResourceMetadata::Type::LightingShader3)) )
+		if ( ID3D11PixelShader* alternateShader = GetAlternatePixelShader( info.m_type ) )
 		{
-			ComPtr<ID3D11PixelShader> replacedShader;
-			size = sizeof(ID3D11PixelShader*);
-			if ( SUCCEEDED(shader->GetPrivateData(GUID_AlternateResource, &size, replacedShader.GetAddressOf())) )
-			{
-				result = std::move(replacedShader);
-				m_swapSRVs = meta.m_type == ResourceMetadata::Type::LightingShader3;
-			}
+			contextState.m_swapSRVs = info.m_type == ResourceMetadata::Type::LightingShader3;
+			shaderSet.m_shader = alternateShader;
 		}
 	}
+}
 
-	return result;
+ID3D11PixelShader* Effects::Lighting::GetAlternatePixelShader(ResourceMetadata::Type shaderType)
+{
+	switch ( shaderType )
+	{
+	case ResourceMetadata::Type::LightingShader1:
+		return GetPixelShader( m_lighting1PS, m_device, LIGHTING1_PS_BYTECODE );
+	case ResourceMetadata::Type::LightingShader2:
+		return GetPixelShader( m_lighting2PS, m_device, LIGHTING2_PS_BYTECODE );
+	case ResourceMetadata::Type::LightingShader3:
+		return GetPixelShader( m_lighting3PS, m_device, LIGHTING3_PS_BYTECODE );
+	case ResourceMetadata::Type::LightingShader4:
+		return GetPixelShader( m_lighting4PS, m_device, LIGHTING4_PS_BYTECODE );
+	default:
+		return nullptr;
+	}
 }
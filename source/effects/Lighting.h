@@ -3,7 +3,9 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 
-#include "Metadata.h"
+#include "Effect.h"
+#include "GPUProfiler.h"
+#include "LazyResource.h"
 
 using namespace Microsoft::WRL;
 
@@ -13,22 +15,39 @@ namespace Effects
 // Heuristics of bloom changes:
 // For LightShader1 and LightShader2, just create alternate resources and swap out pixel shaders accordingly
 // For LightShader3, swap out pixel shader and swap SRV0 with SRV1
-class Lighting
+class Lighting : public Effect
 {
 public:
-	Lighting( ID3D11Device* device )
-		: m_device( device )
+	// State of a single device context, owned by the context
+	struct ContextState : EffectContextState
+	{
+		bool m_swapSRVs = false; // For LightingShader3
+	};
+
+	Lighting( ID3D11Device* device, GPUProfiler& profiler )
+		: m_device( device ), m_profiler( profiler )
 	{
 	}
 
-	void CreateAlternatePixelShader( ID3D11PixelShader* shader );
+	void PrecreateShaders( JobSystem& jobs ) override;
+
+	HookMask GetHooks( const Settings& settings ) const override;
+	std::unique_ptr<EffectContextState> CreateContextState() const override { return std::make_unique<ContextState>(); }
 
-	bool OnDrawIndexed( ID3D11DeviceContext* context, UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation );
-	ComPtr<ID3D11PixelShader> BeforePixelShaderSet( ID3D11DeviceContext* context, ID3D11PixelShader* shader );
+	bool OnDrawIndexed( const HookContext& hook, EffectContextState& effectState, UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation ) override;
+	void BeforePSSetShader( const HookContext& hook, EffectContextState& effectState, PixelShaderSet& shaderSet ) override;
 
 private:
+	ID3D11PixelShader* GetAlternatePixelShader( ResourceMetadata::Type shaderType );
+
 	ID3D11Device* m_device; // Effect cannot outlive the device
-	bool m_swapSRVs = false; // For LightingShader3
+	GPUProfiler& m_profiler;
+
+	// Replacements are only created once they are needed by the selected lighting style
+	LazyResource<ID3D11PixelShader> m_lighting1PS;
+	LazyResource<ID3D11PixelShader> m_lighting2PS;
+	LazyResource<ID3D11PixelShader> m_lighting3PS;
+	LazyResource<ID3D11PixelShader> m_lighting4PS;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace Effects
+{
+
+// Bounded multi-producer multi-consumer queue, each cell carries a sequence number telling producers and consumers whose turn it is.
+// Push and pop never block and never allocate, they fail instead if the queue is full or empty.
+// Kept free of Windows headers, so it can be tested off Windows.
+template<typename T, size_t Capacity>
+class LockFreeQueue
+{
+	static_assert( Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two" );
+
+public:
+	LockFreeQueue()
+	{
+		for ( size_t i = 0; i < Capacity; i++ )
+		{
+			m_cells[i].m_sequence.store( i, std::memory_order_relaxed );
+		}
+	}
+
+	LockFreeQueue( const LockFreeQueue& ) = delete;
+	LockFreeQueue& operator=( const LockFreeQueue& ) = delete;
+
+	bool TryPush( T&& value )
+	{
+		Cell* cell;
+		size_t pos = m_enqueuePos.load( std::memory_order_relaxed );
+		while ( true )
+		{
+			cell = &m_cells[pos & (Capacity - 1)];
+			const size_t sequence = cell->m_sequence.load( std::memory_order_acquire );
+			const ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+			if ( diff == 0 )
+			{
+				if ( m_enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) break;
+			}
+			else if ( diff < 0 )
+			{
+				return false; // Full
+			}
+			else
+			{
+				pos = m_enqueuePos.load( std::memory_order_relaxed );
+			}
+		}
+
+		cell->m_value = std::move(value);
+		cell->m_sequence.store( pos + 1, std::memory_order_release );
+		return true;
+	}
+
+	bool TryPop( T& value )
+	{
+		Cell* cell;
+		size_t pos = m_dequeuePos.load( std::memory_order_relaxed );
+		while ( true )
+		{
+			cell = &m_cells[pos & (Capacity - 1)];
+			const size_t sequence = cell->m_sequence.load( std::memory_order_acquire );
+			const ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos + 1);
+			if ( diff == 0 )
+			{
+				if ( m_dequeuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) break;
+			}
+			else if ( diff < 0 )
+			{
+				return false; // Empty
+			}
+			else
+			{
+				pos = m_dequeuePos.load( std::memory_order_relaxed );
+			}
+		}
+
+		value = std::move(cell->m_value);
+		cell->m_value = T();
+		cell->m_sequence.store( pos + Capacity, std::memory_order_release );
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> m_sequence;
+		T m_value {};
+	};
+
+	std::array<Cell, Capacity> m_cells;
+	std::atomic<size_t> m_enqueuePos { 0 };
+	std::atomic<size_t> m_dequeuePos { 0 };
+};
+
+};
@@ -1,15 +1,38 @@
 #include <Windows.h>
 #include "Metadata.h"
+#include "SettingsPersistence.h"
+#include "SettingsWatcher.h"
+#include "ShaderHashTable.h"
 
 #include <stdio.h>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
 #include <utility>
 #include <array>
+#include <vector>
 
 extern wchar_t wcModulePath[MAX_PATH];
 
 Effects::Settings Effects::SETTINGS;
 
+// Only accessed through atomic_load and atomic_store, replaced by PublishSettings
+static std::shared_ptr<const Effects::SettingsSnapshot> publishedSettings = std::make_shared<const Effects::SettingsSnapshot>();
+static std::atomic<uint32_t> publishedGeneration { 0 }; // Stored after the snapshot, so readers never see a generation ahead of it
+
+// Read by the watcher thread, adopted by ApplyReloadedSettings
+static std::mutex reloadedSettingsMutex;
+static std::optional<Effects::Settings> reloadedSettings;
+static std::atomic<bool> hasReloadedSettings { false }; // Spares the render thread the lock every frame
+static bool reloadDeferred = false; // A reload waited for a save, only accessed by ApplyReloadedSettings
+
+static Effects::SettingsPersistence settingsPersistence( wcModulePath );
+static Effects::SettingsWatcher settingsWatcher( wcModulePath ); // Declared last, so its thread is stopped before anything it touches is destroyed
+
 const float Effects::COLOR_GRADING_PRESETS[3][4][4] = {
 	{
 		{ 0.85f,  0.75f,  1.25f },
@@ -42,47 +65,89 @@ void Effects::AnnotatePixelShader( ID3D11PixelShader* shader, ResourceMetadata::
 	shader->SetPrivateData( __uuidof(resource), sizeof(resource), &resource );
 }
 
-void Effects::AnnotatePixelShader( ID3D11PixelShader* shader, const void* bytecode, SIZE_T length )
-{
-	static constexpr std::pair< std::array<uint32_t, 4>, ResourceMetadata::Type > importantShaders[] = {
-		{ { 0xf3896ba8, 0x4f0671da, 0xa690e62a, 0xc9168288 }, ResourceMetadata::Type::BloomMergerShader },
-		{ { 0x1e94a642, 0x771834d4, 0xf7c2a424, 0x583be5c8 }, ResourceMetadata::Type::BloomShader1 },
-		{ { 0xaf000e64, 0x2766c2fc, 0xe3aa8a2c, 0x2f0ee3af }, ResourceMetadata::Type::BloomShader2 },
-		{ { 0x32976b21, 0x3bec6292, 0x89f5d21c, 0xed6bd65f }, ResourceMetadata::Type::BloomShader4 },
-
-		{ { 0x4abe618c, 0xa282fa5b, 0xdcde9b8b, 0xaf4aa8fb }, ResourceMetadata::Type::LightingShader1 },
-		{ { 0x65ae0cbf, 0x89721070, 0x6078754d, 0xa3a24d48 }, ResourceMetadata::Type::LightingShader2 },
-		{ { 0x2ede696f, 0x36c567e9, 0xaacac074, 0xb5f3ad15 }, ResourceMetadata::Type::LightingShader3 },
-		{ { 0x4ee86a1e, 0xbf1eba8f, 0x48e4cf30, 0x635dc3f9 }, ResourceMetadata::Type::LightingShader4 },
-
-		{ { 0x4e0ff42d, 0x6cc1abc1, 0x3b4ac407, 0xc70f5d7e }, ResourceMetadata::Type::EdgeAA },
-		{ { 0x0b4857ad, 0x5efeb1e9, 0x76a173d2, 0xfd56ff9f }, ResourceMetadata::Type::EdgeAA },
-	};
+using ShaderEntry = Effects::ShaderHashEntry<Effects::ResourceMetadata::Type>;
+
+static constexpr auto IMPORTANT_SHADERS = Effects::SortShaderHashes( std::array<ShaderEntry, 10> {{
+	{ { 0xf3896ba8, 0x4f0671da, 0xa690e62a, 0xc9168288 }, Effects::ResourceMetadata::Type::BloomMergerShader },
+	{ { 0x1e94a642, 0x771834d4, 0xf7c2a424, 0x583be5c8 }, Effects::ResourceMetadata::Type::BloomShader1 },
+	{ { 0xaf000e64, 0x2766c2fc, 0xe3aa8a2c, 0x2f0ee3af }, Effects::ResourceMetadata::Type::BloomShader2 },
+	{ { 0x32976b21, 0x3bec6292, 0x89f5d21c, 0xed6bd65f }, Effects::ResourceMetadata::Type::BloomShader4 },
+
+	{ { 0x4abe618c, 0xa282fa5b, 0xdcde9b8b, 0xaf4aa8fb }, Effects::ResourceMetadata::Type::LightingShader1 },
+	{ { 0x65ae0cbf, 0x89721070, 0x6078754d, 0xa3a24d48 }, Effects::ResourceMetadata::Type::LightingShader2 },
+	{ { 0x2ede696f, 0x36c567e9, 0xaacac074, 0xb5f3ad15 }, Effects::ResourceMetadata::Type::LightingShader3 },
+	{ { 0x4ee86a1e, 0xbf1eba8f, 0x48e4cf30, 0x635dc3f9 }, Effects::ResourceMetadata::Type::LightingShader4 },
+
+	{ { 0x4e0ff42d, 0x6cc1abc1, 0x3b4ac407, 0xc70f5d7e }, Effects::ResourceMetadata::Type::EdgeAA },
+	{ { 0x0b4857ad, 0x5efeb1e9, 0x76a173d2, 0xfd56ff9f }, Effects::ResourceMetadata::Type::EdgeAA },
+}} );
+static_assert( Effects::AreShaderHashesUnique( IMPORTANT_SHADERS ) );
 
-	if ( length >= 4 + 16 )
+static Effects::ShaderHashTable<Effects::ResourceMetadata::Type> importantShaders( IMPORTANT_SHADERS );
+
+auto Effects::AnnotatePixelShader( ID3D11PixelShader* shader, const void* bytecode, SIZE_T length ) -> ResourceMetadata::Type
+{
+	ShaderHash hash;
+	if ( ReadShaderHash( bytecode, length, hash ) )
 	{
-		const uint32_t* hash = reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(bytecode) + 4);
-		for ( const auto& sh : importantShaders )
+		// Shaders can be marked as None in the INI to opt them out
+		const ResourceMetadata::Type* type = importantShaders.Find( hash );
+		if ( type != nullptr && *type != ResourceMetadata::Type::None )
 		{
-			if ( std::equal( sh.first.begin(), sh.first.end(), hash ) )
-			{
-				AnnotatePixelShader( shader, sh.second, false );
-				return;
-			}
-
+			AnnotatePixelShader( shader, *type, false );
+			return *type;
 		}
 	}
+	return ResourceMetadata::Type::None;
 }
 
-auto Effects::GetPixelShaderAnnotation(ID3D11PixelShader* shader) -> ResourceMetadata
+void Effects::LoadShaderHashes()
 {
-	ResourceMetadata result;
-	UINT size = sizeof(result);
-	if ( FAILED(shader->GetPrivateData(__uuidof(result), &size, &result)) )
-	{
-		result.m_type = ResourceMetadata::Type::None;
-	}
-	return result;
+	static constexpr std::pair< std::wstring_view, ResourceMetadata::Type > typeNames[] = {
+		{ L"None", ResourceMetadata::Type::None },
+		{ L"BloomMergerShader", ResourceMetadata::Type::BloomMergerShader },
+		{ L"BloomShader1", ResourceMetadata::Type::BloomShader1 },
+		{ L"BloomShader2", ResourceMetadata::Type::BloomShader2 },
+		{ L"BloomShader4", ResourceMetadata::Type::BloomShader4 },
+		{ L"LightingShader1", ResourceMetadata::Type::LightingShader1 },
+		{ L"LightingShader2", ResourceMetadata::Type::LightingShader2 },
+		{ L"LightingShader3", ResourceMetadata::Type::LightingShader3 },
+		{ L"LightingShader4", ResourceMetadata::Type::LightingShader4 },
+		{ L"EdgeAA", ResourceMetadata::Type::EdgeAA },
+	};
+
+	// Shaders may be created from any thread as soon as a device exists, so the table can only be extended once, before that
+	static std::once_flag loaded;
+	std::call_once( loaded, [] {
+		// Entries of the optional [Shaders] section are in the form of hash=Type, e.g. f3896ba8-4f0671da-a690e62a-c9168288=EdgeAA
+		std::vector<wchar_t> buffer( 32767 ); // Maximum size of a profile section
+		const DWORD length = GetPrivateProfileSectionW( L"Shaders", buffer.data(), static_cast<DWORD>(buffer.size()), wcModulePath );
+
+		for ( std::wstring_view entries( buffer.data(), length ); !entries.empty(); )
+		{
+			const size_t end = entries.find( L'\0' );
+			const std::wstring_view entry = entries.substr( 0, end );
+			entries = end != std::wstring_view::npos ? entries.substr( end + 1 ) : std::wstring_view();
+
+			const size_t equals = entry.find( L'=' );
+			if ( equals == std::wstring_view::npos ) continue;
+
+			ShaderHash hash;
+			if ( !ParseShaderHash( entry.substr( 0, equals ), hash ) ) continue;
+
+			std::wstring_view typeName = entry.substr( equals + 1 );
+			while ( !typeName.empty() && (typeName.front() == L' ' || typeName.front() == L'\t') ) typeName.remove_prefix( 1 );
+			while ( !typeName.empty() && (typeName.back() == L' ' || typeName.back() == L'\t') ) typeName.remove_suffix( 1 );
+			for ( const auto& type : typeNames )
+			{
+				if ( type.first == typeName )
+				{
+					importantShaders.Add( hash, type.second );
+					break;
+				}
+			}
+		}
+	});
 }
 
 int Effects::GetSelectedPreset( float attribs[4][4] )
@@ -99,46 +164,110 @@ int Effects::GetSelectedPreset( float attribs[4][4] )
 	return -1;
 }
 
-void Effects::SaveSettings()
+static void ReadSettings(Effects::Settings& settings)
 {
-	wchar_t buffer[16];
+	settings.colorGradingEnabled = GetPrivateProfileIntW( L"Basic", L"EnableColorGrading", 1, wcModulePath );
+	settings.bloomType = GetPrivateProfileIntW( L"Basic", L"BloomStyle", 1, wcModulePath );
+	settings.lightingType = GetPrivateProfileIntW( L"Basic", L"LightingStyle", 1, wcModulePath );
+	settings.colorGradingLut = GetPrivateProfileIntW( L"Advanced", L"UseLUT", 0, wcModulePath );
+	settings.filterRedundantState = GetPrivateProfileIntW( L"Advanced", L"FilterRedundantState", 0, wcModulePath );
 
-	// Basic
-	swprintf_s( buffer, L"%d", SETTINGS.colorGradingEnabled );
-	WritePrivateProfileStringW( L"Basic", L"EnableColorGrading", buffer, wcModulePath );
+	// If color grading fails to load, reset it all, but leave vignette separate
+	if ( 
+		GetPrivateProfileStructW( L"Advanced", L"Attribs", &settings.colorGradingAttributes[0], sizeof(float) * 3, wcModulePath ) == FALSE ||
+		GetPrivateProfileStructW( L"Advanced", L"Color1", &settings.colorGradingAttributes[1], sizeof(float) * 3, wcModulePath ) == FALSE ||
+		GetPrivateProfileStructW( L"Advanced", L"Color2", &settings.colorGradingAttributes[2], sizeof(float) * 3, wcModulePath ) == FALSE ||
+		GetPrivateProfileStructW( L"Advanced", L"Color3", &settings.colorGradingAttributes[3], sizeof(float) * 3, wcModulePath ) == FALSE )
+	{
+		memcpy( &settings.colorGradingAttributes[0], Effects::COLOR_GRADING_PRESETS[0], sizeof(Effects::COLOR_GRADING_PRESETS[0]) );
+	}
 
-	swprintf_s( buffer, L"%d", SETTINGS.bloomType );
-	WritePrivateProfileStringW( L"Basic", L"BloomStyle", buffer, wcModulePath );
+	if ( GetPrivateProfileStructW( L"Advanced", L"Vignette", &settings.colorGradingAttributes[4], sizeof(float) * 4, wcModulePath ) == FALSE )
+	{
+		memcpy( &settings.colorGradingAttributes[4], Effects::VIGNETTE_PRESET, sizeof(Effects::VIGNETTE_PRESET) );
+	}
+}
+
+void Effects::PublishSettings()
+{
+	const std::shared_ptr<const SettingsSnapshot> current = std::atomic_load( &publishedSettings );
+	if ( current->m_settings == SETTINGS ) return;
 
-	swprintf_s( buffer, L"%d", SETTINGS.lightingType );
-	WritePrivateProfileStringW( L"Basic", L"LightingStyle", buffer, wcModulePath );
+	// Readers still holding the previous snapshot keep it alive until they are done with it
+	auto next = std::make_shared<SettingsSnapshot>();
+	next->m_settings = SETTINGS;
+	next->m_generation = current->m_generation + 1;
+
+	const uint32_t generation = next->m_generation;
+	std::atomic_store( &publishedSettings, std::shared_ptr<const SettingsSnapshot>( std::move(next) ) );
+	publishedGeneration.store( generation, std::memory_order_release );
+}
+
+uint32_t Effects::GetSettingsGeneration()
+{
+	return publishedGeneration.load( std::memory_order_acquire );
+}
+
+std::shared_ptr<const Effects::SettingsSnapshot> Effects::GetSettingsSnapshot()
+{
+	return std::atomic_load( &publishedSettings );
+}
+
+void Effects::SaveSettings()
+{
+	settingsPersistence.Schedule( SETTINGS );
+}
 
-	// Advanced
-	WritePrivateProfileStructW( L"Advanced", L"Attribs", &SETTINGS.colorGradingAttributes[0], sizeof(float) * 3, wcModulePath );
-	WritePrivateProfileStructW( L"Advanced", L"Color1", &SETTINGS.colorGradingAttributes[1], sizeof(float) * 3, wcModulePath );
-	WritePrivateProfileStructW( L"Advanced", L"Color2", &SETTINGS.colorGradingAttributes[2], sizeof(float) * 3, wcModulePath );
-	WritePrivateProfileStructW( L"Advanced", L"Color3", &SETTINGS.colorGradingAttributes[3], sizeof(float) * 3, wcModulePath );
-	WritePrivateProfileStructW( L"Advanced", L"Vignette", &SETTINGS.colorGradingAttributes[4], sizeof(float) * 4, wcModulePath );
+void Effects::FlushSettings()
+{
+	settingsWatcher.Stop();
+	settingsPersistence.Flush();
 }
 
 void Effects::LoadSettings()
 {
-	SETTINGS.colorGradingEnabled = GetPrivateProfileIntW( L"Basic", L"EnableColorGrading", 1, wcModulePath );
-	SETTINGS.bloomType = GetPrivateProfileIntW( L"Basic", L"BloomStyle", 1, wcModulePath );
-	SETTINGS.lightingType = GetPrivateProfileIntW( L"Basic", L"LightingStyle", 1, wcModulePath );
+	ReadSettings( SETTINGS );
+	PublishSettings();
 
-	// If color grading fails to load, reset it all, but leave vignette separate
-	if ( 
-		GetPrivateProfileStructW( L"Advanced", L"Attribs", &SETTINGS.colorGradingAttributes[0], sizeof(float) * 3, wcModulePath ) == FALSE ||
-		GetPrivateProfileStructW( L"Advanced", L"Color1", &SETTINGS.colorGradingAttributes[1], sizeof(float) * 3, wcModulePath ) == FALSE ||
-		GetPrivateProfileStructW( L"Advanced", L"Color2", &SETTINGS.colorGradingAttributes[2], sizeof(float) * 3, wcModulePath ) == FALSE ||
-		GetPrivateProfileStructW( L"Advanced", L"Color3", &SETTINGS.colorGradingAttributes[3], sizeof(float) * 3, wcModulePath ) == FALSE )
+	settingsWatcher.Start( [] {
+		Settings settings {};
+		ReadSettings( settings );
+
+		// Our own writes are reported too - after a deferred reload, a stale one could undo it
+		if ( settingsPersistence.ConsumeOwnWrite( settings ) ) return;
+
+		std::lock_guard<std::mutex> lock( reloadedSettingsMutex );
+		reloadedSettings = settings;
+		hasReloadedSettings.store( true, std::memory_order_release );
+	} );
+}
+
+void Effects::ApplyReloadedSettings()
+{
+	if ( !hasReloadedSettings.load( std::memory_order_acquire ) ) return;
+
+	// The pending save is about to overwrite the reloaded file, so the reload stays queued until it's written
+	// and is then saved back - the external edit is newer than the UI edits being saved
+	if ( settingsPersistence.IsPending() )
 	{
-		memcpy( &SETTINGS.colorGradingAttributes[0], COLOR_GRADING_PRESETS[0], sizeof(COLOR_GRADING_PRESETS[0]) );
+		reloadDeferred = true;
+		return;
 	}
 
-	if ( GetPrivateProfileStructW( L"Advanced", L"Vignette", &SETTINGS.colorGradingAttributes[4], sizeof(float) * 4, wcModulePath ) == FALSE )
+	std::optional<Settings> settings;
+	{
+		std::lock_guard<std::mutex> lock( reloadedSettingsMutex );
+		settings = std::exchange( reloadedSettings, std::nullopt );
+		hasReloadedSettings.store( false, std::memory_order_relaxed );
+	}
+
+	if ( !settings.has_value() ) return;
+
+	settings->isShown = SETTINGS.isShown;
+	SETTINGS = *settings;
+
+	if ( std::exchange( reloadDeferred, false ) )
 	{
-		memcpy( &SETTINGS.colorGradingAttributes[4], Effects::VIGNETTE_PRESET, sizeof(Effects::VIGNETTE_PRESET) );
+		SaveSettings();
 	}
 }
@@ -3,9 +3,13 @@
 #include <type_traits>
 #include <d3d11.h>
 
+#include "Settings.h"
+
 namespace Effects 
 {
 
+struct ShaderManifestEntry;
+
 // Private data we attach to "interesting" resources
 struct __declspec(uuid("5383C3EB-9DE8-48FC-8C88-8721759EA8E6")) ResourceMetadata
 {
@@ -25,46 +29,36 @@ struct __declspec(uuid("5383C3EB-9DE8-48FC-8C88-8721759EA8E6")) ResourceMetadata
 		LightingShader4,
 
 		EdgeAA, // More than one shader, but we don't need to differentiate them
+
+		ManifestShader, // Swapped by the shader manifest
 	};
 
 	Type m_type;
 };
 static_assert(std::is_trivial_v<ResourceMetadata>); // Private data is memcpy'd around and destructed by freeing memory only
 
-// Shader annotator
-void AnnotatePixelShader( ID3D11PixelShader* shader, ResourceMetadata::Type type, bool replacement );
-void AnnotatePixelShader( ID3D11PixelShader* shader, const void* bytecode, SIZE_T length );
-ResourceMetadata GetPixelShaderAnnotation( ID3D11PixelShader* shader );
-
-// {2BBE62D5-AB9D-47B1-AED2-F40C375BDD0F}
-static const GUID GUID_AlternateResource = 
-	{ 0x2bbe62d5, 0xab9d, 0x47b1, { 0xae, 0xd2, 0xf4, 0xc, 0x37, 0x5b, 0xdd, 0xf } };
-
-
-// Global options, controlled by UI and mostly saved to INI
-struct Settings
+// Classification of a pixel shader, cached by the device on creation so PSSetShader doesn't need to query private data
+struct PixelShaderInfo
 {
-	// Those don't save
-	bool isShown = false;
-	bool colorGradingDirty = true;
-
-	// Those save
-	bool colorGradingEnabled;
-	int bloomType; // 0 - stock, 1 - DXHR
-	int lightingType; // 0 - stock, 1 - stock fixed, 2 - DXHR
-
-	float colorGradingAttributes[5][4] {};
+	ResourceMetadata::Type m_type = ResourceMetadata::Type::None;
+	const ShaderManifestEntry* m_manifestEntry = nullptr; // Only for ManifestShader
 };
 
-extern Settings SETTINGS;
+// Shader annotator
+void AnnotatePixelShader( ID3D11PixelShader* shader, ResourceMetadata::Type type, bool replacement );
+ResourceMetadata::Type AnnotatePixelShader( ID3D11PixelShader* shader, const void* bytecode, SIZE_T length );
 
-// Color grading presets
-extern const float COLOR_GRADING_PRESETS[3][4][4];
-extern const float VIGNETTE_PRESET[4];
+// Extends the built-in shader table with the INI's [Shaders] section, must be called before any shaders are created
+void LoadShaderHashes();
 
+// Settings
 int GetSelectedPreset( float attribs[4][4] );
 
 void SaveSettings();
-void LoadSettings();
+void LoadSettings(); // Also starts watching the INI for changes
+void FlushSettings();
+
+// Adopts settings reloaded after the INI was changed on disk - called at frame boundaries by the thread editing SETTINGS
+void ApplyReloadedSettings();
 
 };
\ No newline at end of file
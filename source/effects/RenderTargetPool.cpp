@@ -0,0 +1,153 @@
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <utility>
+
+// Pools are tiny, so linear searches are cheaper than anything fancier
+template<typename Entry, typename Pred>
+static void EvictLeastRecentlyUsed(std::vector<Entry>& entries, size_t maxEntries, Pred canEvict)
+{
+	if ( entries.size() >= maxEntries )
+	{
+		auto it = entries.end();
+		for ( auto cur = entries.begin(); cur != entries.end(); ++cur )
+		{
+			if ( canEvict( *cur ) && (it == entries.end() || cur->m_lastUsedFrame < it->m_lastUsedFrame) )
+			{
+				it = cur;
+			}
+		}
+		if ( it != entries.end() )
+		{
+			entries.erase( it );
+		}
+	}
+}
+
+bool Effects::RenderTargetPool::Target::Matches(const D3D11_TEXTURE2D_DESC& desc) const
+{
+	return m_texture != nullptr && m_desc.Width == desc.Width && m_desc.Height == desc.Height && m_desc.MipLevels == desc.MipLevels &&
+		m_desc.ArraySize == desc.ArraySize && m_desc.Format == desc.Format && m_desc.SampleDesc.Count == desc.SampleDesc.Count &&
+		m_desc.SampleDesc.Quality == desc.SampleDesc.Quality && m_desc.Usage == desc.Usage && m_desc.BindFlags == desc.BindFlags &&
+		m_desc.CPUAccessFlags == desc.CPUAccessFlags && m_desc.MiscFlags == desc.MiscFlags;
+}
+
+Effects::RenderTargetPool::Lease::Lease(Lease&& other) noexcept
+	: m_pool( std::exchange( other.m_pool, nullptr ) ), m_target( std::move(other.m_target) )
+{
+}
+
+Effects::RenderTargetPool::Lease& Effects::RenderTargetPool::Lease::operator=(Lease&& other) noexcept
+{
+	if ( this != &other )
+	{
+		Release();
+		m_pool = std::exchange( other.m_pool, nullptr );
+		m_target = std::move(other.m_target);
+	}
+	return *this;
+}
+
+void Effects::RenderTargetPool::Lease::Release()
+{
+	if ( m_pool != nullptr )
+	{
+		std::exchange( m_pool, nullptr )->Release( m_target.m_texture.Get() );
+	}
+	m_target = {};
+}
+
+Effects::RenderTargetPool::Lease Effects::RenderTargetPool::Acquire(const D3D11_TEXTURE2D_DESC& desc)
+{
+	std::lock_guard lock( m_mutex );
+	for ( TargetEntry& entry : m_targets )
+	{
+		if ( !entry.m_leased && entry.m_target.Matches( desc ) )
+		{
+			entry.m_lastUsedFrame = m_currentFrame;
+			entry.m_leased = true;
+			return Lease( this, entry.m_target );
+		}
+	}
+
+	Target target;
+	if ( FAILED(m_device->CreateTexture2D( &desc, nullptr, target.m_texture.GetAddressOf() )) )
+	{
+		return {};
+	}
+
+	if ( (desc.BindFlags & D3D11_BIND_RENDER_TARGET) != 0 )
+	{
+		m_device->CreateRenderTargetView( target.m_texture.Get(), nullptr, target.m_rtv.GetAddressOf() );
+	}
+	if ( (desc.BindFlags & D3D11_BIND_SHADER_RESOURCE) != 0 )
+	{
+		m_device->CreateShaderResourceView( target.m_texture.Get(), nullptr, target.m_srv.GetAddressOf() );
+	}
+	if ( (desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS) != 0 )
+	{
+		m_device->CreateUnorderedAccessView( target.m_texture.Get(), nullptr, target.m_uav.GetAddressOf() );
+	}
+	target.m_desc = desc;
+
+	// Leased targets are never evicted, so the pool only grows past its cap while all of them are in use
+	EvictLeastRecentlyUsed( m_targets, MAX_TARGETS, [](const TargetEntry& entry) { return !entry.m_leased; } );
+	m_targets.push_back( { target, m_currentFrame, true } );
+	return Lease( this, target );
+}
+
+void Effects::RenderTargetPool::Release(ID3D11Texture2D* texture)
+{
+	std::lock_guard lock( m_mutex );
+	for ( TargetEntry& entry : m_targets )
+	{
+		if ( entry.m_target.m_texture.Get() == texture )
+		{
+			entry.m_lastUsedFrame = m_currentFrame;
+			entry.m_leased = false;
+			return;
+		}
+	}
+}
+
+ComPtr<ID3D11ShaderResourceView> Effects::RenderTargetPool::GetShaderResourceView(ID3D11Resource* resource)
+{
+	std::lock_guard lock( m_mutex );
+	for ( ViewEntry& entry : m_views )
+	{
+		if ( entry.m_resource.Get() == resource )
+		{
+			entry.m_lastUsedFrame = m_currentFrame;
+			return entry.m_srv;
+		}
+	}
+
+	ComPtr<ID3D11ShaderResourceView> srv;
+	if ( FAILED(m_device->CreateShaderResourceView( resource, nullptr, srv.GetAddressOf() )) )
+	{
+		return nullptr;
+	}
+
+	EvictLeastRecentlyUsed( m_views, MAX_VIEWS, [](const ViewEntry&) { return true; } );
+	m_views.push_back( { resource, srv, m_currentFrame } );
+	return srv;
+}
+
+void Effects::RenderTargetPool::OnPresent()
+{
+	std::lock_guard lock( m_mutex );
+	m_currentFrame++;
+
+	auto isStale = [this](const auto& entry) {
+		return m_currentFrame - entry.m_lastUsedFrame > MAX_UNUSED_FRAMES;
+	};
+	m_targets.erase( std::remove_if( m_targets.begin(), m_targets.end(), [&](const TargetEntry& entry) { return !entry.m_leased && isStale( entry ); } ), m_targets.end() );
+	m_views.erase( std::remove_if( m_views.begin(), m_views.end(), isStale ), m_views.end() );
+}
+
+void Effects::RenderTargetPool::Purge()
+{
+	std::lock_guard lock( m_mutex );
+	m_targets.erase( std::remove_if( m_targets.begin(), m_targets.end(), [](const TargetEntry& entry) { return !entry.m_leased; } ), m_targets.end() );
+	m_views.clear();
+}
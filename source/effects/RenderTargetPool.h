@@ -0,0 +1,110 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <wrl/client.h>
+
+using namespace Microsoft::WRL;
+
+namespace Effects
+{
+
+// Device-wide pool of transient render targets and cached views, shared by all effects.
+// Both pools are capped and evict their least recently used entries, so VRAM held by the plugin stays bounded -
+// entries unused for MAX_UNUSED_FRAMES frames are also released, so views don't keep released game resources alive for long.
+// Free-threaded, so deferred contexts may borrow from it while recording.
+// Targets are leased - a target is never handed out again until its lease is released, so no two callers share one.
+class RenderTargetPool
+{
+public:
+	struct Target
+	{
+		ComPtr<ID3D11Texture2D> m_texture;
+		ComPtr<ID3D11RenderTargetView> m_rtv; // Only if bindable as a render target
+		ComPtr<ID3D11ShaderResourceView> m_srv; // Only if bindable as a shader resource
+		ComPtr<ID3D11UnorderedAccessView> m_uav; // Only if bindable as an unordered access view
+		D3D11_TEXTURE2D_DESC m_desc {};
+
+		bool Matches( const D3D11_TEXTURE2D_DESC& desc ) const;
+	};
+
+	// Exclusive use of a pooled target, given back to the pool when released or destroyed.
+	// The pool must outlive its leases
+	class Lease
+	{
+	public:
+		Lease() = default;
+		~Lease() { Release(); }
+
+		Lease( Lease&& other ) noexcept;
+		Lease& operator=( Lease&& other ) noexcept;
+		Lease( const Lease& ) = delete;
+		Lease& operator=( const Lease& ) = delete;
+
+		const Target& Get() const { return m_target; }
+		void Release();
+
+	private:
+		friend class RenderTargetPool;
+		Lease( RenderTargetPool* pool, const Target& target )
+			: m_pool( pool ), m_target( target )
+		{
+		}
+
+		RenderTargetPool* m_pool = nullptr;
+		Target m_target;
+	};
+
+	RenderTargetPool( ID3D11Device* device )
+		: m_device( device )
+	{
+	}
+
+	// Leases a free render target matching the entire description, created on demand - an empty lease on failure
+	Lease Acquire( const D3D11_TEXTURE2D_DESC& desc );
+
+	// Returns a cached SRV of any resource, e.g. a game render target alternating with another one.
+	// A reference is returned, as another thread may evict the entry at any time
+	ComPtr<ID3D11ShaderResourceView> GetShaderResourceView( ID3D11Resource* resource );
+
+	// Frame boundary - releases entries unused for too long
+	void OnPresent();
+
+	// Releases all cached views and all targets not leased right now, e.g. when the game is about to resize its render targets
+	void Purge();
+
+private:
+	static constexpr size_t MAX_TARGETS = 6;
+	static constexpr size_t MAX_VIEWS = 8;
+	static constexpr uint32_t MAX_UNUSED_FRAMES = 120;
+
+	struct TargetEntry
+	{
+		Target m_target;
+		uint32_t m_lastUsedFrame;
+		bool m_leased;
+	};
+
+	struct ViewEntry
+	{
+		ComPtr<ID3D11Resource> m_resource; // Held so the address cannot be reused by another resource
+		ComPtr<ID3D11ShaderResourceView> m_srv;
+		uint32_t m_lastUsedFrame;
+	};
+
+	void Release( ID3D11Texture2D* texture );
+
+	ID3D11Device* m_device; // Pool cannot outlive the device
+
+	std::mutex m_mutex; // Guards everything below
+	uint32_t m_currentFrame = 0;
+
+	std::vector<TargetEntry> m_targets;
+	std::vector<ViewEntry> m_views;
+};
+
+};
@@ -0,0 +1,52 @@
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+Effects::RingBuffer::RingBuffer(size_t capacity)
+{
+	size_t size = 1;
+	while ( size < capacity )
+	{
+		size <<= 1;
+	}
+
+	m_buffer = std::make_unique<uint8_t[]>(size);
+	m_mask = size - 1;
+}
+
+bool Effects::RingBuffer::Push(const void* data, size_t size)
+{
+	const size_t writePos = m_writePos.load( std::memory_order_relaxed );
+	const size_t readPos = m_readPos.load( std::memory_order_acquire );
+	if ( (m_mask + 1) - (writePos - readPos) < size ) return false;
+
+	const size_t offset = writePos & m_mask;
+	const size_t firstChunk = std::min( size, (m_mask + 1) - offset );
+	memcpy( m_buffer.get() + offset, data, firstChunk );
+	memcpy( m_buffer.get(), static_cast<const uint8_t*>(data) + firstChunk, size - firstChunk );
+
+	m_writePos.store( writePos + size, std::memory_order_release );
+	return true;
+}
+
+size_t Effects::RingBuffer::Pop(void* data, size_t maxSize)
+{
+	const size_t readPos = m_readPos.load( std::memory_order_relaxed );
+	const size_t writePos = m_writePos.load( std::memory_order_acquire );
+	const size_t size = std::min( writePos - readPos, maxSize );
+
+	const size_t offset = readPos & m_mask;
+	const size_t firstChunk = std::min( size, (m_mask + 1) - offset );
+	memcpy( data, m_buffer.get() + offset, firstChunk );
+	memcpy( static_cast<uint8_t*>(data) + firstChunk, m_buffer.get(), size - firstChunk );
+
+	m_readPos.store( readPos + size, std::memory_order_release );
+	return size;
+}
+
+void Effects::RingBuffer::Clear()
+{
+	m_writePos.store( 0, std::memory_order_relaxed );
+	m_readPos.store( 0, std::memory_order_relaxed );
+}
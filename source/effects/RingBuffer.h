@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Effects
+{
+
+// Lock-free byte queue for exactly one producer thread and one consumer thread.
+// Writes never block - if there is not enough space, nothing is written.
+class RingBuffer
+{
+public:
+	explicit RingBuffer( size_t capacity ); // Rounded up to a power of two
+
+	bool Push( const void* data, size_t size );
+	size_t Pop( void* data, size_t maxSize );
+
+	void Clear(); // Only when neither thread accesses the buffer
+
+private:
+	std::unique_ptr<uint8_t[]> m_buffer;
+	size_t m_mask;
+
+	// Both only ever increase and wrap around on overflow, masked on access
+	alignas(64) std::atomic<size_t> m_writePos { 0 };
+	alignas(64) std::atomic<size_t> m_readPos { 0 };
+};
+
+}
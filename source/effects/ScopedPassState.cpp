@@ -0,0 +1,146 @@
+#include "ScopedPassState.h"
+
+#include <algorithm>
+#include <iterator>
+
+static_assert(Effects::ShadowState::NUM_RENDER_TARGETS == D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT);
+
+Effects::ScopedPassState::ScopedPassState(ID3D11DeviceContext* context, const ShadowState& shadowState)
+	: m_context(context), m_gameState(shadowState.Get()), m_passState(shadowState.Get())
+{
+}
+
+Effects::ScopedPassState::~ScopedPassState()
+{
+	const ShadowState::State& game = m_gameState;
+	const ShadowState::State& pass = m_passState;
+
+	for ( UINT i = 0; i < ShadowState::NUM_SHADER_RESOURCES; i++ )
+	{
+		if ( pass.m_shaderResources[i] != game.m_shaderResources[i] )
+		{
+			m_context->PSSetShaderResources( i, 1, &game.m_shaderResources[i] );
+		}
+	}
+	for ( UINT i = 0; i < ShadowState::NUM_CONSTANT_BUFFERS; i++ )
+	{
+		if ( pass.m_constantBuffers[i] != game.m_constantBuffers[i] )
+		{
+			m_context->PSSetConstantBuffers( i, 1, &game.m_constantBuffers[i] );
+		}
+	}
+	for ( UINT i = 0; i < ShadowState::NUM_SAMPLERS; i++ )
+	{
+		if ( pass.m_samplers[i] != game.m_samplers[i] )
+		{
+			m_context->PSSetSamplers( i, 1, &game.m_samplers[i] );
+		}
+	}
+
+	if ( pass.m_vertexBuffer != game.m_vertexBuffer )
+	{
+		m_context->IASetVertexBuffers( 0, 1, &game.m_vertexBuffer.m_buffer, &game.m_vertexBuffer.m_stride, &game.m_vertexBuffer.m_offset );
+	}
+	if ( pass.m_rasterizerState != game.m_rasterizerState )
+	{
+		m_context->RSSetState( game.m_rasterizerState );
+	}
+	if ( pass.m_inputLayout != game.m_inputLayout )
+	{
+		m_context->IASetInputLayout( game.m_inputLayout );
+	}
+	if ( pass.m_pixelShader != game.m_pixelShader )
+	{
+		m_context->PSSetShader( game.m_pixelShader, nullptr, 0 );
+	}
+	if ( pass.m_vertexShader != game.m_vertexShader )
+	{
+		m_context->VSSetShader( game.m_vertexShader, nullptr, 0 );
+	}
+
+	// Render targets go last - if the pass read from the game's render target, it's only rebound once no longer bound as an input.
+	// The whole set is restored, as the pass unbound all of them
+	if ( m_renderTargetSet )
+	{
+		m_context->OMSetRenderTargets( ShadowState::NUM_RENDER_TARGETS, game.m_renderTargets, game.m_depthStencil );
+	}
+}
+
+void Effects::ScopedPassState::SetVertexShader(ID3D11VertexShader* shader)
+{
+	if ( m_passState.m_vertexShader != shader )
+	{
+		m_passState.m_vertexShader = shader;
+		m_context->VSSetShader( shader, nullptr, 0 );
+	}
+}
+
+void Effects::ScopedPassState::SetPixelShader(ID3D11PixelShader* shader)
+{
+	if ( m_passState.m_pixelShader != shader )
+	{
+		m_passState.m_pixelShader = shader;
+		m_context->PSSetShader( shader, nullptr, 0 );
+	}
+}
+
+void Effects::ScopedPassState::SetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	if ( m_passState.m_inputLayout != inputLayout )
+	{
+		m_passState.m_inputLayout = inputLayout;
+		m_context->IASetInputLayout( inputLayout );
+	}
+}
+
+void Effects::ScopedPassState::SetVertexBuffer(ID3D11Buffer* buffer, UINT stride, UINT offset)
+{
+	const ShadowState::VertexBuffer vertexBuffer { buffer, stride, offset };
+	if ( m_passState.m_vertexBuffer != vertexBuffer )
+	{
+		m_passState.m_vertexBuffer = vertexBuffer;
+		m_context->IASetVertexBuffers( 0, 1, &buffer, &stride, &offset );
+	}
+}
+
+void Effects::ScopedPassState::SetRasterizerState(ID3D11RasterizerState* rasterizerState)
+{
+	if ( m_passState.m_rasterizerState != rasterizerState )
+	{
+		m_passState.m_rasterizerState = rasterizerState;
+		m_context->RSSetState( rasterizerState );
+	}
+}
+
+void Effects::ScopedPassState::SetShaderResource(UINT slot, ID3D11ShaderResourceView* view)
+{
+	m_passState.m_shaderResources[slot] = view;
+	m_context->PSSetShaderResources( slot, 1, &view );
+}
+
+void Effects::ScopedPassState::SetConstantBuffer(UINT slot, ID3D11Buffer* buffer)
+{
+	if ( m_passState.m_constantBuffers[slot] != buffer )
+	{
+		m_passState.m_constantBuffers[slot] = buffer;
+		m_context->PSSetConstantBuffers( slot, 1, &buffer );
+	}
+}
+
+void Effects::ScopedPassState::SetSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	if ( m_passState.m_samplers[slot] != sampler )
+	{
+		m_passState.m_samplers[slot] = sampler;
+		m_context->PSSetSamplers( slot, 1, &sampler );
+	}
+}
+
+void Effects::ScopedPassState::SetRenderTarget(ID3D11RenderTargetView* renderTarget, ID3D11DepthStencilView* depthStencil)
+{
+	std::fill( std::begin(m_passState.m_renderTargets), std::end(m_passState.m_renderTargets), nullptr );
+	m_passState.m_renderTargets[0] = renderTarget;
+	m_passState.m_depthStencil = depthStencil;
+	m_renderTargetSet = true;
+	m_context->OMSetRenderTargets( renderTarget != nullptr ? 1 : 0, &renderTarget, depthStencil );
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include "ShadowState.h"
+
+namespace Effects
+{
+
+// Binds state of an injected pass on top of the game's state, and on destruction restores only what the pass changed.
+// Game state is read from the shadow state instead of Get calls, so setting up and tearing down a pass costs no more than its own Set calls.
+// Shaders, input layout, vertex buffer, rasterizer state, constant buffers and samplers are only set if they differ from what's bound.
+// Shader resources are always set, as the runtime may have unbound them without the shadow state knowing.
+// Must be used on the underlying context, so the pass doesn't go through the wrapper's own hooks.
+class ScopedPassState
+{
+public:
+	ScopedPassState( ID3D11DeviceContext* context, const ShadowState& shadowState );
+	~ScopedPassState();
+
+	ScopedPassState( const ScopedPassState& ) = delete;
+	ScopedPassState& operator=( const ScopedPassState& ) = delete;
+
+	void SetVertexShader( ID3D11VertexShader* shader );
+	void SetPixelShader( ID3D11PixelShader* shader );
+	void SetInputLayout( ID3D11InputLayout* inputLayout );
+	void SetVertexBuffer( ID3D11Buffer* buffer, UINT stride, UINT offset );
+	void SetRasterizerState( ID3D11RasterizerState* rasterizerState );
+	void SetShaderResource( UINT slot, ID3D11ShaderResourceView* view );
+	void SetConstantBuffer( UINT slot, ID3D11Buffer* buffer );
+	void SetSampler( UINT slot, ID3D11SamplerState* sampler );
+	// Unbinds all other render targets, the game's entire set is restored afterwards
+	void SetRenderTarget( ID3D11RenderTargetView* renderTarget, ID3D11DepthStencilView* depthStencil );
+
+private:
+	ID3D11DeviceContext* m_context;
+	const ShadowState::State& m_gameState;
+	ShadowState::State m_passState;
+	bool m_renderTargetSet = false;
+};
+
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+// This header is kept free of Windows headers, so settings can be consumed by portable code
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace Effects
+{
+
+// Global options, controlled by UI and mostly saved to INI
+struct Settings
+{
+	// Those don't save
+	bool isShown = false;
+
+	// Those save
+	bool colorGradingEnabled;
+	int bloomType; // 0 - stock, 1 - DXHR
+	int lightingType; // 0 - stock, 1 - stock fixed, 2 - DXHR
+	bool colorGradingLut; // Grade through a baked 3D LUT instead of evaluating the filter per pixel
+	bool filterRedundantState; // Drop state setting calls which rebind what's already bound, instead of forwarding them
+
+	float colorGradingAttributes[5][4] {};
+};
+
+// Field by field, as padding bytes are indeterminate. Attributes are compared bitwise, so a NaN read from a broken INI
+// doesn't make the settings differ from themselves
+inline bool operator==( const Settings& lhs, const Settings& rhs )
+{
+	return lhs.isShown == rhs.isShown && lhs.colorGradingEnabled == rhs.colorGradingEnabled && lhs.bloomType == rhs.bloomType &&
+		lhs.lightingType == rhs.lightingType && lhs.colorGradingLut == rhs.colorGradingLut && lhs.filterRedundantState == rhs.filterRedundantState &&
+		memcmp( lhs.colorGradingAttributes, rhs.colorGradingAttributes, sizeof(lhs.colorGradingAttributes) ) == 0;
+}
+
+inline bool operator!=( const Settings& lhs, const Settings& rhs )
+{
+	return !(lhs == rhs);
+}
+
+// Edited by UI only, the render path reads published snapshots instead
+extern Settings SETTINGS;
+
+// Immutable copy of the settings, so effects never see a half-edited struct
+struct SettingsSnapshot
+{
+	Settings m_settings;
+	uint32_t m_generation = 0; // Bumped by every publish that changes anything
+};
+
+// Publishes SETTINGS if they changed since the last call - called at frame boundaries by the thread editing SETTINGS
+void PublishSettings();
+
+// Lock-free, so readers can cheaply check whether the snapshot they hold is stale
+uint32_t GetSettingsGeneration();
+
+// Snapshots are refcounted, so any thread can hold one for as long as it likes without it changing
+std::shared_ptr<const SettingsSnapshot> GetSettingsSnapshot();
+
+// Color grading presets
+extern const float COLOR_GRADING_PRESETS[3][4][4];
+extern const float VIGNETTE_PRESET[4];
+
+};
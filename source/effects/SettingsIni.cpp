@@ -0,0 +1,137 @@
+#include "SettingsIni.h"
+
+#include <cstdint>
+
+namespace Effects::Ini
+{
+
+static std::string_view Trim( std::string_view str )
+{
+	constexpr std::string_view whitespace = " \t\r";
+
+	const size_t begin = str.find_first_not_of( whitespace );
+	if ( begin == std::string_view::npos ) return {};
+
+	const size_t end = str.find_last_not_of( whitespace );
+	return str.substr( begin, end - begin + 1 );
+}
+
+static bool EqualsCaseInsensitive( std::string_view lhs, std::string_view rhs )
+{
+	if ( lhs.size() != rhs.size() ) return false;
+
+	for ( size_t i = 0; i < lhs.size(); i++ )
+	{
+		auto toLower = []( char c ) {
+			return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+		};
+		if ( toLower(lhs[i]) != toLower(rhs[i]) ) return false;
+	}
+	return true;
+}
+
+std::string EncodeStruct( const void* data, size_t size )
+{
+	constexpr char hex[] = "0123456789ABCDEF";
+
+	std::string result;
+	result.reserve( (size + 1) * 2 );
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint8_t checksum = 0;
+	for ( size_t i = 0; i < size; i++ )
+	{
+		result.push_back( hex[bytes[i] >> 4] );
+		result.push_back( hex[bytes[i] & 0xF] );
+		checksum += bytes[i];
+	}
+	result.push_back( hex[checksum >> 4] );
+	result.push_back( hex[checksum & 0xF] );
+
+	return result;
+}
+
+void SetValue( std::string& ini, std::string_view section, std::string_view key, std::string_view value )
+{
+	const std::string newLine = ini.find( "\r\n" ) != std::string::npos || ini.empty() ? "\r\n" : "\n";
+
+	bool inSection = false;
+	size_t sectionInsertPos = std::string::npos; // End of the last non-empty line of the matching section
+
+	size_t lineStart = 0;
+	while ( lineStart < ini.size() )
+	{
+		size_t lineEnd = ini.find( '\n', lineStart );
+		const size_t nextLine = lineEnd != std::string::npos ? lineEnd + 1 : ini.size();
+		if ( lineEnd == std::string::npos ) lineEnd = ini.size();
+
+		const std::string_view line = Trim( std::string_view(ini).substr( lineStart, lineEnd - lineStart ) );
+		if ( !line.empty() && line.front() == '[' )
+		{
+			const size_t closing = line.find( ']' );
+			inSection = closing != std::string_view::npos && EqualsCaseInsensitive( Trim(line.substr( 1, closing - 1 )), section );
+			if ( inSection )
+			{
+				sectionInsertPos = nextLine;
+			}
+		}
+		else if ( inSection && !line.empty() )
+		{
+			const size_t equals = line.find( '=' );
+			if ( equals != std::string_view::npos && EqualsCaseInsensitive( Trim(line.substr( 0, equals )), key ) )
+			{
+				// Replace the value, keeping the original line ending
+				const size_t valueStart = ini.find( '=', lineStart ) + 1;
+				size_t valueEnd = lineEnd;
+				if ( valueEnd > valueStart && ini[valueEnd - 1] == '\r' ) valueEnd--;
+
+				ini.replace( valueStart, valueEnd - valueStart, value );
+				return;
+			}
+			sectionInsertPos = nextLine;
+		}
+
+		lineStart = nextLine;
+	}
+
+	std::string entry;
+	if ( sectionInsertPos == std::string::npos )
+	{
+		// Section doesn't exist, append it
+		if ( !ini.empty() && ini.back() != '\n' ) ini.append( newLine );
+		ini.append( "[" ).append( section ).append( "]" ).append( newLine );
+		sectionInsertPos = ini.size();
+	}
+	else if ( sectionInsertPos == ini.size() && !ini.empty() && ini.back() != '\n' )
+	{
+		// Last line of the file has no line break
+		ini.append( newLine );
+		sectionInsertPos = ini.size();
+	}
+
+	entry.append( key ).append( "=" ).append( value ).append( newLine );
+	ini.insert( sectionInsertPos, entry );
+}
+
+std::string WriteSettings( std::string_view ini, const Settings& settings )
+{
+	std::string result( ini );
+
+	// Basic
+	SetValue( result, "Basic", "EnableColorGrading", std::to_string( static_cast<int>(settings.colorGradingEnabled) ) );
+	SetValue( result, "Basic", "BloomStyle", std::to_string( settings.bloomType ) );
+	SetValue( result, "Basic", "LightingStyle", std::to_string( settings.lightingType ) );
+
+	// Advanced
+	SetValue( result, "Advanced", "UseLUT", std::to_string( static_cast<int>(settings.colorGradingLut) ) );
+	SetValue( result, "Advanced", "FilterRedundantState", std::to_string( static_cast<int>(settings.filterRedundantState) ) );
+	SetValue( result, "Advanced", "Attribs", EncodeStruct( &settings.colorGradingAttributes[0], sizeof(float) * 3 ) );
+	SetValue( result, "Advanced", "Color1", EncodeStruct( &settings.colorGradingAttributes[1], sizeof(float) * 3 ) );
+	SetValue( result, "Advanced", "Color2", EncodeStruct( &settings.colorGradingAttributes[2], sizeof(float) * 3 ) );
+	SetValue( result, "Advanced", "Color3", EncodeStruct( &settings.colorGradingAttributes[3], sizeof(float) * 3 ) );
+	SetValue( result, "Advanced", "Vignette", EncodeStruct( &settings.colorGradingAttributes[4], sizeof(float) * 4 ) );
+
+	return result;
+}
+
+};
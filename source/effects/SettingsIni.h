@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "Settings.h"
+
+// Portable INI formatting for Effects::Settings, compatible with what GetPrivateProfileIntW/GetPrivateProfileStructW read.
+// Kept free of Windows headers, so it can be tested off Windows.
+namespace Effects::Ini
+{
+
+// Encodes data the same way WritePrivateProfileStructW does - uppercase hex bytes followed by a one byte checksum
+std::string EncodeStruct( const void* data, size_t size );
+
+// Sets a key in the INI text, preserving everything else - adds the key and/or section if they don't exist yet
+// Section and key names are compared case-insensitively, like GetPrivateProfile* functions do
+void SetValue( std::string& ini, std::string_view section, std::string_view key, std::string_view value );
+
+// Returns an INI text with all saved settings updated
+std::string WriteSettings( std::string_view ini, const Settings& settings );
+
+};
@@ -0,0 +1,205 @@
+#include "SettingsPersistence.h"
+
+#include <Windows.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "../wil/resource.h"
+
+#include "SettingsIni.h"
+
+// Only what Ini::WriteSettings saves - the rest reads back as defaults
+static Effects::Settings GetSavedSettings(const Effects::Settings& settings)
+{
+	Effects::Settings saved = settings;
+	saved.isShown = false;
+	return saved;
+}
+
+Effects::SettingsPersistence::~SettingsPersistence()
+{
+	// If Flush wasn't called, the process is exiting and ExitProcess has already terminated the worker.
+	// The lock is only tried, as the worker might have been terminated while holding it
+	if ( m_thread.joinable() )
+	{
+		m_thread.detach();
+	}
+
+	std::unique_lock<std::mutex> lock( m_mutex, std::try_to_lock );
+	if ( lock.owns_lock() && m_pendingSettings.has_value() )
+	{
+		Write( *m_pendingSettings );
+	}
+}
+
+void Effects::SettingsPersistence::Schedule(const Settings& settings)
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+
+	const bool wasPending = m_pendingSettings.has_value();
+	m_pendingSettings = settings;
+	m_writeTime = std::chrono::steady_clock::now() + DEBOUNCE_TIME;
+
+	if ( !m_thread.joinable() )
+	{
+		m_quit = false;
+		m_thread = std::thread( &SettingsPersistence::WorkerThread, this );
+	}
+	else if ( !wasPending )
+	{
+		// Only wake the worker if it's idle, otherwise it picks up the new write time on its own
+		lock.unlock();
+		m_cv.notify_one();
+	}
+}
+
+void Effects::SettingsPersistence::Flush()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	if ( m_thread.joinable() )
+	{
+		m_quit = true;
+		lock.unlock();
+
+		// The worker leaves whatever is still pending to us
+		m_cv.notify_one();
+		m_thread.join();
+
+		lock.lock();
+	}
+
+	if ( m_pendingSettings.has_value() )
+	{
+		const Settings settings = *std::exchange( m_pendingSettings, std::nullopt );
+		m_lastWritten = GetSavedSettings( settings );
+
+		lock.unlock();
+		Write( settings );
+	}
+}
+
+bool Effects::SettingsPersistence::IsPending()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	return m_pendingSettings.has_value();
+}
+
+bool Effects::SettingsPersistence::ConsumeOwnWrite(const Settings& settings)
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if ( m_lastWritten != GetSavedSettings( settings ) ) return false;
+
+	m_lastWritten.reset();
+	return true;
+}
+
+void Effects::SettingsPersistence::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	while ( true )
+	{
+		m_cv.wait( lock, [this] { return m_pendingSettings.has_value() || m_quit; } );
+
+		// Keep waiting as long as settings keep changing
+		while ( !m_quit && std::chrono::steady_clock::now() < m_writeTime )
+		{
+			m_cv.wait_until( lock, m_writeTime );
+		}
+
+		// Flush writes pending settings on its own thread, so they are on disk by the time it returns
+		if ( m_quit ) break;
+
+		const Settings settings = *std::exchange( m_pendingSettings, std::nullopt );
+		m_lastWritten = GetSavedSettings( settings );
+
+		lock.unlock();
+		Write( settings );
+		lock.lock();
+	}
+}
+
+void Effects::SettingsPersistence::Write(const Settings& settings) const
+{
+	// Read the current file, so keys we don't own are preserved
+	std::string ini;
+	{
+		wil::unique_hfile file( CreateFileW( m_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+		if ( !file.is_valid() )
+		{
+			// A missing file is fine, but if it exists and cannot be read, don't risk wiping it
+			if ( GetLastError() != ERROR_FILE_NOT_FOUND ) return;
+		}
+		else
+		{
+			LARGE_INTEGER size;
+			if ( GetFileSizeEx( file.get(), &size ) && size.HighPart == 0 )
+			{
+				ini.resize( size.LowPart );
+
+				DWORD bytesRead = 0;
+				if ( ReadFile( file.get(), ini.data(), size.LowPart, &bytesRead, nullptr ) == FALSE )
+				{
+					return;
+				}
+				ini.resize( bytesRead );
+			}
+		}
+	}
+
+	// Unicode INI files are never created by us, but if the user saved one, edit it as UTF-8 and convert it back,
+	// so both encodings go through the same writer
+	const bool unicode = ini.size() >= 2 && static_cast<uint8_t>(ini[0]) == 0xFF && static_cast<uint8_t>(ini[1]) == 0xFE;
+	if ( unicode )
+	{
+		const wchar_t* text = reinterpret_cast<const wchar_t*>(ini.data() + 2);
+		const int textLength = static_cast<int>((ini.size() - 2) / sizeof(wchar_t));
+
+		std::string utf8;
+		if ( textLength > 0 )
+		{
+			// Invalid UTF-16 would not survive the round trip, so leave such files alone
+			const int utf8Length = WideCharToMultiByte( CP_UTF8, WC_ERR_INVALID_CHARS, text, textLength, nullptr, 0, nullptr, nullptr );
+			if ( utf8Length == 0 ) return;
+
+			utf8.resize( utf8Length );
+			WideCharToMultiByte( CP_UTF8, WC_ERR_INVALID_CHARS, text, textLength, utf8.data(), utf8Length, nullptr, nullptr );
+		}
+		ini = std::move(utf8);
+	}
+
+	std::string newIni = Ini::WriteSettings( ini, settings );
+
+	if ( unicode )
+	{
+		const int utf16Length = MultiByteToWideChar( CP_UTF8, 0, newIni.data(), static_cast<int>(newIni.size()), nullptr, 0 );
+		if ( utf16Length == 0 ) return;
+
+		std::string utf16( 2 + utf16Length * sizeof(wchar_t), '\0' );
+		utf16[0] = static_cast<char>(0xFF);
+		utf16[1] = static_cast<char>(0xFE);
+		MultiByteToWideChar( CP_UTF8, 0, newIni.data(), static_cast<int>(newIni.size()), reinterpret_cast<wchar_t*>(utf16.data() + 2), utf16Length );
+		newIni = std::move(utf16);
+	}
+
+	const std::wstring tempPath = std::wstring(m_path) + L".tmp";
+	{
+		wil::unique_hfile file( CreateFileW( tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+		if ( !file.is_valid() ) return;
+
+		DWORD bytesWritten = 0;
+		if ( WriteFile( file.get(), newIni.data(), static_cast<DWORD>(newIni.size()), &bytesWritten, nullptr ) == FALSE || bytesWritten != newIni.size() )
+		{
+			file.reset();
+			DeleteFileW( tempPath.c_str() );
+			return;
+		}
+		FlushFileBuffers( file.get() );
+	}
+
+	if ( MoveFileExW( tempPath.c_str(), m_path, MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH ) == FALSE )
+	{
+		DeleteFileW( tempPath.c_str() );
+	}
+}
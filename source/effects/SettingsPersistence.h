@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "Settings.h"
+
+namespace Effects
+{
+
+// Saves settings to the INI file on a background thread, so UI changes never block the render thread on disk I/O.
+// Changes made in quick succession (e.g. while dragging a slider) are coalesced and written only once they settle down.
+// The file is written to a temporary file first and then renamed over the original, so it's never left half-written.
+class SettingsPersistence
+{
+public:
+	explicit SettingsPersistence( const wchar_t* path )
+		: m_path( path )
+	{
+	}
+
+	// Never joins the worker, as static destructors run under the loader lock - Flush must be called before.
+	// Settings still pending at process exit are written on the calling thread
+	~SettingsPersistence();
+
+	// Snapshots the settings and schedules a write
+	void Schedule( const Settings& settings );
+
+	// Stops the worker thread and writes pending settings on the calling thread - the worker is restarted by the next Schedule call
+	void Flush();
+
+	// Returns true if scheduled settings haven't been written yet
+	bool IsPending();
+
+	// Returns true once for settings which save the same as the last ones written, so reports of our own writes can be told apart
+	bool ConsumeOwnWrite( const Settings& settings );
+
+private:
+	static constexpr std::chrono::milliseconds DEBOUNCE_TIME { 500 };
+
+	void WorkerThread();
+	void Write( const Settings& settings ) const;
+
+	const wchar_t* m_path;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::thread m_thread;
+
+	// Guarded by m_mutex
+	std::optional<Settings> m_pendingSettings;
+	std::chrono::steady_clock::time_point m_writeTime;
+	std::optional<Settings> m_lastWritten; // Last settings written, without the keys which don't save
+	bool m_quit = false;
+};
+
+};
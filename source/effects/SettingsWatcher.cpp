@@ -0,0 +1,127 @@
+#include "SettingsWatcher.h"
+
+#include <Windows.h>
+#include <Shlwapi.h>
+
+#include <optional>
+
+Effects::SettingsWatcher::~SettingsWatcher()
+{
+	// If Stop wasn't called, the process is exiting and ExitProcess has already terminated the watcher
+	if ( m_thread.joinable() )
+	{
+		m_thread.detach();
+	}
+}
+
+void Effects::SettingsWatcher::Start(std::function<void()> onChanged)
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if ( m_thread.joinable() ) return;
+
+	m_quitEvent.reset( CreateEventW( nullptr, TRUE, FALSE, nullptr ) );
+	if ( !m_quitEvent.is_valid() ) return;
+
+	m_poller.Reset();
+	m_onChanged = std::move(onChanged);
+	m_thread = std::thread( &SettingsWatcher::WorkerThread, this );
+}
+
+void Effects::SettingsWatcher::Stop()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if ( !m_thread.joinable() ) return;
+
+	SetEvent( m_quitEvent.get() );
+	m_poller.Stop();
+	m_thread.join();
+}
+
+void Effects::SettingsWatcher::WorkerThread()
+{
+	if ( !WatchDirectory() )
+	{
+		m_poller.Run( m_onChanged );
+	}
+}
+
+bool Effects::SettingsWatcher::WatchDirectory()
+{
+	wchar_t directory[MAX_PATH];
+	wcscpy_s( directory, m_path );
+	PathRemoveFileSpecW( directory );
+	const wchar_t* fileName = PathFindFileNameW( m_path );
+
+	wil::unique_hfile directoryHandle( CreateFileW( directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+											FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OVERLAPPED, nullptr ) );
+	wil::unique_handle readEvent( CreateEventW( nullptr, TRUE, FALSE, nullptr ) );
+	if ( !directoryHandle.is_valid() || !readEvent.is_valid() ) return false;
+
+	alignas(DWORD) BYTE buffer[4096];
+	OVERLAPPED overlapped {};
+	overlapped.hEvent = readEvent.get();
+
+	// The system writes to the buffer until the read completes, so it must not be left pending on the way out
+	bool readPending = false;
+	auto cancelRead = wil::scope_exit([&] {
+		if ( readPending )
+		{
+			CancelIoEx( directoryHandle.get(), &overlapped );
+
+			DWORD bytesTransferred;
+			GetOverlappedResult( directoryHandle.get(), &overlapped, &bytesTransferred, TRUE );
+		}
+	});
+
+	// Set once a change is seen, and pushed back with every change that follows
+	std::optional<std::chrono::steady_clock::time_point> reportTime;
+	while ( true )
+	{
+		if ( !readPending )
+		{
+			constexpr DWORD notifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME|FILE_NOTIFY_CHANGE_LAST_WRITE|FILE_NOTIFY_CHANGE_SIZE;
+			if ( ReadDirectoryChangesW( directoryHandle.get(), buffer, sizeof(buffer), FALSE, notifyFilter, nullptr, &overlapped, nullptr ) == FALSE )
+			{
+				return false;
+			}
+			readPending = true;
+		}
+
+		DWORD timeout = INFINITE;
+		if ( reportTime.has_value() )
+		{
+			const auto timeLeft = std::chrono::ceil<std::chrono::milliseconds>( *reportTime - std::chrono::steady_clock::now() );
+			timeout = timeLeft.count() > 0 ? static_cast<DWORD>(timeLeft.count()) : 0;
+		}
+
+		const HANDLE handles[] = { m_quitEvent.get(), readEvent.get() };
+		const DWORD waitResult = WaitForMultipleObjects( _countof(handles), handles, FALSE, timeout );
+		if ( waitResult == WAIT_TIMEOUT )
+		{
+			reportTime.reset();
+			m_onChanged();
+			continue;
+		}
+		if ( waitResult != WAIT_OBJECT_0 + 1 ) return true;
+
+		readPending = false;
+		DWORD bytesTransferred = 0;
+		if ( GetOverlappedResult( directoryHandle.get(), &overlapped, &bytesTransferred, FALSE ) == FALSE ) return false;
+
+		// No data means the buffer overflowed and changes were lost, so the file could be among them
+		bool changed = bytesTransferred == 0;
+		for ( const BYTE* entry = buffer; !changed && bytesTransferred != 0; )
+		{
+			const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+			changed = CompareStringOrdinal( info->FileName, static_cast<int>(info->FileNameLength / sizeof(wchar_t)), fileName, -1, TRUE ) == CSTR_EQUAL;
+
+			if ( info->NextEntryOffset == 0 ) break;
+			entry += info->NextEntryOffset;
+		}
+
+		if ( changed )
+		{
+			reportTime = std::chrono::steady_clock::now() + DEBOUNCE_TIME;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "../wil/resource.h"
+
+#include "FilePoller.h"
+
+namespace Effects
+{
+
+// Watches the INI file on a background thread and reports changes made to it by anything, e.g. an external editor.
+// Changes are picked up through ReadDirectoryChangesW, or by polling the file's write time if its directory cannot be watched
+// (e.g. on some network shares). Bursts of changes, like an editor saving in several steps, are reported only once they settle down.
+class SettingsWatcher
+{
+public:
+	explicit SettingsWatcher( const wchar_t* path )
+		: m_path( path ), m_poller( path, POLL_INTERVAL )
+	{
+	}
+
+	// Never joins the watcher, as static destructors run under the loader lock - Stop must be called before
+	~SettingsWatcher();
+
+	// OnChanged is called on the watcher thread - does nothing if the watcher is already running
+	void Start( std::function<void()> onChanged );
+
+	// Stops the watcher thread - it is restarted by the next Start call
+	void Stop();
+
+private:
+	static constexpr std::chrono::milliseconds DEBOUNCE_TIME { 200 };
+	static constexpr std::chrono::milliseconds POLL_INTERVAL { 1000 };
+
+	void WorkerThread();
+
+	// Returns false if the directory cannot be watched
+	bool WatchDirectory();
+
+	const wchar_t* m_path;
+	FilePoller m_poller;
+
+	std::mutex m_mutex; // Guards Start and Stop
+	std::thread m_thread;
+	wil::unique_handle m_quitEvent; // Manual reset
+	std::function<void()> m_onChanged;
+};
+
+};
@@ -0,0 +1,48 @@
+#include "ShaderHashTable.h"
+
+#include <cstring>
+
+bool Effects::ReadShaderHash(const void* bytecode, size_t length, ShaderHash& hash)
+{
+	if ( length < 4 + sizeof(hash.m_words) ) return false;
+
+	memcpy( hash.m_words, static_cast<const uint8_t*>(bytecode) + 4, sizeof(hash.m_words) );
+	return true;
+}
+
+template<typename Char>
+static bool ParseHash(std::basic_string_view<Char> text, Effects::ShaderHash& hash)
+{
+	Effects::ShaderHash result;
+	size_t numDigits = 0;
+	for ( Char c : text )
+	{
+		uint32_t digit;
+		if ( c >= '0' && c <= '9' ) digit = c - '0';
+		else if ( c >= 'a' && c <= 'f' ) digit = c - 'a' + 10;
+		else if ( c >= 'A' && c <= 'F' ) digit = c - 'A' + 10;
+		else if ( c == ' ' || c == '\t' || c == ',' || c == '-' ) continue;
+		else return false;
+
+		if ( numDigits == 32 ) return false;
+
+		uint32_t& word = result.m_words[numDigits / 8];
+		word = (word << 4) | digit;
+		numDigits++;
+	}
+
+	if ( numDigits != 32 ) return false;
+
+	hash = result;
+	return true;
+}
+
+bool Effects::ParseShaderHash(std::wstring_view text, ShaderHash& hash)
+{
+	return ParseHash( text, hash );
+}
+
+bool Effects::ParseShaderHash(std::string_view text, ShaderHash& hash)
+{
+	return ParseHash( text, hash );
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Lookup of shaders by their DXBC checksum - the 128-bit hash fxc stores right after the "DXBC" magic.
+// Kept free of Windows headers, so it can be tested off Windows.
+namespace Effects
+{
+
+struct ShaderHash
+{
+	uint32_t m_words[4] {};
+
+	constexpr bool operator==( const ShaderHash& other ) const
+	{
+		return m_words[0] == other.m_words[0] && m_words[1] == other.m_words[1] && m_words[2] == other.m_words[2] && m_words[3] == other.m_words[3];
+	}
+
+	constexpr bool operator<( const ShaderHash& other ) const
+	{
+		for ( size_t i = 0; i < 4; i++ )
+		{
+			if ( m_words[i] != other.m_words[i] ) return m_words[i] < other.m_words[i];
+		}
+		return false;
+	}
+};
+
+// Returns false if the bytecode is too short to contain a checksum
+bool ReadShaderHash( const void* bytecode, size_t length, ShaderHash& hash );
+
+// Parses a hash written as 32 hex digits, in the same word order as ReadShaderHash reads it.
+// Digits may be grouped with spaces, commas or dashes, e.g. "f3896ba8-4f0671da-a690e62a-c9168288"
+bool ParseShaderHash( std::wstring_view text, ShaderHash& hash );
+bool ParseShaderHash( std::string_view text, ShaderHash& hash );
+
+template<typename T>
+struct ShaderHashEntry
+{
+	ShaderHash m_hash;
+	T m_value;
+};
+
+// Sorts a table at compile time, so it can be written in any order
+template<typename T, size_t N>
+constexpr std::array<ShaderHashEntry<T>, N> SortShaderHashes( std::array<ShaderHashEntry<T>, N> entries )
+{
+	for ( size_t i = 1; i < N; i++ )
+	{
+		for ( size_t j = i; j > 0 && entries[j].m_hash < entries[j - 1].m_hash; j-- )
+		{
+			const ShaderHashEntry<T> temp = entries[j];
+			entries[j] = entries[j - 1];
+			entries[j - 1] = temp;
+		}
+	}
+	return entries;
+}
+
+template<typename T, size_t N>
+constexpr bool AreShaderHashesUnique( const std::array<ShaderHashEntry<T>, N>& sortedEntries )
+{
+	for ( size_t i = 1; i < N; i++ )
+	{
+		if ( sortedEntries[i].m_hash == sortedEntries[i - 1].m_hash ) return false;
+	}
+	return true;
+}
+
+// Built-in sorted table, optionally extended at load time - both are binary searched, and added entries take precedence.
+// Entries must only be added before lookups can happen from other threads.
+template<typename T>
+class ShaderHashTable
+{
+public:
+	template<size_t N>
+	explicit ShaderHashTable( const std::array<ShaderHashEntry<T>, N>& sortedEntries )
+		: m_builtIn( sortedEntries.data() ), m_numBuiltIn( N )
+	{
+	}
+
+	void Add( const ShaderHash& hash, T value )
+	{
+		auto it = LowerBound( m_added.data(), m_added.data() + m_added.size(), hash );
+		if ( it != m_added.data() + m_added.size() && it->m_hash == hash )
+		{
+			it->m_value = value;
+			return;
+		}
+		m_added.insert( m_added.begin() + (it - m_added.data()), ShaderHashEntry<T> { hash, value } );
+	}
+
+	// Returns nullptr if not found
+	const T* Find( const ShaderHash& hash ) const
+	{
+		if ( const T* value = Find( m_added.data(), m_added.data() + m_added.size(), hash ) )
+		{
+			return value;
+		}
+		return Find( m_builtIn, m_builtIn + m_numBuiltIn, hash );
+	}
+
+private:
+	template<typename Entry>
+	static Entry* LowerBound( Entry* begin, Entry* end, const ShaderHash& hash )
+	{
+		size_t count = end - begin;
+		while ( count > 0 )
+		{
+			const size_t step = count / 2;
+			if ( begin[step].m_hash < hash )
+			{
+				begin += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+		return begin;
+	}
+
+	static const T* Find( const ShaderHashEntry<T>* begin, const ShaderHashEntry<T>* end, const ShaderHash& hash )
+	{
+		const ShaderHashEntry<T>* it = LowerBound( begin, end, hash );
+		return it != end && it->m_hash == hash ? &it->m_value : nullptr;
+	}
+
+	const ShaderHashEntry<T>* m_builtIn;
+	size_t m_numBuiltIn;
+	std::vector<ShaderHashEntry<T>> m_added;
+};
+
+};
@@ -0,0 +1,286 @@
+#include "ShaderManifest.h"
+
+#include <cmath>
+
+static constexpr std::array<Effects::ShaderHashEntry<uint32_t>, 0> NO_BUILT_IN_ENTRIES {};
+
+static std::string_view Trim( std::string_view str )
+{
+	constexpr std::string_view whitespace = " \t\r";
+
+	const size_t begin = str.find_first_not_of( whitespace );
+	if ( begin == std::string_view::npos ) return {};
+
+	const size_t end = str.find_last_not_of( whitespace );
+	return str.substr( begin, end - begin + 1 );
+}
+
+// Comments start with ; or # at the beginning of the line or after whitespace, so paths like shaders#2/merger.cso are kept
+static std::string_view StripComment( std::string_view line )
+{
+	for ( size_t i = 0; i < line.size(); i++ )
+	{
+		if ( (line[i] == ';' || line[i] == '#') && (i == 0 || line[i - 1] == ' ' || line[i - 1] == '\t') )
+		{
+			return line.substr( 0, i );
+		}
+	}
+	return line;
+}
+
+static bool ParseUnsigned( std::string_view str, uint32_t& value )
+{
+	if ( str.empty() || str.size() > 9 ) return false;
+
+	uint32_t result = 0;
+	for ( char c : str )
+	{
+		if ( c < '0' || c > '9' ) return false;
+		result = result * 10 + (c - '0');
+	}
+	value = result;
+	return true;
+}
+
+// Parses a decimal float, like 1, -0.5, .25 or 1.5e-3 - locale independent, unlike strtof
+static bool ParseFloat( std::string_view str, float& value )
+{
+	size_t pos = 0;
+	bool negative = false;
+	if ( pos < str.size() && (str[pos] == '-' || str[pos] == '+') )
+	{
+		negative = str[pos++] == '-';
+	}
+
+	double mantissa = 0.0;
+	int exponent = 0;
+	bool hasDigits = false;
+	for ( ; pos < str.size() && str[pos] >= '0' && str[pos] <= '9'; pos++ )
+	{
+		mantissa = mantissa * 10.0 + (str[pos] - '0');
+		hasDigits = true;
+	}
+	if ( pos < str.size() && str[pos] == '.' )
+	{
+		for ( pos++; pos < str.size() && str[pos] >= '0' && str[pos] <= '9'; pos++ )
+		{
+			mantissa = mantissa * 10.0 + (str[pos] - '0');
+			exponent--;
+			hasDigits = true;
+		}
+	}
+	if ( !hasDigits ) return false;
+
+	if ( pos < str.size() && (str[pos] == 'e' || str[pos] == 'E') )
+	{
+		pos++;
+		bool negativeExponent = false;
+		if ( pos < str.size() && (str[pos] == '-' || str[pos] == '+') )
+		{
+			negativeExponent = str[pos++] == '-';
+		}
+
+		uint32_t exponentValue;
+		if ( !ParseUnsigned( str.substr( pos ), exponentValue ) ) return false;
+		exponent += negativeExponent ? -static_cast<int>(exponentValue) : static_cast<int>(exponentValue);
+		pos = str.size();
+	}
+	if ( pos != str.size() ) return false;
+
+	const double result = mantissa * std::pow( 10.0, exponent );
+	if ( !std::isfinite( result ) || result > 3.402823466e+38 ) return false;
+
+	value = static_cast<float>( negative ? -result : result );
+	return true;
+}
+
+// Parses a key in the form of prefixN or prefixN_suffix
+static bool ParseSlotKey( std::string_view key, std::string_view prefix, std::string_view suffix, uint32_t numSlots, uint32_t& slot )
+{
+	if ( key.size() <= prefix.size() + suffix.size() ) return false;
+	if ( key.substr( 0, prefix.size() ) != prefix || key.substr( key.size() - suffix.size() ) != suffix ) return false;
+
+	return ParseUnsigned( key.substr( prefix.size(), key.size() - prefix.size() - suffix.size() ), slot ) && slot < numSlots;
+}
+
+bool Effects::ShaderManifestEntry::HasBindingChanges() const
+{
+	if ( m_numConstantBuffers != 0 ) return true;
+	for ( int8_t slot : m_shaderResourceRemap )
+	{
+		if ( slot != KEEP_SLOT ) return true;
+	}
+	return false;
+}
+
+Effects::ShaderManifest::ShaderManifest()
+	: m_index( NO_BUILT_IN_ENTRIES )
+{
+}
+
+size_t Effects::ShaderManifest::Parse(std::string_view text)
+{
+	struct PendingConstantBuffer
+	{
+		bool m_set = false;
+		uint32_t m_declaredSize = 0;
+		uint32_t m_firstValue = 0;
+		uint32_t m_numValues = 0;
+	};
+
+	size_t numMalformed = 0;
+
+	bool inSection = false;
+	ShaderManifestEntry entry;
+	PendingConstantBuffer constantBuffers[ShadowState::NUM_CONSTANT_BUFFERS];
+	size_t sectionFirstValue = m_values.size();
+
+	auto beginSection = [&]( const ShaderHash& hash ) {
+		inSection = true;
+		entry = ShaderManifestEntry();
+		entry.m_hash = hash;
+		entry.m_shaderResourceRemap.fill( ShaderManifestEntry::KEEP_SLOT );
+		for ( auto& cb : constantBuffers ) cb = PendingConstantBuffer();
+		sectionFirstValue = m_values.size();
+	};
+
+	auto endSection = [&] {
+		if ( !inSection ) return;
+		inSection = false;
+
+		if ( entry.m_shaderPath.empty() )
+		{
+			// Nothing to swap to, drop values this section added
+			m_values.resize( sectionFirstValue );
+			numMalformed++;
+			return;
+		}
+
+		entry.m_firstConstantBuffer = static_cast<uint32_t>(m_constantBuffers.size());
+		for ( uint32_t slot = 0; slot < ShadowState::NUM_CONSTANT_BUFFERS; slot++ )
+		{
+			const PendingConstantBuffer& cb = constantBuffers[slot];
+			if ( !cb.m_set ) continue;
+
+			const uint32_t valuesSize = (cb.m_numValues * sizeof(float) + 15) & ~15u;
+			const uint32_t declaredSize = (cb.m_declaredSize + 15) & ~15u;
+			const uint32_t size = valuesSize > declaredSize ? valuesSize : declaredSize;
+			if ( size == 0 || size > MAX_CONSTANT_BUFFER_SIZE )
+			{
+				numMalformed++;
+				continue;
+			}
+			m_constantBuffers.push_back( { slot, size, cb.m_firstValue, cb.m_numValues } );
+		}
+		entry.m_numConstantBuffers = static_cast<uint32_t>(m_constantBuffers.size()) - entry.m_firstConstantBuffer;
+
+		m_index.Add( entry.m_hash, static_cast<uint32_t>(m_entries.size()) );
+		m_entries.push_back( entry );
+	};
+
+	while ( !text.empty() )
+	{
+		const size_t lineEnd = text.find( '\n' );
+		std::string_view line = text.substr( 0, lineEnd );
+		text = lineEnd != std::string_view::npos ? text.substr( lineEnd + 1 ) : std::string_view();
+
+		line = Trim( StripComment( line ) );
+		if ( line.empty() ) continue;
+
+		if ( line.front() == '[' )
+		{
+			endSection();
+
+			ShaderHash hash;
+			if ( line.back() != ']' || !ParseShaderHash( line.substr( 1, line.size() - 2 ), hash ) )
+			{
+				// Keys that follow are skipped along with the section
+				numMalformed++;
+				continue;
+			}
+			beginSection( hash );
+			continue;
+		}
+
+		const size_t equals = line.find( '=' );
+		if ( !inSection || equals == std::string_view::npos )
+		{
+			numMalformed++;
+			continue;
+		}
+
+		const std::string_view key = Trim( line.substr( 0, equals ) );
+		const std::string_view value = Trim( line.substr( equals + 1 ) );
+
+		uint32_t slot;
+		if ( key == "shader" )
+		{
+			if ( value.empty() )
+			{
+				numMalformed++;
+				continue;
+			}
+			entry.m_shaderPath = value;
+		}
+		else if ( ParseSlotKey( key, "cb", "_size", ShadowState::NUM_CONSTANT_BUFFERS, slot ) )
+		{
+			uint32_t size;
+			if ( !ParseUnsigned( value, size ) || size > MAX_CONSTANT_BUFFER_SIZE )
+			{
+				numMalformed++;
+				continue;
+			}
+			constantBuffers[slot].m_set = true;
+			constantBuffers[slot].m_declaredSize = size;
+		}
+		else if ( ParseSlotKey( key, "cb", "", ShadowState::NUM_CONSTANT_BUFFERS, slot ) )
+		{
+			const size_t firstValue = m_values.size();
+			bool valid = true;
+			for ( std::string_view values = value; valid && !values.empty(); )
+			{
+				const size_t separator = values.find_first_of( " \t," );
+				const std::string_view token = values.substr( 0, separator );
+				values = separator != std::string_view::npos ? values.substr( separator + 1 ) : std::string_view();
+				if ( token.empty() ) continue;
+
+				float number;
+				valid = ParseFloat( token, number ) && m_values.size() - firstValue < MAX_CONSTANT_BUFFER_SIZE / sizeof(float);
+				if ( valid ) m_values.push_back( number );
+			}
+
+			if ( !valid || m_values.size() == firstValue )
+			{
+				m_values.resize( firstValue );
+				numMalformed++;
+				continue;
+			}
+			constantBuffers[slot].m_set = true;
+			constantBuffers[slot].m_firstValue = static_cast<uint32_t>(firstValue);
+			constantBuffers[slot].m_numValues = static_cast<uint32_t>(m_values.size() - firstValue);
+		}
+		else if ( ParseSlotKey( key, "srv", "", ShadowState::NUM_SHADER_RESOURCES, slot ) )
+		{
+			uint32_t sourceSlot;
+			if ( !ParseUnsigned( value, sourceSlot ) || sourceSlot >= ShadowState::NUM_SHADER_RESOURCES )
+			{
+				numMalformed++;
+				continue;
+			}
+			entry.m_shaderResourceRemap[slot] = static_cast<int8_t>(sourceSlot);
+		}
+		else
+		{
+			numMalformed++;
+		}
+	}
+	endSection();
+
+	return numMalformed;
+}
+
+auto Effects::ShaderManifest::Find(const ShaderHash& hash) const -> const ShaderManifestEntry*
+{
+	const uint32_t* index = m_index.Find( hash );
+	return index != nullptr ? &m_entries[*index] : nullptr;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "ShaderHashTable.h"
+#include "ShadowState.h"
+
+namespace Effects
+{
+
+// Pixel shader swap described by the manifest
+struct ShaderManifestEntry
+{
+	static constexpr int8_t KEEP_SLOT = -1;
+
+	struct ConstantBuffer
+	{
+		uint32_t m_slot;
+		uint32_t m_size; // In bytes, a multiple of 16 big enough for all values
+		uint32_t m_firstValue; // Index into ShaderManifest::GetValues()
+		uint32_t m_numValues;
+	};
+
+	ShaderHash m_hash;
+	std::string_view m_shaderPath; // Compiled replacement, relative to the manifest
+	uint32_t m_firstConstantBuffer = 0; // Index into ShaderManifest::GetConstantBuffers()
+	uint32_t m_numConstantBuffers = 0;
+	std::array<int8_t, ShadowState::NUM_SHADER_RESOURCES> m_shaderResourceRemap; // Source slot of the game's SRVs for each slot, or KEEP_SLOT
+
+	bool HasBindingChanges() const;
+};
+
+// Text manifest of pixel shader swaps, so new swaps can ship as data instead of code.
+// Each swap is a section named after the DXBC checksum of the original shader, followed by its keys:
+//
+//   [f3896ba8-4f0671da-a690e62a-c9168288]
+//   shader = bloom_merger_ps.cso   ; Compiled replacement, relative to the manifest - required
+//   cb3 = 1.5 0.0 0.0 0.0          ; Immutable constant buffer bound to b3 instead of the game's one
+//   cb3_size = 512                 ; Optional, if the replacement declares a bigger buffer than the values given
+//   srv0 = 2                       ; The game's t2 is bound to t0 instead
+//   srv1 = 0
+//
+// ; or # at the start of a line or after whitespace begins a comment. Malformed lines are counted and skipped, sections without a shader are dropped.
+// Slots are limited to those tracked by ShadowState.
+// Entries only reference the text, which must outlive the manifest.
+// Kept free of Windows headers, so it can be tested off Windows.
+class ShaderManifest
+{
+public:
+	static constexpr uint32_t MAX_CONSTANT_BUFFER_SIZE = 65536; // D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16
+
+	ShaderManifest();
+
+	// Returns the number of malformed lines skipped
+	size_t Parse( std::string_view text );
+
+	const ShaderManifestEntry* Find( const ShaderHash& hash ) const;
+
+	const std::vector<ShaderManifestEntry>& GetEntries() const { return m_entries; }
+	const std::vector<ShaderManifestEntry::ConstantBuffer>& GetConstantBuffers() const { return m_constantBuffers; }
+	const std::vector<float>& GetValues() const { return m_values; }
+
+private:
+	std::vector<ShaderManifestEntry> m_entries;
+	std::vector<ShaderManifestEntry::ConstantBuffer> m_constantBuffers;
+	std::vector<float> m_values;
+	ShaderHashTable<uint32_t> m_index; // Into m_entries, later sections with the same checksum take precedence
+};
+
+};
@@ -0,0 +1,203 @@
+#include "ShaderReplacements.h"
+
+#include <Windows.h>
+#include <Shlwapi.h>
+
+#include <algorithm>
+
+#include "ScopedPassState.h"
+#include "ShaderHashTable.h"
+
+extern wchar_t wcModulePath[MAX_PATH];
+
+// Maps a whole file for reading, returns nullptr if it's missing or empty
+static wil::unique_mapview_ptr<char> MapFile( const wchar_t* path, size_t& size )
+{
+	wil::unique_hfile file( CreateFileW( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+	if ( !file.is_valid() ) return nullptr;
+
+	LARGE_INTEGER fileSize;
+	if ( GetFileSizeEx( file.get(), &fileSize ) == FALSE || fileSize.QuadPart == 0 || fileSize.HighPart != 0 ) return nullptr;
+
+	// The view keeps the file mapped after both handles are closed
+	wil::unique_handle mapping( CreateFileMappingW( file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr ) );
+	if ( !mapping.is_valid() ) return nullptr;
+
+	wil::unique_mapview_ptr<char> view( static_cast<char*>(MapViewOfFile( mapping.get(), FILE_MAP_READ, 0, 0, 0 )) );
+	if ( view != nullptr )
+	{
+		size = fileSize.LowPart;
+	}
+	return view;
+}
+
+void Effects::ShaderReplacements::LoadManifest()
+{
+	wchar_t path[MAX_PATH];
+	wcscpy_s( path, wcModulePath );
+	PathRemoveExtensionW( path );
+	if ( wcscat_s( path, L"_shaders.ini" ) != 0 ) return;
+
+	size_t size = 0;
+	m_manifestView = MapFile( path, size );
+	if ( m_manifestView == nullptr ) return;
+
+	wcscpy_s( m_directory, path );
+	PathRemoveFileSpecW( m_directory );
+
+	m_manifest.Parse( std::string_view( m_manifestView.get(), size ) );
+
+	m_shaders = std::make_unique<LazyResource<ID3D11PixelShader>[]>( m_manifest.GetEntries().size() );
+	m_constantBuffers = std::make_unique<LazyResource<ID3D11Buffer>[]>( m_manifest.GetConstantBuffers().size() );
+}
+
+void Effects::ShaderReplacements::PrecreateShaders(JobSystem& jobs)
+{
+	for ( const ShaderManifestEntry& entry : m_manifest.GetEntries() )
+	{
+		jobs.Submit( [this, &entry] { GetAlternatePixelShader( entry ); } );
+	}
+}
+
+bool Effects::ShaderReplacements::ClassifyPixelShader(ID3D11PixelShader* shader, const void* bytecode, SIZE_T length, PixelShaderInfo& info)
+{
+	if ( m_manifest.GetEntries().empty() ) return false;
+
+	ShaderHash hash;
+	if ( !ReadShaderHash( bytecode, length, hash ) ) return false;
+
+	const ShaderManifestEntry* entry = m_manifest.Find( hash );
+	if ( entry == nullptr ) return false;
+
+	AnnotatePixelShader( shader, ResourceMetadata::Type::ManifestShader, false );
+
+	info.m_type = ResourceMetadata::Type::ManifestShader;
+	info.m_manifestEntry = entry;
+	return true;
+}
+
+Effects::HookMask Effects::ShaderReplacements::GetHooks(const Settings& /*settings*/) const
+{
+	if ( m_manifest.GetEntries().empty() ) return 0;
+	return HookBit( HookPoint::BeforePSSetShader ) | HookBit( HookPoint::Draw ) | HookBit( HookPoint::DrawIndexed ) | HookBit( HookPoint::OtherDraw );
+}
+
+void Effects::ShaderReplacements::BeforePSSetShader(const HookContext& /*hook*/, EffectContextState& effectState, PixelShaderSet& shaderSet)
+{
+	ContextState& contextState = static_cast<ContextState&>(effectState);
+	contextState.m_activeEntry = nullptr;
+
+	const PixelShaderInfo& info = shaderSet.m_info;
+	if ( info.m_manifestEntry != nullptr )
+	{
+		if ( ID3D11PixelShader* alternateShader = GetAlternatePixelShader( *info.m_manifestEntry ) )
+		{
+			if ( info.m_manifestEntry->HasBindingChanges() )
+			{
+				contextState.m_activeEntry = info.m_manifestEntry;
+			}
+			shaderSet.m_shader = alternateShader;
+		}
+	}
+}
+
+template<typename DrawFunc>
+bool Effects::ShaderReplacements::DrawWithManifestState(const HookContext& hook, const EffectContextState& effectState, DrawFunc&& draw)
+{
+	const ContextState& contextState = static_cast<const ContextState&>(effectState);
+	ID3D11DeviceContext* context = hook.m_context;
+	const ShadowState& shadowState = hook.m_shadowState;
+
+	if ( contextState.m_activeEntry != nullptr )
+	{
+		GPUProfiler::Scope profile( m_profiler, context, GPUProfiler::Pass::ManifestShaders );
+
+		ScopedPassState passState( context, shadowState );
+		BindManifestState( passState, *contextState.m_activeEntry, shadowState );
+
+		draw( context );
+		return true;
+	}
+	return false;
+}
+
+bool Effects::ShaderReplacements::OnDraw(const HookContext& hook, EffectContextState& effectState, UINT VertexCount, UINT StartVertexLocation)
+{
+	return DrawWithManifestState( hook, effectState, [&]( ID3D11DeviceContext* context ) {
+		context->Draw( VertexCount, StartVertexLocation );
+	} );
+}
+
+bool Effects::ShaderReplacements::OnDrawIndexed(const HookContext& hook, EffectContextState& effectState, UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation)
+{
+	return DrawWithManifestState( hook, effectState, [&]( ID3D11DeviceContext* context ) {
+		context->DrawIndexed( IndexCount, StartIndexLocation, BaseVertexLocation );
+	} );
+}
+
+bool Effects::ShaderReplacements::OnOtherDraw(const HookContext& hook, EffectContextState& effectState, const DrawCall& drawCall)
+{
+	return DrawWithManifestState( hook, effectState, [&]( ID3D11DeviceContext* context ) {
+		drawCall.Issue( context );
+	} );
+}
+
+ID3D11PixelShader* Effects::ShaderReplacements::GetAlternatePixelShader(const ShaderManifestEntry& entry)
+{
+	const size_t index = &entry - m_manifest.GetEntries().data();
+	return m_shaders[index].Get( [&]( ID3D11PixelShader** alternateShader ) -> HRESULT {
+		wchar_t fileName[MAX_PATH];
+		const int fileNameLength = MultiByteToWideChar( CP_UTF8, MB_ERR_INVALID_CHARS, entry.m_shaderPath.data(), static_cast<int>(entry.m_shaderPath.size()), fileName, _countof(fileName) - 1 );
+		if ( fileNameLength == 0 ) return HRESULT_FROM_WIN32( GetLastError() );
+		fileName[fileNameLength] = L'\0';
+
+		wchar_t path[MAX_PATH];
+		wcscpy_s( path, m_directory );
+		if ( PathAppendW( path, fileName ) == FALSE ) return E_INVALIDARG;
+
+		size_t shaderSize = 0;
+		wil::unique_mapview_ptr<char> shaderView = MapFile( path, shaderSize );
+		if ( shaderView == nullptr ) return E_FAIL;
+
+		return m_device->CreatePixelShader( shaderView.get(), shaderSize, nullptr, alternateShader );
+	} );
+}
+
+void Effects::ShaderReplacements::BindManifestState(ScopedPassState& passState, const ShaderManifestEntry& entry, const ShadowState& shadowState)
+{
+	const ShadowState::State& state = shadowState.Get();
+	for ( UINT slot = 0; slot < ShadowState::NUM_SHADER_RESOURCES; slot++ )
+	{
+		const int8_t sourceSlot = entry.m_shaderResourceRemap[slot];
+		if ( sourceSlot != ShaderManifestEntry::KEEP_SLOT )
+		{
+			passState.SetShaderResource( slot, state.m_shaderResources[sourceSlot] );
+		}
+	}
+
+	const std::vector<float>& values = m_manifest.GetValues();
+	const auto& constantBuffers = m_manifest.GetConstantBuffers();
+	for ( uint32_t i = entry.m_firstConstantBuffer; i < entry.m_firstConstantBuffer + entry.m_numConstantBuffers; i++ )
+	{
+		const ShaderManifestEntry::ConstantBuffer& cb = constantBuffers[i];
+		ID3D11Buffer* buffer = m_constantBuffers[i].Get( [&]( ID3D11Buffer** constantBuffer ) {
+			// Values not given in the manifest are zeroed
+			std::vector<float> data( cb.m_size / sizeof(float) );
+			std::copy( values.begin() + cb.m_firstValue, values.begin() + cb.m_firstValue + cb.m_numValues, data.begin() );
+
+			D3D11_BUFFER_DESC cbDesc {};
+			cbDesc.ByteWidth = cb.m_size;
+			cbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+			cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+			D3D11_SUBRESOURCE_DATA initialData {};
+			initialData.pSysMem = data.data();
+			return m_device->CreateBuffer( &cbDesc, &initialData, constantBuffer );
+		} );
+
+		if ( buffer != nullptr )
+		{
+			passState.SetConstantBuffer( cb.m_slot, buffer );
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+
+#include "../wil/resource.h"
+
+#include "Effect.h"
+#include "GPUProfiler.h"
+#include "LazyResource.h"
+#include "ShaderManifest.h"
+
+using namespace Microsoft::WRL;
+
+namespace Effects
+{
+
+class ScopedPassState;
+
+// Pixel shader swaps shipped as data - see ShaderManifest for the format.
+// The manifest sits next to the module as <module>_shaders.ini, and only covers shaders no other effect handles.
+// Replacements are created the first time the game sets the matching shader,
+// and get their constant buffers and shader resources rebound for their draws only - every kind of draw is hooked,
+// so a replacement never runs without the bindings it was written for.
+class ShaderReplacements : public Effect
+{
+public:
+	// State of a single device context, owned by the context
+	struct ContextState : EffectContextState
+	{
+		const ShaderManifestEntry* m_activeEntry = nullptr; // Set while a replacement with binding changes is bound
+	};
+
+	ShaderReplacements( ID3D11Device* device, GPUProfiler& profiler )
+		: m_device( device ), m_profiler( profiler )
+	{
+	}
+
+	// Maps the manifest, must be called before any shaders are created
+	void LoadManifest();
+
+	// Queues creation of all replacements, the manifest has no settings to tell which ones will be used
+	void PrecreateShaders( JobSystem& jobs ) override;
+
+	// Hooked only if the manifest has any entries
+	HookMask GetHooks( const Settings& settings ) const override;
+	std::unique_ptr<EffectContextState> CreateContextState() const override { return std::make_unique<ContextState>(); }
+
+	// Fills the shader info if the manifest has a replacement for the shader
+	bool ClassifyPixelShader( ID3D11PixelShader* shader, const void* bytecode, SIZE_T length, PixelShaderInfo& info );
+
+	// Machine state functions
+	void BeforePSSetShader( const HookContext& hook, EffectContextState& effectState, PixelShaderSet& shaderSet ) override;
+	bool OnDraw( const HookContext& hook, EffectContextState& effectState, UINT VertexCount, UINT StartVertexLocation ) override;
+	bool OnDrawIndexed( const HookContext& hook, EffectContextState& effectState, UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation ) override;
+	bool OnOtherDraw( const HookContext& hook, EffectContextState& effectState, const DrawCall& drawCall ) override;
+
+private:
+	ID3D11PixelShader* GetAlternatePixelShader( const ShaderManifestEntry& entry );
+	void BindManifestState( ScopedPassState& passState, const ShaderManifestEntry& entry, const ShadowState& shadowState );
+
+	// Makes the game's draw with the manifest bindings of the active replacement, returns false if none is active
+	template<typename DrawFunc>
+	bool DrawWithManifestState( const HookContext& hook, const EffectContextState& effectState, DrawFunc&& draw );
+
+	ID3D11Device* m_device; // Effect cannot outlive the device
+	GPUProfiler& m_profiler;
+
+	wil::unique_mapview_ptr<char> m_manifestView; // Manifest entries point into the mapped text
+	ShaderManifest m_manifest;
+	std::unique_ptr<LazyResource<ID3D11PixelShader>[]> m_shaders; // Parallel to the manifest's entries
+	std::unique_ptr<LazyResource<ID3D11Buffer>[]> m_constantBuffers; // Parallel to the manifest's constant buffers
+	wchar_t m_directory[MAX_PATH] {};
+};
+
+};
@@ -0,0 +1,116 @@
+#include "ShadowState.h"
+
+#include <cstddef>
+
+// Only the tracked part of the range is copied, a null array unbinds the whole range
+template<typename T, size_t N>
+static void SetSlots(T* (&slots)[N], uint32_t startSlot, uint32_t numObjects, T* const* objects)
+{
+	for ( uint32_t i = 0; i < numObjects && startSlot + i < N; i++ )
+	{
+		slots[startSlot + i] = objects != nullptr ? objects[i] : nullptr;
+	}
+}
+
+void Effects::ShadowState::OnIASetVertexBuffers(uint32_t startSlot, uint32_t numBuffers, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets)
+{
+	if ( startSlot == 0 && numBuffers > 0 )
+	{
+		m_state.m_vertexBuffer.m_buffer = buffers != nullptr ? buffers[0] : nullptr;
+		m_state.m_vertexBuffer.m_stride = strides != nullptr ? strides[0] : 0;
+		m_state.m_vertexBuffer.m_offset = offsets != nullptr ? offsets[0] : 0;
+	}
+}
+
+template<typename T, size_t N>
+static bool AreSlotsBound(T* const (&slots)[N], uint32_t startSlot, uint32_t numObjects, T* const* objects)
+{
+	if ( startSlot >= N || numObjects > N - startSlot ) return false;
+
+	for ( uint32_t i = 0; i < numObjects; i++ )
+	{
+		if ( slots[startSlot + i] != (objects != nullptr ? objects[i] : nullptr) ) return false;
+	}
+	return true;
+}
+
+static uint32_t SlotMask(uint32_t startSlot, uint32_t numSlots, uint32_t maxSlots)
+{
+	uint32_t mask = 0;
+	for ( uint32_t i = startSlot; i < maxSlots && i - startSlot < numSlots; i++ )
+	{
+		mask |= 1u << i;
+	}
+	return mask;
+}
+
+void Effects::ShadowState::OnPSSetShaderResources(uint32_t startSlot, uint32_t numViews, ID3D11ShaderResourceView* const* views)
+{
+	SetSlots( m_state.m_shaderResources, startSlot, numViews, views );
+	m_knownShaderResources |= SlotMask( startSlot, numViews, NUM_SHADER_RESOURCES );
+}
+
+void Effects::ShadowState::OnPSSetConstantBuffers(uint32_t startSlot, uint32_t numBuffers, ID3D11Buffer* const* buffers)
+{
+	SetSlots( m_state.m_constantBuffers, startSlot, numBuffers, buffers );
+}
+
+void Effects::ShadowState::OnPSSetSamplers(uint32_t startSlot, uint32_t numSamplers, ID3D11SamplerState* const* samplers)
+{
+	SetSlots( m_state.m_samplers, startSlot, numSamplers, samplers );
+}
+
+void Effects::ShadowState::OnOMSetRenderTargets(uint32_t numViews, ID3D11RenderTargetView* const* renderTargets, ID3D11DepthStencilView* depthStencil)
+{
+	// Anything bound as an output is unbound from inputs by the runtime, and even with render targets kept, UAVs may have changed
+	m_knownShaderResources = 0;
+	if ( numViews == KEEP_RENDER_TARGETS ) return;
+
+	// Views past the bound ones are unbound
+	for ( uint32_t i = 0; i < NUM_RENDER_TARGETS; i++ )
+	{
+		m_state.m_renderTargets[i] = i < numViews && renderTargets != nullptr ? renderTargets[i] : nullptr;
+	}
+	m_state.m_depthStencil = depthStencil;
+}
+
+void Effects::ShadowState::OnOMSetBlendState(ID3D11BlendState* blendState, const float blendFactor[4], uint32_t sampleMask)
+{
+	m_state.m_blendState = blendState;
+	for ( int i = 0; i < 4; i++ )
+	{
+		// Null blend factor is the same as all ones
+		m_state.m_blendFactor[i] = blendFactor != nullptr ? blendFactor[i] : 1.0f;
+	}
+	m_state.m_sampleMask = sampleMask;
+}
+
+bool Effects::ShadowState::AreShaderResourcesBound(uint32_t startSlot, uint32_t numViews, ID3D11ShaderResourceView* const* views) const
+{
+	const uint32_t mask = SlotMask( startSlot, numViews, NUM_SHADER_RESOURCES );
+	return (m_knownShaderResources & mask) == mask && AreSlotsBound( m_state.m_shaderResources, startSlot, numViews, views );
+}
+
+bool Effects::ShadowState::AreConstantBuffersBound(uint32_t startSlot, uint32_t numBuffers, ID3D11Buffer* const* buffers) const
+{
+	return AreSlotsBound( m_state.m_constantBuffers, startSlot, numBuffers, buffers );
+}
+
+bool Effects::ShadowState::IsVertexBufferBound(uint32_t startSlot, uint32_t numBuffers, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) const
+{
+	if ( startSlot != 0 || numBuffers != 1 ) return false;
+
+	const VertexBuffer vertexBuffer { buffers != nullptr ? buffers[0] : nullptr, strides != nullptr ? strides[0] : 0, offsets != nullptr ? offsets[0] : 0 };
+	return m_state.m_vertexBuffer == vertexBuffer;
+}
+
+bool Effects::ShadowState::IsBlendStateBound(ID3D11BlendState* blendState, const float blendFactor[4], uint32_t sampleMask) const
+{
+	if ( m_state.m_blendState != blendState || m_state.m_sampleMask != sampleMask ) return false;
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( m_state.m_blendFactor[i] != (blendFactor != nullptr ? blendFactor[i] : 1.0f) ) return false;
+	}
+	return true;
+}
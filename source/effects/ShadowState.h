@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+
+// Objects are only tracked, never dereferenced, so forward declarations are enough
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11InputLayout;
+struct ID3D11Buffer;
+struct ID3D11RasterizerState;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct ID3D11BlendState;
+
+namespace Effects
+{
+
+// Mirrors the part of context state effects are interested in, updated by the context wrapper as the game's calls pass through,
+// so effects can read current bindings without Get calls into the runtime and AddRef/Release on every object.
+// Pointers are not owning - like the game, effects may only rely on them for as long as the objects stay bound.
+// Bindings the runtime removes implicitly (an SRV of a resource which is then bound as a render target) are not mirrored,
+// so SRVs in the shadow state may already be unbound in reality - they are only considered bound for sure until output bindings change.
+// Kept free of Windows headers, so it can be tested off Windows.
+class ShadowState
+{
+public:
+	static constexpr uint32_t NUM_SHADER_RESOURCES = 4; // PS t0-t3
+	static constexpr uint32_t NUM_CONSTANT_BUFFERS = 6; // PS b0-b5
+	static constexpr uint32_t NUM_SAMPLERS = 2; // PS s0-s1
+	static constexpr uint32_t NUM_RENDER_TARGETS = 8; // D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT
+	static constexpr uint32_t KEEP_RENDER_TARGETS = UINT32_MAX; // D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL
+
+	struct VertexBuffer
+	{
+		ID3D11Buffer* m_buffer = nullptr;
+		uint32_t m_stride = 0;
+		uint32_t m_offset = 0;
+
+		bool operator==( const VertexBuffer& other ) const
+		{
+			return m_buffer == other.m_buffer && m_stride == other.m_stride && m_offset == other.m_offset;
+		}
+		bool operator!=( const VertexBuffer& other ) const { return !(*this == other); }
+	};
+
+	// Defaults match the state of a newly created or cleared context
+	struct State
+	{
+		ID3D11VertexShader* m_vertexShader = nullptr;
+		ID3D11PixelShader* m_pixelShader = nullptr;
+		ID3D11InputLayout* m_inputLayout = nullptr;
+		VertexBuffer m_vertexBuffer; // Slot 0 only
+		ID3D11RasterizerState* m_rasterizerState = nullptr;
+		ID3D11ShaderResourceView* m_shaderResources[NUM_SHADER_RESOURCES] {};
+		ID3D11Buffer* m_constantBuffers[NUM_CONSTANT_BUFFERS] {};
+		ID3D11SamplerState* m_samplers[NUM_SAMPLERS] {};
+		ID3D11RenderTargetView* m_renderTargets[NUM_RENDER_TARGETS] {}; // Slots past the bound views are null
+		ID3D11DepthStencilView* m_depthStencil = nullptr;
+		ID3D11BlendState* m_blendState = nullptr;
+		float m_blendFactor[4] { 1.0f, 1.0f, 1.0f, 1.0f };
+		uint32_t m_sampleMask = UINT32_MAX;
+	};
+
+	const State& Get() const { return m_state; }
+
+	// Calls passing through the context wrapper, with the same semantics as their ID3D11DeviceContext counterparts
+	void OnVSSetShader( ID3D11VertexShader* shader ) { m_state.m_vertexShader = shader; }
+	void OnPSSetShader( ID3D11PixelShader* shader ) { m_state.m_pixelShader = shader; }
+	void OnIASetInputLayout( ID3D11InputLayout* inputLayout ) { m_state.m_inputLayout = inputLayout; }
+	void OnIASetVertexBuffers( uint32_t startSlot, uint32_t numBuffers, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets );
+	void OnRSSetState( ID3D11RasterizerState* rasterizerState ) { m_state.m_rasterizerState = rasterizerState; }
+	void OnPSSetShaderResources( uint32_t startSlot, uint32_t numViews, ID3D11ShaderResourceView* const* views );
+	void OnPSSetConstantBuffers( uint32_t startSlot, uint32_t numBuffers, ID3D11Buffer* const* buffers );
+	void OnPSSetSamplers( uint32_t startSlot, uint32_t numSamplers, ID3D11SamplerState* const* samplers );
+	void OnOMSetRenderTargets( uint32_t numViews, ID3D11RenderTargetView* const* renderTargets, ID3D11DepthStencilView* depthStencil );
+	void OnOMSetBlendState( ID3D11BlendState* blendState, const float blendFactor[4], uint32_t sampleMask );
+	void OnCSSetUnorderedAccessViews() { m_knownShaderResources = 0; }
+	void OnClearState() { m_state = State(); m_knownShaderResources = ALL_SHADER_RESOURCES; }
+
+	// Whether a call would rebind exactly what's already bound - calls touching untracked slots never are
+	bool IsPixelShaderBound( ID3D11PixelShader* shader ) const { return m_state.m_pixelShader == shader; }
+	bool AreShaderResourcesBound( uint32_t startSlot, uint32_t numViews, ID3D11ShaderResourceView* const* views ) const;
+	bool AreConstantBuffersBound( uint32_t startSlot, uint32_t numBuffers, ID3D11Buffer* const* buffers ) const;
+	bool IsVertexBufferBound( uint32_t startSlot, uint32_t numBuffers, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets ) const;
+	bool IsRasterizerStateBound( ID3D11RasterizerState* rasterizerState ) const { return m_state.m_rasterizerState == rasterizerState; }
+	bool IsBlendStateBound( ID3D11BlendState* blendState, const float blendFactor[4], uint32_t sampleMask ) const;
+
+private:
+	static constexpr uint32_t ALL_SHADER_RESOURCES = (1u << NUM_SHADER_RESOURCES) - 1;
+
+	State m_state;
+	uint32_t m_knownShaderResources = ALL_SHADER_RESOURCES; // Bit set if the SRV slot cannot have been unbound by the runtime
+};
+
+};
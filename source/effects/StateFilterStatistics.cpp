@@ -0,0 +1,22 @@
+#include "StateFilterStatistics.h"
+
+const char* Effects::StateFilterStatistics::GetCallName(Call call)
+{
+	switch ( call )
+	{
+	case Call::PSSetShader:
+		return "PSSetShader";
+	case Call::PSSetShaderResources:
+		return "PSSetShaderResources";
+	case Call::PSSetConstantBuffers:
+		return "PSSetConstantBuffers";
+	case Call::OMSetBlendState:
+		return "OMSetBlendState";
+	case Call::RSSetState:
+		return "RSSetState";
+	case Call::IASetVertexBuffers:
+		return "IASetVertexBuffers";
+	default:
+		return "";
+	}
+}
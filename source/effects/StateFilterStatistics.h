@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Effects
+{
+
+// Per-frame counts of state setting calls made by the game, and how many of them rebound what was already bound.
+// Redundant calls are counted whether or not they are filtered, so the overlay can show what filtering would save.
+// Each context keeps its own, so counting needs no synchronization.
+class StateFilterStatistics
+{
+public:
+	enum class Call
+	{
+		PSSetShader,
+		PSSetShaderResources,
+		PSSetConstantBuffers,
+		OMSetBlendState,
+		RSSetState,
+		IASetVertexBuffers,
+
+		NumCalls
+	};
+
+	struct Counts
+	{
+		std::array<uint32_t, static_cast<size_t>(Call::NumCalls)> m_calls {};
+		std::array<uint32_t, static_cast<size_t>(Call::NumCalls)> m_redundant {};
+	};
+
+	void Count( Call call, bool redundant )
+	{
+		const size_t index = static_cast<size_t>(call);
+		m_current.m_calls[index]++;
+		m_current.m_redundant[index] += redundant ? 1 : 0;
+	}
+
+	void OnPresent()
+	{
+		m_lastFrame = m_current;
+		m_current = Counts();
+	}
+
+	const Counts& GetLastFrame() const { return m_lastFrame; }
+
+	static const char* GetCallName( Call call );
+
+private:
+	Counts m_current;
+	Counts m_lastFrame;
+};
+
+};
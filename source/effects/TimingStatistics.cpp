@@ -0,0 +1,49 @@
+#include "TimingStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+void Effects::TimingStatistics::AddSample(double milliseconds)
+{
+	m_samples[m_next] = milliseconds;
+	m_next = (m_next + 1) % NUM_SAMPLES;
+	m_count = std::min(m_count + 1, NUM_SAMPLES);
+}
+
+void Effects::TimingStatistics::Reset()
+{
+	m_next = 0;
+	m_count = 0;
+}
+
+auto Effects::TimingStatistics::GetSummary() const -> Summary
+{
+	Summary result;
+	if ( m_count == 0 ) return result;
+
+	// Oldest samples are overwritten first, so the first m_count samples are always the valid ones
+	std::array<double, NUM_SAMPLES> sorted;
+	std::copy_n( m_samples.begin(), m_count, sorted.begin() );
+	std::sort( sorted.begin(), sorted.begin() + m_count );
+
+	double sum = 0.0;
+	for ( size_t i = 0; i < m_count; i++ )
+	{
+		sum += sorted[i];
+	}
+
+	// Nearest-rank percentile
+	const size_t p99Rank = static_cast<size_t>(std::ceil( m_count * 0.99 ));
+
+	result.m_min = sorted[0];
+	result.m_avg = sum / m_count;
+	result.m_p99 = sorted[std::max<size_t>(p99Rank, 1) - 1];
+	result.m_count = m_count;
+	return result;
+}
+
+double Effects::TicksToMilliseconds(uint64_t begin, uint64_t end, uint64_t frequency)
+{
+	if ( end < begin || frequency == 0 ) return 0.0;
+	return static_cast<double>(end - begin) * 1000.0 / static_cast<double>(frequency);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Effects
+{
+
+// Rolling statistics over the last NUM_SAMPLES per-frame timings of a single pass.
+// Does not depend on D3D11, so it can be fed synthetic timestamps just as well.
+class TimingStatistics
+{
+public:
+	static constexpr size_t NUM_SAMPLES = 240;
+
+	struct Summary
+	{
+		double m_min = 0.0;
+		double m_avg = 0.0;
+		double m_p99 = 0.0;
+		size_t m_count = 0; // No samples collected if 0
+	};
+
+	void AddSample( double milliseconds );
+	void Reset();
+
+	Summary GetSummary() const;
+
+private:
+	std::array<double, NUM_SAMPLES> m_samples {};
+	size_t m_next = 0;
+	size_t m_count = 0;
+};
+
+// Converts a pair of timestamps to milliseconds, returns 0 for invalid input
+double TicksToMilliseconds( uint64_t begin, uint64_t end, uint64_t frequency );
+
+}
@@ -0,0 +1,275 @@
+#include "TraceCapture.h"
+
+#include <Windows.h>
+#include <Shlwapi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+extern wchar_t wcModulePath[MAX_PATH];
+
+thread_local uint32_t Effects::TraceCapture::s_depth = 0;
+thread_local uint64_t Effects::TraceCapture::s_streamCapture = 0;
+thread_local Effects::TraceCapture::Stream* Effects::TraceCapture::s_stream = nullptr;
+
+static std::atomic<uint64_t> nextCaptureSerial { 1 };
+
+Effects::TraceCapture::TraceCapture()
+	: m_serial( nextCaptureSerial.fetch_add( 1, std::memory_order_relaxed ) )
+{
+}
+
+Effects::TraceCapture::~TraceCapture()
+{
+	if ( IsCapturing() )
+	{
+		Stop();
+	}
+}
+
+bool Effects::TraceCapture::Start(uint32_t numFrames)
+{
+	if ( IsCapturing() || numFrames == 0 ) return false;
+
+	wchar_t path[MAX_PATH];
+	wcscpy_s( path, wcModulePath );
+	PathRemoveExtensionW( path );
+	if ( wcscat_s( path, L"_trace.bin" ) != 0 ) return false;
+
+	// File is created at its maximum size and truncated to the captured data once done
+	m_file.reset( CreateFileW( path, GENERIC_READ|GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr ) );
+	if ( !m_file.is_valid() ) return false;
+
+	m_mapping.reset( CreateFileMappingW( m_file.get(), nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(MAX_TRACE_SIZE), nullptr ) );
+	if ( !m_mapping.is_valid() )
+	{
+		m_file.reset();
+		return false;
+	}
+
+	m_view.reset( static_cast<uint8_t*>(MapViewOfFile( m_mapping.get(), FILE_MAP_WRITE, 0, 0, MAX_TRACE_SIZE )) );
+	if ( m_view == nullptr )
+	{
+		m_mapping.reset();
+		m_file.reset();
+		return false;
+	}
+
+	// Nothing records until the next Present, and Stop waited for calls still recording into the last capture
+	if ( m_objectIds == nullptr )
+	{
+		m_objectIds = std::make_unique<ObjectIds>( MAX_OBJECTS );
+		m_writeChunk = std::make_unique<uint8_t[]>( WRITE_CHUNK_SIZE );
+	}
+	m_objectIds->Clear();
+
+	{
+		std::lock_guard lock( m_streamsMutex );
+		for ( const std::unique_ptr<Stream>& stream : m_streams )
+		{
+			stream->m_ringBuffer.Clear();
+			stream->m_droppedCalls.store( 0, std::memory_order_relaxed );
+			stream->m_partialCallSize = 0;
+		}
+	}
+	m_numFrames = numFrames;
+	m_remainingFrames = numFrames;
+
+	m_writeOffset = sizeof(TraceHeader);
+	m_truncated = false;
+	m_quit = false;
+	m_thread = std::thread( &TraceCapture::WriterThread, this );
+
+	m_pendingStart = true;
+	return true;
+}
+
+void Effects::TraceCapture::OnPresent(const void* immediateContext)
+{
+	if ( std::exchange( m_pendingStart, false ) )
+	{
+		// Recording threads see everything Start has set up once they see this
+		m_capturing.store( true, std::memory_order_seq_cst );
+		return;
+	}
+
+	if ( !m_capturing.load( std::memory_order_relaxed ) ) return;
+
+	{
+		CallGuard present( this, immediateContext );
+		if ( present )
+		{
+			present.Record( CallType::Present );
+		}
+	}
+	m_cv.notify_one();
+
+	if ( --m_remainingFrames == 0 )
+	{
+		Stop();
+	}
+}
+
+auto Effects::TraceCapture::BeginRecording() -> Stream*
+{
+	Stream* stream = s_streamCapture == m_serial ? s_stream : FindOrAddStream();
+
+	// Pairs with Stop - either Stop sees the stream recording and waits for it, or this sees the capture stopped
+	stream->m_recording.store( true, std::memory_order_seq_cst );
+	if ( !m_capturing.load( std::memory_order_seq_cst ) )
+	{
+		EndRecording( *stream );
+		return nullptr;
+	}
+	return stream;
+}
+
+auto Effects::TraceCapture::FindOrAddStream() -> Stream*
+{
+	const std::thread::id thread = std::this_thread::get_id();
+
+	std::lock_guard lock( m_streamsMutex );
+
+	// Streams are looked up by thread, so threads switching between devices don't keep adding them
+	auto it = std::find_if( m_streams.begin(), m_streams.end(), [thread]( const std::unique_ptr<Stream>& stream ) {
+		return stream->m_owner == thread;
+	} );
+	if ( it == m_streams.end() )
+	{
+		it = m_streams.insert( m_streams.end(), std::make_unique<Stream>( thread ) );
+	}
+
+	s_streamCapture = m_serial;
+	s_stream = it->get();
+	return s_stream;
+}
+
+void Effects::TraceCapture::Record(Stream& stream, const Call& call)
+{
+	uint8_t buffer[MAX_ENCODED_CALL_SIZE];
+	const size_t size = EncodeCall( call, buffer );
+
+	if ( !stream.m_ringBuffer.Push( buffer, size ) )
+	{
+		stream.m_droppedCalls.store( stream.m_droppedCalls.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	}
+}
+
+void Effects::TraceCapture::Stop()
+{
+	m_capturing.store( false, std::memory_order_seq_cst );
+	m_pendingStart = false;
+
+	// Calls which started recording before capturing stopped may still be pushing, nothing may land in a stream after the final drain
+	uint64_t droppedCalls = 0;
+	{
+		std::lock_guard lock( m_streamsMutex );
+		for ( const std::unique_ptr<Stream>& stream : m_streams )
+		{
+			while ( stream->m_recording.load( std::memory_order_seq_cst ) )
+			{
+				std::this_thread::yield();
+			}
+			droppedCalls += stream->m_droppedCalls.load( std::memory_order_relaxed );
+		}
+	}
+
+	m_quit = true;
+	m_cv.notify_one();
+	m_thread.join();
+
+	TraceHeader header;
+	header.m_numFrames = m_numFrames - m_remainingFrames;
+	header.m_flags = m_truncated ? TraceHeader::Truncated : 0;
+	header.m_dataSize = m_writeOffset - sizeof(header);
+	header.m_droppedCalls = droppedCalls;
+	memcpy( m_view.get(), &header, sizeof(header) );
+
+	m_view.reset();
+	m_mapping.reset();
+
+	LARGE_INTEGER size;
+	size.QuadPart = m_writeOffset;
+	if ( SetFilePointerEx( m_file.get(), size, nullptr, FILE_BEGIN ) )
+	{
+		SetEndOfFile( m_file.get() );
+	}
+	m_file.reset();
+}
+
+void Effects::TraceCapture::WriterThread()
+{
+	std::vector<Stream*> streams;
+	while ( true )
+	{
+		// Don't rely on the notifications only, the ring buffers may fill up within a single frame
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_cv.wait_for( lock, std::chrono::milliseconds(5) );
+		}
+
+		// Quit is checked before draining, so the final drain sees everything written before Stop
+		const bool quit = m_quit;
+
+		// Streams are never removed, so they can be drained without holding the lock
+		{
+			std::lock_guard lock( m_streamsMutex );
+			streams.clear();
+			for ( const std::unique_ptr<Stream>& stream : m_streams )
+			{
+				streams.push_back( stream.get() );
+			}
+		}
+
+		for ( Stream* stream : streams )
+		{
+			while ( Drain( *stream ) != 0 )
+			{
+			}
+		}
+
+		if ( quit ) break;
+	}
+}
+
+size_t Effects::TraceCapture::Drain(Stream& stream)
+{
+	uint8_t* chunk = m_writeChunk.get();
+	memcpy( chunk, stream.m_partialCall, stream.m_partialCallSize );
+
+	const size_t popped = stream.m_ringBuffer.Pop( chunk + stream.m_partialCallSize, WRITE_CHUNK_SIZE - stream.m_partialCallSize );
+	const uint8_t* const end = chunk + stream.m_partialCallSize + popped;
+
+	// Only whole calls are written, so calls of different streams never mix
+	const uint8_t* cur = chunk;
+	Call call;
+	while ( DecodeCall( cur, end, call ) )
+	{
+	}
+	Write( chunk, cur - chunk );
+
+	stream.m_partialCallSize = end - cur;
+	if ( stream.m_partialCallSize >= MAX_ENCODED_CALL_SIZE )
+	{
+		// Not the start of a call, never written by Record
+		stream.m_partialCallSize = 0;
+	}
+	memcpy( stream.m_partialCall, cur, stream.m_partialCallSize );
+
+	return popped;
+}
+
+void Effects::TraceCapture::Write(const uint8_t* data, size_t size)
+{
+	// Once the file is full, the rest is discarded - later calls would not make sense with a gap before them
+	if ( m_truncated || size > MAX_TRACE_SIZE - m_writeOffset )
+	{
+		m_truncated |= size != 0;
+		return;
+	}
+
+	memcpy( m_view.get() + m_writeOffset, data, size );
+	m_writeOffset += size;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../wil/resource.h"
+
+#include "RingBuffer.h"
+#include "TraceEncoding.h"
+
+namespace Effects
+{
+
+// Captures context calls of a number of frames into a binary trace next to the module (see TraceEncoding.h for the format).
+// Each recording thread encodes calls into a ring buffer of its own, a writer thread copies them into a memory mapped file.
+// If the writer cannot keep up, calls are dropped and counted instead of stalling the game.
+// Recording takes no locks, apart from the first call a thread records into a capture, and nesting is tracked per thread.
+class TraceCapture
+{
+	struct Stream;
+
+public:
+	// Only the outermost call is recorded - calls effects make into the wrapped context are not a part of the game's stream.
+	// Calls made without a context (e.g. the UI) are not recorded, but still hide the calls nested in them
+	class CallGuard
+	{
+	public:
+		CallGuard( TraceCapture* capture, const void* context )
+			: m_capture( capture )
+		{
+			if ( m_capture != nullptr && s_depth++ == 0 && context != nullptr )
+			{
+				m_stream = m_capture->BeginRecording();
+				if ( m_stream != nullptr )
+				{
+					m_context = m_capture->GetObjectId( context );
+				}
+			}
+		}
+
+		~CallGuard()
+		{
+			if ( m_capture != nullptr )
+			{
+				if ( m_stream != nullptr )
+				{
+					EndRecording( *m_stream );
+				}
+				s_depth--;
+			}
+		}
+
+		CallGuard( const CallGuard& ) = delete;
+		CallGuard& operator=( const CallGuard& ) = delete;
+
+		explicit operator bool() const { return m_stream != nullptr; }
+
+		void Record( CallType type, uint32_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0, uint32_t arg3 = 0, uint32_t arg4 = 0 )
+		{
+			m_capture->Record( *m_stream, Call { type, m_context, { arg0, arg1, arg2, arg3, arg4 } } );
+		}
+
+		uint32_t GetObjectId( const void* object ) { return m_capture->GetObjectId( object ); }
+
+	private:
+		TraceCapture* m_capture;
+		Stream* m_stream = nullptr;
+		uint32_t m_context = 0;
+	};
+
+	TraceCapture();
+	~TraceCapture();
+
+	// Capture starts with the next frame
+	bool Start( uint32_t numFrames );
+	bool IsCapturing() const { return m_capturing.load( std::memory_order_relaxed ) || m_pendingStart; }
+	uint32_t GetRemainingFrames() const { return m_remainingFrames; }
+
+	// Context is the wrapped ID3D11DeviceContext the call is made on
+	CallGuard BeginCall( const void* context ) { return CallGuard( m_capturing.load( std::memory_order_relaxed ) ? this : nullptr, context ); }
+
+	// Frame boundary - starts a pending capture, or records Present on the immediate context and stops capturing after the last frame
+	void OnPresent( const void* immediateContext );
+
+private:
+	static constexpr size_t MAX_TRACE_SIZE = 64 * 1024 * 1024;
+	static constexpr size_t STREAM_BUFFER_SIZE = 1024 * 1024;
+	static constexpr size_t WRITE_CHUNK_SIZE = 64 * 1024;
+	static constexpr size_t MAX_OBJECTS = 64 * 1024;
+
+	// Calls recorded by a single thread, allocated the first time the thread records and kept until the capture is destroyed
+	struct Stream
+	{
+		explicit Stream( std::thread::id owner )
+			: m_owner( owner ), m_ringBuffer( STREAM_BUFFER_SIZE )
+		{
+		}
+
+		const std::thread::id m_owner;
+		RingBuffer m_ringBuffer;
+		std::atomic<bool> m_recording { false }; // Set by the owner for the duration of a call, so Stop can wait for it
+		std::atomic<uint64_t> m_droppedCalls { 0 }; // Only written by the owner
+
+		// Writer thread state - ring buffer chunks may end in the middle of a call, which is carried over to the next chunk
+		uint8_t m_partialCall[MAX_ENCODED_CALL_SIZE];
+		size_t m_partialCallSize = 0;
+	};
+
+	Stream* BeginRecording();
+	static void EndRecording( Stream& stream ) { stream.m_recording.store( false, std::memory_order_release ); }
+	Stream* FindOrAddStream();
+
+	void Record( Stream& stream, const Call& call );
+	uint32_t GetObjectId( const void* object ) { return m_objectIds->Get( object ); }
+	void Stop();
+	void WriterThread();
+	size_t Drain( Stream& stream );
+	void Write( const uint8_t* data, size_t size );
+
+	static thread_local uint32_t s_depth; // Nesting of calls on the calling thread
+
+	// Stream of the calling thread, valid if s_streamCapture matches m_serial
+	static thread_local uint64_t s_streamCapture;
+	static thread_local Stream* s_stream;
+
+	const uint64_t m_serial; // Unique for every TraceCapture, so threads never use a stream of a destroyed one
+
+	// Present thread state
+	bool m_pendingStart = false; // Set from Start until the next Present
+	uint32_t m_remainingFrames = 0;
+	uint32_t m_numFrames = 0;
+
+	// Checked without a lock by every call, and once more after a stream is marked as recording
+	std::atomic<bool> m_capturing { false };
+
+	std::mutex m_streamsMutex; // Only taken when a thread records for the first time, and by the writer to list streams
+	std::vector<std::unique_ptr<Stream>> m_streams;
+
+	std::unique_ptr<ObjectIds> m_objectIds; // Allocated on the first capture
+	wil::unique_hfile m_file;
+	wil::unique_handle m_mapping;
+	wil::unique_mapview_ptr<uint8_t> m_view;
+
+	// Writer thread state
+	std::unique_ptr<uint8_t[]> m_writeChunk;
+	size_t m_writeOffset = 0;
+	bool m_truncated = false;
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::atomic<bool> m_quit { false };
+};
+
+};
@@ -0,0 +1,163 @@
+#include "TraceEncoding.h"
+
+#include <iterator>
+#include <thread>
+
+static const size_t CALL_ARGUMENT_COUNTS[] = {
+	2, // PSSetShader
+	2, // Draw
+	3, // DrawIndexed
+	3, // OMSetRenderTargets
+	1, // OMSetBlendState
+	1, // ClearRenderTargetView
+	0, // ClearState
+	0, // Present
+
+	3, // PSSetShaderResources
+	3, // PSSetSamplers
+	3, // PSSetConstantBuffers
+	1, // VSSetShader
+	1, // IASetInputLayout
+	3, // IASetVertexBuffers
+	5, // DrawIndexedInstanced
+	4, // DrawInstanced
+	2, // DrawIndexedInstancedIndirect
+	2, // DrawInstancedIndirect
+	0, // DrawAuto
+	5, // OMSetRenderTargetsAndUnorderedAccessViews
+	1, // RSSetState
+	3, // CSSetUnorderedAccessViews
+	2, // ExecuteCommandList
+	2, // FinishCommandList
+};
+static_assert(std::size(CALL_ARGUMENT_COUNTS) == static_cast<size_t>(Effects::CallType::NumCallTypes));
+
+size_t Effects::GetCallArgumentCount(CallType type)
+{
+	return CALL_ARGUMENT_COUNTS[static_cast<size_t>(type)];
+}
+
+static size_t EncodeVarint(uint32_t value, uint8_t* buffer)
+{
+	size_t size = 0;
+	while ( value >= 0x80 )
+	{
+		buffer[size++] = static_cast<uint8_t>(value | 0x80);
+		value >>= 7;
+	}
+	buffer[size++] = static_cast<uint8_t>(value);
+	return size;
+}
+
+static bool DecodeVarint(const uint8_t*& cur, const uint8_t* end, uint32_t& value)
+{
+	value = 0;
+	for ( uint32_t shift = 0; ; shift += 7 )
+	{
+		// 32-bit values never take more than 5 bytes, and the last one only carries the top 4 bits
+		if ( cur == end || shift > 28 ) return false;
+
+		const uint8_t byte = *cur++;
+		if ( shift == 28 && byte > 0x0F ) return false;
+
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if ( (byte & 0x80) == 0 ) return true;
+	}
+}
+
+size_t Effects::EncodeCall(const Call& call, uint8_t (&buffer)[MAX_ENCODED_CALL_SIZE])
+{
+	size_t size = 0;
+	buffer[size++] = static_cast<uint8_t>(call.m_type);
+	size += EncodeVarint( call.m_context, buffer + size );
+
+	const size_t numArgs = GetCallArgumentCount( call.m_type );
+	for ( size_t i = 0; i < numArgs; i++ )
+	{
+		size += EncodeVarint( call.m_args[i], buffer + size );
+	}
+	return size;
+}
+
+bool Effects::DecodeCall(const uint8_t*& data, const uint8_t* end, Call& call)
+{
+	const uint8_t* cur = data;
+	if ( cur == end || *cur >= static_cast<uint8_t>(CallType::NumCallTypes) ) return false;
+
+	Call result;
+	result.m_type = static_cast<CallType>(*cur++);
+	if ( !DecodeVarint( cur, end, result.m_context ) ) return false;
+
+	const size_t numArgs = GetCallArgumentCount( result.m_type );
+	for ( size_t i = 0; i < numArgs; i++ )
+	{
+		if ( !DecodeVarint( cur, end, result.m_args[i] ) ) return false;
+	}
+
+	call = result;
+	data = cur;
+	return true;
+}
+
+Effects::ObjectIds::ObjectIds(size_t capacity)
+{
+	size_t size = 1;
+	while ( size < capacity )
+	{
+		size <<= 1;
+	}
+
+	m_slots = std::make_unique<Slot[]>(size);
+	m_mask = size - 1;
+}
+
+uint32_t Effects::ObjectIds::Get(const void* object)
+{
+	if ( object == nullptr ) return 0;
+
+	const uintptr_t key = reinterpret_cast<uintptr_t>(object);
+
+	// Objects are at least 16 byte aligned, so the low bits carry no information
+	uint64_t hash = static_cast<uint64_t>(key >> 4) * 0x9E3779B97F4A7C15ull;
+	hash ^= hash >> 32;
+
+	for ( size_t probe = 0; probe <= m_mask; probe++ )
+	{
+		Slot& slot = m_slots[(static_cast<size_t>(hash) + probe) & m_mask];
+
+		uintptr_t slotObject = slot.m_object.load( std::memory_order_acquire );
+		if ( slotObject == 0 )
+		{
+			if ( slot.m_object.compare_exchange_strong( slotObject, key, std::memory_order_acq_rel ) )
+			{
+				const uint32_t id = m_nextId.fetch_add( 1, std::memory_order_relaxed );
+				slot.m_id.store( id, std::memory_order_release );
+				return id;
+			}
+			// Another thread claimed the slot first, slotObject now holds its object
+		}
+
+		if ( slotObject == key )
+		{
+			// The thread which claimed the slot stores the ID right after
+			uint32_t id;
+			while ( (id = slot.m_id.load( std::memory_order_acquire )) == 0 )
+			{
+				std::this_thread::yield();
+			}
+			return id;
+		}
+	}
+
+	return OVERFLOW_ID;
+}
+
+void Effects::ObjectIds::Clear()
+{
+	for ( size_t i = 0; i <= m_mask; i++ )
+	{
+		m_slots[i].m_object.store( 0, std::memory_order_relaxed );
+		m_slots[i].m_id.store( 0, std::memory_order_relaxed );
+	}
+	m_nextId.store( 1, std::memory_order_relaxed );
+}
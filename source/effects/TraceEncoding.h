@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Effects
+{
+
+// Context calls recorded by TraceCapture - every context method the wrapper implements itself.
+// Methods forwarded to the original context (through vtable thunks or plain forwarding) are not recorded.
+// Objects are referred to by IDs instead of pointers (0 is null) and pixel shaders carry their classification,
+// so a trace can be read without the game or a GPU. Calls binding several objects record the first one only.
+enum class CallType : uint8_t
+{
+	PSSetShader, // Shader ID, ResourceMetadata::Type
+	Draw, // VertexCount, StartVertexLocation
+	DrawIndexed, // IndexCount, StartIndexLocation, BaseVertexLocation
+	OMSetRenderTargets, // NumViews, RTV0 ID, DSV ID
+	OMSetBlendState, // Blend state ID
+	ClearRenderTargetView, // RTV ID
+	ClearState,
+	Present,
+
+	PSSetShaderResources, // StartSlot, NumViews, SRV0 ID
+	PSSetSamplers, // StartSlot, NumSamplers, Sampler0 ID
+	PSSetConstantBuffers, // StartSlot, NumBuffers, Buffer0 ID
+	VSSetShader, // Shader ID
+	IASetInputLayout, // Input layout ID
+	IASetVertexBuffers, // StartSlot, NumBuffers, Buffer0 ID
+	DrawIndexedInstanced, // IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation
+	DrawInstanced, // VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation
+	DrawIndexedInstancedIndirect, // Args buffer ID, AlignedByteOffsetForArgs
+	DrawInstancedIndirect, // Args buffer ID, AlignedByteOffsetForArgs
+	DrawAuto,
+	OMSetRenderTargetsAndUnorderedAccessViews, // NumRTVs, RTV0 ID, DSV ID, UAVStartSlot, NumUAVs
+	RSSetState, // Rasterizer state ID
+	CSSetUnorderedAccessViews, // StartSlot, NumUAVs, UAV0 ID
+	ExecuteCommandList, // Command list ID, RestoreContextState
+	FinishCommandList, // Command list ID, RestoreDeferredContextState
+
+	NumCallTypes
+};
+
+constexpr size_t MAX_CALL_ARGUMENTS = 5;
+
+struct Call
+{
+	CallType m_type;
+	uint32_t m_context = 0; // Object ID of the context the call was made on
+	uint32_t m_args[MAX_CALL_ARGUMENTS] {}; // Signed arguments are stored as their two's complement representation
+};
+
+size_t GetCallArgumentCount( CallType type );
+
+// Binary form of a call stream, as written by TraceCapture:
+// TraceHeader, followed by calls encoded as a CallType byte, the context ID and the arguments as LEB128 varints.
+// Calls of each context are in order, but calls made on different threads are only interleaved roughly in time.
+struct TraceHeader
+{
+	static constexpr uint32_t MAGIC = 0x52544844; // "DHTR"
+	static constexpr uint32_t VERSION = 2;
+
+	enum Flags : uint32_t
+	{
+		Truncated = 1, // Trace file got full before all frames were captured
+	};
+
+	uint32_t m_magic = MAGIC;
+	uint32_t m_version = VERSION;
+	uint32_t m_numFrames = 0;
+	uint32_t m_flags = 0;
+	uint64_t m_dataSize = 0; // Size of encoded calls following the header
+	uint64_t m_droppedCalls = 0; // Calls not written because the writer could not keep up
+};
+
+// Type byte, context ID and arguments - a 32-bit varint takes at most 5 bytes
+constexpr size_t MAX_ENCODED_CALL_SIZE = 1 + (1 + MAX_CALL_ARGUMENTS) * 5;
+
+size_t EncodeCall( const Call& call, uint8_t (&buffer)[MAX_ENCODED_CALL_SIZE] );
+
+// Advances data past the decoded call, returns false on malformed or truncated input
+bool DecodeCall( const uint8_t*& data, const uint8_t* end, Call& call );
+
+// Assigns sequential IDs to objects in the order they are first seen, null is always 0.
+// Lock-free, so any number of threads can look up IDs at once - objects seen for the first time are added with a single CAS.
+// Objects are not referenced, so an address reused by a new object keeps the old ID.
+class ObjectIds
+{
+public:
+	static constexpr uint32_t OVERFLOW_ID = UINT32_MAX; // Given to all objects once the table is full
+
+	explicit ObjectIds( size_t capacity ); // Rounded up to a power of two
+
+	uint32_t Get( const void* object );
+	void Clear(); // Only when no thread calls Get
+
+private:
+	struct Slot
+	{
+		std::atomic<uintptr_t> m_object { 0 };
+		std::atomic<uint32_t> m_id { 0 }; // Stored right after m_object is claimed, 0 until then
+	};
+
+	std::unique_ptr<Slot[]> m_slots;
+	size_t m_mask;
+	std::atomic<uint32_t> m_nextId { 1 };
+};
+
+}
@@ -0,0 +1,29 @@
+// DXHR bloom merger (BLOOM_MERGER_PS_BYTECODE) with color grading applied to its output,
+// so color grading doesn't need a separate full-screen pass
+
+#include "dxhr_buffers.hlsli"
+#include "color_grading.hlsli"
+
+cbuffer MaterialBuffer : register(b3)
+{
+	float4 MaterialParams[32];
+};
+
+cbuffer ColorGradingBuffer : register(b4)
+{
+	float4 ColorGradingAttributes[5];
+};
+
+Texture2D BloomTexture : register(t0);
+SamplerState BloomSampler : register(s0);
+Texture2D SceneTexture : register(t1);
+SamplerState SceneSampler : register(s1);
+
+float4 main( float4 position : SV_Position ) : SV_Target
+{
+	const float2 uv = GetScreenUV( position );
+	const float3 color = BloomTexture.Sample( BloomSampler, uv ).rgb * MaterialParams[0].x + SceneTexture.Sample( SceneSampler, uv ).rgb;
+
+	// Output of a separate pass would have been written to a UNORM target and clamped
+	return float4( ApplyColorGrading( saturate( color ), uv, ColorGradingAttributes ), MaterialOpacity );
+}
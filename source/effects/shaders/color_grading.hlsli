@@ -0,0 +1,36 @@
+// Vignette of the gold filter, attributes are its exponent, strength and scale (attributes[4] below)
+float GetVignette( float2 uv, float4 attributes )
+{
+	const float2 vignetteCoords = (uv * 2.0 - 1.0) * attributes.zw;
+	return 1.0 - min( pow( dot( vignetteCoords, vignetteCoords ), attributes.x ), 1.0 ) * attributes.y;
+}
+
+// Gold filter from Deus Ex: Human Revolution, matches COLOR_GRADING_PS_BYTECODE
+// attributes[0] - intensity, saturation, temperature threshold
+// attributes[1], attributes[2], attributes[3] - cold, moderate and warm tint
+// attributes[4] - vignette exponent, vignette strength, vignette scale
+float3 ApplyColorGrading( float3 color, float2 uv, float4 attributes[5] )
+{
+	const float luminance = (color.r + color.g + color.b) / 3.0;
+	const float3 saturated = lerp( luminance, color, attributes[0].y );
+
+	const float temperature = saturate( luminance * attributes[0].z ) * 2.0 - 1.0;
+	const float3 tint = attributes[1].rgb * max( -temperature, 0.0 ) +
+						attributes[2].rgb * (1.0 - abs( temperature )) +
+						attributes[3].rgb * max( temperature, 0.0 );
+
+	const float3 graded = lerp( saturated, saturated * tint * 2.0, attributes[0].x );
+
+	return graded * GetVignette( uv, attributes[4] );
+}
+
+// Must match COLOR_GRADING_LUT_SIZE
+static const float LUT_SIZE = 32.0;
+
+// Gold filter without the vignette, read from a LUT baked on the CPU (see ColorGradingLut.h) - color must be in 0.0-1.0 range
+float3 SampleColorGradingLut( Texture3D lut, SamplerState lutSampler, float3 color )
+{
+	// Sample between the centers of the outermost texels, as they hold the grading of 0.0 and 1.0
+	const float3 lutCoords = color * ((LUT_SIZE - 1.0) / LUT_SIZE) + (0.5 / LUT_SIZE);
+	return lut.SampleLevel( lutSampler, lutCoords, 0 ).rgb;
+}
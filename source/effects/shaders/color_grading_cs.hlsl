@@ -0,0 +1,39 @@
+// Gold filter as a compute shader, grading the source into a UAV of the same size.
+// Unlike COLOR_GRADING_PS_BYTECODE, it doesn't need any graphics pipeline state borrowed from the game -
+// only the game's DrawableBuffer and SceneBuffer, rebound from the pixel shader stage.
+
+#include "dxhr_buffers.hlsli"
+#include "color_grading.hlsli"
+
+cbuffer ColorGradingBuffer : register(b5)
+{
+	float4 ColorGradingAttributes[5];
+};
+
+Texture2D SourceTexture : register(t0);
+RWTexture2D<float4> OutputTexture : register(u0);
+
+#if COLOR_GRADING_LUT
+Texture3D GradingLut : register(t1);
+SamplerState GradingLutSampler : register(s1);
+#endif
+
+[numthreads(8, 8, 1)]
+void main( uint3 id : SV_DispatchThreadID )
+{
+	uint width, height;
+	OutputTexture.GetDimensions( width, height );
+	if ( id.x >= width || id.y >= height ) return;
+
+	// Same coordinates the pixel shader gets for this pixel
+	const float2 uv = GetScreenUV( float4(id.xy + 0.5, 0.0, 1.0) );
+	const float3 color = SourceTexture.Load( int3(id.xy, 0) ).rgb;
+
+#if COLOR_GRADING_LUT
+	const float3 graded = SampleColorGradingLut( GradingLut, GradingLutSampler, saturate( color ) ) * GetVignette( uv, ColorGradingAttributes[4] );
+#else
+	const float3 graded = ApplyColorGrading( color, uv, ColorGradingAttributes );
+#endif
+
+	OutputTexture[id.xy] = float4( graded, MaterialOpacity );
+}
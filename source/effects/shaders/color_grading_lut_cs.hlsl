@@ -0,0 +1,4 @@
+// LUT mode variant of color_grading_cs.hlsl
+
+#define COLOR_GRADING_LUT 1
+#include "color_grading_cs.hlsl"
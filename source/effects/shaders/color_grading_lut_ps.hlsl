@@ -0,0 +1,24 @@
+// Gold filter read from a 3D LUT baked on the CPU (see ColorGradingLut.h), only the vignette is evaluated per pixel.
+// Drop-in replacement for COLOR_GRADING_PS_BYTECODE, for UNORM sources only - the LUT covers colors in 0.0-1.0 range.
+
+#include "dxhr_buffers.hlsli"
+#include "color_grading.hlsli"
+
+cbuffer ColorGradingBuffer : register(b5)
+{
+	float4 ColorGradingAttributes[5];
+};
+
+Texture2D SourceTexture : register(t0);
+SamplerState SourceSampler : register(s0);
+Texture3D GradingLut : register(t1);
+SamplerState GradingLutSampler : register(s1);
+
+float4 main( float4 position : SV_Position ) : SV_Target
+{
+	const float2 uv = GetScreenUV( position );
+	const float3 color = saturate( SourceTexture.Sample( SourceSampler, uv ).rgb );
+	const float3 graded = SampleColorGradingLut( GradingLut, GradingLutSampler, color );
+
+	return float4( graded * GetVignette( uv, ColorGradingAttributes[4] ), MaterialOpacity );
+}
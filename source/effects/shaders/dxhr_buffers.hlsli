@@ -0,0 +1,20 @@
+// Constant buffers set up by the game, only with the members our shaders use
+
+cbuffer DrawableBuffer : register(b1)
+{
+	float4 FogColor;
+	float4 DebugColor;
+	float MaterialOpacity;
+	float AlphaThreshold;
+};
+
+cbuffer SceneBuffer : register(b2)
+{
+	float4 SceneParams[44]; // View matrices, fog, PSSM etc.
+	float4 ScreenExtents;
+};
+
+float2 GetScreenUV( float4 position )
+{
+	return position.xy * ScreenExtents.zw + ScreenExtents.xy;
+}
@@ -0,0 +1,156 @@
+#include "TestHarness.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "../source/effects/ColorGradingLut.h"
+
+using namespace Effects;
+
+// Presets from Metadata.cpp, with the default vignette
+static const float ATTRIBUTES[][5][4] = {
+	{
+		{ 0.85f,  0.75f,  1.25f },
+		{ 0.25098f,  0.31373f,  0.28235f },
+		{ 0.60392f,  0.52627f,  0.4098f },
+		{ 0.52941f,  0.52941f,  0.52941f },
+		{ 1.0f,  0.0f,  0.7f,  0.7f },
+	},
+	{
+		{ 0.8f, 0.8f, 1.35f },
+		{ 0.37255f, 0.43922f, 0.54902f },
+		{ 0.62745f, 0.57647f, 0.31373f },
+		{ 0.54902f, 0.51765f, 0.41569f },
+		{ 1.0f,  0.0f,  0.7f,  0.7f },
+	},
+	{
+		{ 1.0f, 0.72f, 1.4f },
+		{ 0.31765f, 0.43137f, 0.40392f },
+		{ 0.58824f, 0.54902f, 0.41961f },
+		{ 0.54902f, 0.52157f, 0.44314f },
+		{ 1.0f,  0.0f,  0.7f,  0.7f },
+	},
+};
+
+// Graded output ends up in an 8-bit UNORM target, so LUT interpolation error must stay within a single step
+constexpr float TOLERANCE = 1.0f / 255.0f;
+
+static std::vector<float> BakeLut( const float attributes[5][4] )
+{
+	constexpr uint32_t size = COLOR_GRADING_LUT_SIZE;
+	std::vector<float> lut( size * size * size * 4 );
+	BakeColorGradingLut( attributes, size, lut.data() );
+	return lut;
+}
+
+// Trilinear filtering the way SampleColorGradingLut sets it up - texel centers map to 0.0 and 1.0
+static void SampleLut( const std::vector<float>& lut, const float color[3], float result[3] )
+{
+	constexpr uint32_t size = COLOR_GRADING_LUT_SIZE;
+
+	uint32_t base[3];
+	float weight[3];
+	for ( int i = 0; i < 3; i++ )
+	{
+		const float coord = color[i] * (size - 1);
+		base[i] = std::min( static_cast<uint32_t>(coord), size - 2 );
+		weight[i] = coord - base[i];
+	}
+
+	result[0] = result[1] = result[2] = 0.0f;
+	for ( uint32_t corner = 0; corner < 8; corner++ )
+	{
+		float cornerWeight = 1.0f;
+		uint32_t index = 0, stride = 1;
+		for ( int i = 0; i < 3; i++ )
+		{
+			const uint32_t offset = (corner >> i) & 1;
+			cornerWeight *= offset != 0 ? weight[i] : 1.0f - weight[i];
+			index += (base[i] + offset) * stride;
+			stride *= size;
+		}
+
+		for ( int i = 0; i < 3; i++ )
+		{
+			result[i] += lut[index * 4 + i] * cornerWeight;
+		}
+	}
+}
+
+TEST_CASE(ColorGradingLut_TexelsMatchAnalyticGrading)
+{
+	constexpr uint32_t size = COLOR_GRADING_LUT_SIZE;
+	for ( const auto& attributes : ATTRIBUTES )
+	{
+		const std::vector<float> lut = BakeLut( attributes );
+
+		// Vectorized and scalar paths must both produce exactly what the reference does
+		for ( uint32_t b = 0; b < size; b++ )
+		{
+			for ( uint32_t g = 0; g < size; g++ )
+			{
+				for ( uint32_t r = 0; r < size; r++ )
+				{
+					const float scale = 1.0f / (size - 1);
+					const float color[3] = { r * scale, g * scale, b * scale };
+					float expected[3];
+					GradeColor( color, attributes, expected );
+
+					const float* texel = &lut[((b * size + g) * size + r) * 4];
+					CHECK( texel[0] == expected[0] && texel[1] == expected[1] && texel[2] == expected[2] && texel[3] == 1.0f );
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(ColorGradingLut_SamplesMatchAnalyticGrading)
+{
+	// Off the grid, including the range edges and greys where the tint weights have their kinks
+	constexpr int steps = 47;
+	for ( const auto& attributes : ATTRIBUTES )
+	{
+		const std::vector<float> lut = BakeLut( attributes );
+
+		float maxError = 0.0f;
+		for ( int b = 0; b <= steps; b++ )
+		{
+			for ( int g = 0; g <= steps; g++ )
+			{
+				for ( int r = 0; r <= steps; r++ )
+				{
+					const float color[3] = { float(r) / steps, float(g) / steps, float(b) / steps };
+					float expected[3], sampled[3];
+					GradeColor( color, attributes, expected );
+					SampleLut( lut, color, sampled );
+
+					for ( int i = 0; i < 3; i++ )
+					{
+						maxError = std::max( maxError, std::abs( sampled[i] - expected[i] ) );
+					}
+				}
+			}
+		}
+		CHECK( maxError <= TOLERANCE );
+	}
+}
+
+TEST_CASE(ColorGradingLut_SmallSizesAreHandled)
+{
+	// Sizes not divisible by the SIMD width go through the scalar tail
+	float lut[5 * 5 * 5 * 4];
+	BakeColorGradingLut( ATTRIBUTES[0], 5, lut );
+
+	const float white[3] = { 1.0f, 1.0f, 1.0f };
+	float expected[3];
+	GradeColor( white, ATTRIBUTES[0], expected );
+
+	const float* last = &lut[(5 * 5 * 5 - 1) * 4];
+	CHECK( last[0] == expected[0] && last[1] == expected[1] && last[2] == expected[2] && last[3] == 1.0f );
+
+	// Too small to interpolate between, left untouched
+	float untouched[4] = { -1.0f, -1.0f, -1.0f, -1.0f };
+	BakeColorGradingLut( ATTRIBUTES[0], 1, untouched );
+	CHECK( untouched[0] == -1.0f );
+}
@@ -0,0 +1,67 @@
+#include "TestHarness.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <thread>
+
+#include "../source/effects/FilePoller.h"
+
+using namespace Effects;
+
+static constexpr std::chrono::milliseconds POLL_INTERVAL { 5 };
+
+// Waits for the count to reach the expected value, so a broken poller fails the test instead of hanging it
+static bool WaitForCount( const std::atomic<int>& count, int expected )
+{
+	const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while ( count.load() < expected )
+	{
+		if ( std::chrono::steady_clock::now() > timeout ) return false;
+		std::this_thread::sleep_for( POLL_INTERVAL );
+	}
+	return true;
+}
+
+TEST_CASE(FilePoller_ReportsWriteTimeChanges)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "FilePollerTests.ini";
+	std::error_code error;
+	std::filesystem::remove( path, error );
+
+	FilePoller poller( path, POLL_INTERVAL );
+	std::atomic<int> numChanges { 0 };
+	std::thread thread( [&] { poller.Run( [&] { numChanges++; } ); } );
+
+	// Give Run time to read the initial write time. Appearing counts as a change
+	std::this_thread::sleep_for( POLL_INTERVAL * 20 );
+	std::ofstream( path ) << "[Basic]\n";
+	CHECK( WaitForCount( numChanges, 1 ) );
+
+	std::filesystem::last_write_time( path, std::filesystem::last_write_time( path ) + std::chrono::seconds(10) );
+	CHECK( WaitForCount( numChanges, 2 ) );
+
+	// Nothing else changed
+	std::this_thread::sleep_for( POLL_INTERVAL * 10 );
+	CHECK( numChanges.load() == 2 );
+
+	poller.Stop();
+	thread.join();
+	std::filesystem::remove( path, error );
+}
+
+TEST_CASE(FilePoller_StopsBeforeRunning)
+{
+	FilePoller poller( std::filesystem::temp_directory_path() / "FilePollerTests_Missing.ini", std::chrono::hours(1) );
+
+	// Would otherwise block for an hour
+	poller.Stop();
+	poller.Run( [] {} );
+
+	poller.Reset();
+	std::thread thread( [&] { poller.Run( [] {} ); } );
+	poller.Stop();
+	thread.join();
+}
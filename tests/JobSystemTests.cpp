@@ -0,0 +1,89 @@
+#include "TestHarness.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "../source/effects/JobSystem.h"
+
+using namespace Effects;
+
+// Lets a test hold the worker inside a job
+class Gate
+{
+public:
+	void Open()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_open = true;
+		}
+		m_cv.notify_all();
+	}
+
+	// Returns false on timeout, so a broken job system fails the test instead of hanging it
+	bool Wait()
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		return m_cv.wait_for( lock, std::chrono::seconds(10), [this] { return m_open; } );
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_open = false;
+};
+
+TEST_CASE(JobSystem_RunsJobsInOrder)
+{
+	constexpr int NUM_JOBS = 32;
+
+	std::atomic<int> next { 0 };
+	std::atomic<int> numOutOfOrder { 0 };
+	Gate done;
+	{
+		JobSystem jobs;
+		for ( int i = 0; i < NUM_JOBS; i++ )
+		{
+			CHECK( jobs.Submit( [&, i] {
+				if ( next.fetch_add( 1 ) != i ) numOutOfOrder++;
+				if ( i == NUM_JOBS - 1 ) done.Open();
+			} ) );
+		}
+		CHECK( done.Wait() );
+		CHECK( jobs.GetDroppedJobs() == 0 );
+	}
+	CHECK( next.load() == NUM_JOBS );
+	CHECK( numOutOfOrder.load() == 0 );
+}
+
+TEST_CASE(JobSystem_DropsJobsWhenFull)
+{
+	Gate started, release;
+	std::atomic<int> numRun { 0 };
+	{
+		JobSystem jobs;
+		CHECK( jobs.Submit( [&] { started.Open(); release.Wait(); } ) );
+		CHECK( started.Wait() );
+
+		// The worker is busy, so the queue fills up
+		for ( size_t i = 0; i < JobSystem::MAX_QUEUED_JOBS; i++ )
+		{
+			CHECK( jobs.Submit( [&] { numRun++; } ) );
+		}
+		CHECK( !jobs.Submit( [&] { numRun++; } ) );
+		CHECK( !jobs.Submit( [&] { numRun++; } ) );
+		CHECK( jobs.GetDroppedJobs() == 2 );
+
+		// Destruction waits for the running job and drops the queued ones
+		release.Open();
+	}
+	CHECK( numRun.load() <= static_cast<int>(JobSystem::MAX_QUEUED_JOBS) );
+}
+
+TEST_CASE(JobSystem_DestroysWithoutJobs)
+{
+	JobSystem jobs;
+	CHECK( jobs.GetDroppedJobs() == 0 );
+}
@@ -0,0 +1,103 @@
+#include "TestHarness.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "../source/effects/LockFreeQueue.h"
+
+using namespace Effects;
+
+TEST_CASE(LockFreeQueue_IsFirstInFirstOut)
+{
+	LockFreeQueue<int, 8> queue;
+
+	int value = -1;
+	CHECK( !queue.TryPop( value ) );
+
+	// Wraps around the cells a few times
+	for ( int round = 0; round < 4; round++ )
+	{
+		for ( int i = 0; i < 5; i++ )
+		{
+			CHECK( queue.TryPush( round * 10 + i ) );
+		}
+		for ( int i = 0; i < 5; i++ )
+		{
+			CHECK( queue.TryPop( value ) );
+			CHECK( value == round * 10 + i );
+		}
+		CHECK( !queue.TryPop( value ) );
+	}
+}
+
+TEST_CASE(LockFreeQueue_FailsWhenFull)
+{
+	LockFreeQueue<int, 4> queue;
+	for ( int i = 0; i < 4; i++ )
+	{
+		CHECK( queue.TryPush( int(i) ) );
+	}
+	CHECK( !queue.TryPush( 4 ) );
+
+	int value = -1;
+	CHECK( queue.TryPop( value ) );
+	CHECK( value == 0 );
+	CHECK( queue.TryPush( 4 ) );
+	CHECK( !queue.TryPush( 5 ) );
+}
+
+TEST_CASE(LockFreeQueue_DeliversEachValueOnceAcrossThreads)
+{
+	constexpr uint32_t NUM_PRODUCERS = 4;
+	constexpr uint32_t NUM_CONSUMERS = 4;
+	constexpr uint32_t VALUES_PER_PRODUCER = 50000;
+
+	LockFreeQueue<uint32_t, 64> queue;
+	std::vector<std::atomic<uint32_t>> received( NUM_PRODUCERS * VALUES_PER_PRODUCER );
+	std::atomic<uint32_t> numReceived { 0 };
+
+	std::vector<std::thread> threads;
+	for ( uint32_t producer = 0; producer < NUM_PRODUCERS; producer++ )
+	{
+		threads.emplace_back( [&, producer] {
+			for ( uint32_t i = 0; i < VALUES_PER_PRODUCER; i++ )
+			{
+				while ( !queue.TryPush( producer * VALUES_PER_PRODUCER + i ) )
+				{
+					std::this_thread::yield();
+				}
+			}
+		} );
+	}
+	for ( uint32_t consumer = 0; consumer < NUM_CONSUMERS; consumer++ )
+	{
+		threads.emplace_back( [&] {
+			uint32_t value;
+			while ( numReceived.load() < received.size() )
+			{
+				if ( queue.TryPop( value ) )
+				{
+					received[value].fetch_add( 1 );
+					numReceived.fetch_add( 1 );
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		} );
+	}
+	for ( std::thread& thread : threads )
+	{
+		thread.join();
+	}
+
+	uint32_t numWrong = 0;
+	for ( const std::atomic<uint32_t>& count : received )
+	{
+		if ( count.load() != 1 ) numWrong++;
+	}
+	CHECK( numWrong == 0 );
+}
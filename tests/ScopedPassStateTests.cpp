@@ -0,0 +1,253 @@
+#include "TestHarness.h"
+
+// Runs passes on the software rasterizer, so only on Windows
+#if defined(_WIN32)
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "../source/effects/ScopedPassState.h"
+
+using namespace Effects;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+
+constexpr UINT TEXTURE_SIZE = 16;
+
+// Game bindings on a WARP context, mirrored into a shadow state the way the context wrapper does it
+struct GameState
+{
+	ComPtr<ID3D11Device> m_device;
+	ComPtr<ID3D11DeviceContext> m_context;
+	ShadowState m_shadowState;
+
+	ComPtr<ID3D11Texture2D> m_renderTargetTextures[3];
+	ComPtr<ID3D11RenderTargetView> m_renderTargets[3];
+	ComPtr<ID3D11DepthStencilView> m_depthStencil;
+	ComPtr<ID3D11ShaderResourceView> m_shaderResource;
+	ComPtr<ID3D11Buffer> m_constantBuffer;
+	ComPtr<ID3D11SamplerState> m_sampler;
+	ComPtr<ID3D11RasterizerState> m_rasterizerState;
+
+	bool Create();
+	void Bind();
+	void CheckBound();
+};
+
+ComPtr<ID3D11Texture2D> CreateTexture( ID3D11Device* device, DXGI_FORMAT format, UINT bindFlags )
+{
+	D3D11_TEXTURE2D_DESC desc {};
+	desc.Width = desc.Height = TEXTURE_SIZE;
+	desc.MipLevels = desc.ArraySize = 1;
+	desc.Format = format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = bindFlags;
+
+	ComPtr<ID3D11Texture2D> texture;
+	device->CreateTexture2D( &desc, nullptr, texture.GetAddressOf() );
+	return texture;
+}
+
+ComPtr<ID3D11Buffer> CreateConstantBuffer( ID3D11Device* device )
+{
+	D3D11_BUFFER_DESC desc {};
+	desc.ByteWidth = 16;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	ComPtr<ID3D11Buffer> buffer;
+	device->CreateBuffer( &desc, nullptr, buffer.GetAddressOf() );
+	return buffer;
+}
+
+ComPtr<ID3D11SamplerState> CreateSampler( ID3D11Device* device, D3D11_FILTER filter )
+{
+	D3D11_SAMPLER_DESC desc {};
+	desc.Filter = filter;
+	desc.AddressU = desc.AddressV = desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	desc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	ComPtr<ID3D11SamplerState> sampler;
+	device->CreateSamplerState( &desc, sampler.GetAddressOf() );
+	return sampler;
+}
+
+ComPtr<ID3D11RasterizerState> CreateRasterizerState( ID3D11Device* device, D3D11_CULL_MODE cullMode )
+{
+	D3D11_RASTERIZER_DESC desc {};
+	desc.FillMode = D3D11_FILL_SOLID;
+	desc.CullMode = cullMode;
+	desc.DepthClipEnable = TRUE;
+
+	ComPtr<ID3D11RasterizerState> rasterizerState;
+	device->CreateRasterizerState( &desc, rasterizerState.GetAddressOf() );
+	return rasterizerState;
+}
+
+bool GameState::Create()
+{
+	if ( FAILED(D3D11CreateDevice( nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION,
+			m_device.GetAddressOf(), nullptr, m_context.GetAddressOf() )) ) return false;
+
+	for ( size_t i = 0; i < _countof(m_renderTargets); i++ )
+	{
+		m_renderTargetTextures[i] = CreateTexture( m_device.Get(), DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_RENDER_TARGET|D3D11_BIND_SHADER_RESOURCE );
+		if ( m_renderTargetTextures[i] == nullptr ||
+			FAILED(m_device->CreateRenderTargetView( m_renderTargetTextures[i].Get(), nullptr, m_renderTargets[i].GetAddressOf() )) ) return false;
+	}
+
+	const ComPtr<ID3D11Texture2D> depthTexture = CreateTexture( m_device.Get(), DXGI_FORMAT_D24_UNORM_S8_UINT, D3D11_BIND_DEPTH_STENCIL );
+	const ComPtr<ID3D11Texture2D> inputTexture = CreateTexture( m_device.Get(), DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_SHADER_RESOURCE );
+	if ( depthTexture == nullptr || inputTexture == nullptr ||
+		FAILED(m_device->CreateDepthStencilView( depthTexture.Get(), nullptr, m_depthStencil.GetAddressOf() )) ||
+		FAILED(m_device->CreateShaderResourceView( inputTexture.Get(), nullptr, m_shaderResource.GetAddressOf() )) ) return false;
+
+	m_constantBuffer = CreateConstantBuffer( m_device.Get() );
+	m_sampler = CreateSampler( m_device.Get(), D3D11_FILTER_MIN_MAG_MIP_POINT );
+	m_rasterizerState = CreateRasterizerState( m_device.Get(), D3D11_CULL_BACK );
+	return m_constantBuffer != nullptr && m_sampler != nullptr && m_rasterizerState != nullptr;
+}
+
+void GameState::Bind()
+{
+	ID3D11RenderTargetView* const renderTargets[] = { m_renderTargets[0].Get(), m_renderTargets[1].Get(), m_renderTargets[2].Get() };
+	m_context->OMSetRenderTargets( _countof(renderTargets), renderTargets, m_depthStencil.Get() );
+	m_shadowState.OnOMSetRenderTargets( _countof(renderTargets), renderTargets, m_depthStencil.Get() );
+
+	m_context->PSSetShaderResources( 0, 1, m_shaderResource.GetAddressOf() );
+	m_shadowState.OnPSSetShaderResources( 0, 1, m_shaderResource.GetAddressOf() );
+
+	m_context->PSSetConstantBuffers( 1, 1, m_constantBuffer.GetAddressOf() );
+	m_shadowState.OnPSSetConstantBuffers( 1, 1, m_constantBuffer.GetAddressOf() );
+
+	m_context->PSSetSamplers( 0, 1, m_sampler.GetAddressOf() );
+	m_shadowState.OnPSSetSamplers( 0, 1, m_sampler.GetAddressOf() );
+
+	m_context->RSSetState( m_rasterizerState.Get() );
+	m_shadowState.OnRSSetState( m_rasterizerState.Get() );
+}
+
+// Reads the bindings back from the runtime, not from the shadow state
+void GameState::CheckBound()
+{
+	ComPtr<ID3D11RenderTargetView> renderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+	ComPtr<ID3D11DepthStencilView> depthStencil;
+	{
+		ID3D11RenderTargetView* views[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+		m_context->OMGetRenderTargets( _countof(views), views, depthStencil.GetAddressOf() );
+		for ( size_t i = 0; i < _countof(views); i++ )
+		{
+			renderTargets[i].Attach( views[i] );
+		}
+	}
+	for ( size_t i = 0; i < _countof(renderTargets); i++ )
+	{
+		CHECK( renderTargets[i] == (i < _countof(m_renderTargets) ? m_renderTargets[i] : nullptr) );
+	}
+	CHECK( depthStencil == m_depthStencil );
+
+	ComPtr<ID3D11ShaderResourceView> shaderResource;
+	m_context->PSGetShaderResources( 0, 1, shaderResource.GetAddressOf() );
+	CHECK( shaderResource == m_shaderResource );
+
+	ComPtr<ID3D11Buffer> constantBuffer;
+	m_context->PSGetConstantBuffers( 1, 1, constantBuffer.GetAddressOf() );
+	CHECK( constantBuffer == m_constantBuffer );
+
+	ComPtr<ID3D11SamplerState> sampler;
+	m_context->PSGetSamplers( 0, 1, sampler.GetAddressOf() );
+	CHECK( sampler == m_sampler );
+
+	ComPtr<ID3D11RasterizerState> rasterizerState;
+	m_context->RSGetState( rasterizerState.GetAddressOf() );
+	CHECK( rasterizerState == m_rasterizerState );
+}
+
+}
+
+TEST_CASE(ScopedPassState_RestoresAllRenderTargets)
+{
+	GameState game;
+	const bool created = game.Create();
+	CHECK( created );
+	if ( !created ) return;
+	game.Bind();
+
+	const ComPtr<ID3D11Texture2D> passTexture = CreateTexture( game.m_device.Get(), DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_RENDER_TARGET );
+	ComPtr<ID3D11RenderTargetView> passRenderTarget;
+	game.m_device->CreateRenderTargetView( passTexture.Get(), nullptr, passRenderTarget.GetAddressOf() );
+	{
+		ScopedPassState passState( game.m_context.Get(), game.m_shadowState );
+		passState.SetRenderTarget( passRenderTarget.Get(), nullptr );
+
+		// Pass only has its own target bound
+		ID3D11RenderTargetView* views[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+		ID3D11DepthStencilView* depthStencil;
+		game.m_context->OMGetRenderTargets( _countof(views), views, &depthStencil );
+		CHECK( views[0] == passRenderTarget.Get() && views[1] == nullptr && views[2] == nullptr && depthStencil == nullptr );
+		for ( ID3D11RenderTargetView* view : views )
+		{
+			if ( view != nullptr ) view->Release();
+		}
+	}
+	game.CheckBound();
+}
+
+TEST_CASE(ScopedPassState_RestoresAfterReadingGameRenderTarget)
+{
+	GameState game;
+	const bool created = game.Create();
+	CHECK( created );
+	if ( !created ) return;
+	game.Bind();
+
+	// The usual case - a pass reads a game render target and writes to its own one
+	ComPtr<ID3D11ShaderResourceView> gameTargetView;
+	game.m_device->CreateShaderResourceView( game.m_renderTargetTextures[1].Get(), nullptr, gameTargetView.GetAddressOf() );
+	const ComPtr<ID3D11Texture2D> passTexture = CreateTexture( game.m_device.Get(), DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_RENDER_TARGET );
+	ComPtr<ID3D11RenderTargetView> passRenderTarget;
+	game.m_device->CreateRenderTargetView( passTexture.Get(), nullptr, passRenderTarget.GetAddressOf() );
+	{
+		ScopedPassState passState( game.m_context.Get(), game.m_shadowState );
+		passState.SetRenderTarget( passRenderTarget.Get(), nullptr );
+		passState.SetShaderResource( 0, gameTargetView.Get() );
+
+		ComPtr<ID3D11ShaderResourceView> boundView;
+		game.m_context->PSGetShaderResources( 0, 1, boundView.GetAddressOf() );
+		CHECK( boundView == gameTargetView );
+	}
+	game.CheckBound();
+}
+
+TEST_CASE(ScopedPassState_RestoresPipelineState)
+{
+	GameState game;
+	const bool created = game.Create();
+	CHECK( created );
+	if ( !created ) return;
+	game.Bind();
+
+	const ComPtr<ID3D11Buffer> passConstantBuffer = CreateConstantBuffer( game.m_device.Get() );
+	const ComPtr<ID3D11SamplerState> passSampler = CreateSampler( game.m_device.Get(), D3D11_FILTER_MIN_MAG_MIP_LINEAR );
+	const ComPtr<ID3D11RasterizerState> passRasterizerState = CreateRasterizerState( game.m_device.Get(), D3D11_CULL_NONE );
+	{
+		ScopedPassState passState( game.m_context.Get(), game.m_shadowState );
+		passState.SetConstantBuffer( 1, passConstantBuffer.Get() );
+		passState.SetSampler( 0, passSampler.Get() );
+		passState.SetRasterizerState( passRasterizerState.Get() );
+		passState.SetShaderResource( 0, nullptr );
+
+		ComPtr<ID3D11Buffer> constantBuffer;
+		game.m_context->PSGetConstantBuffers( 1, 1, constantBuffer.GetAddressOf() );
+		CHECK( constantBuffer == passConstantBuffer );
+	}
+
+	// Render targets weren't touched by the pass, so they must still be bound as they were
+	game.CheckBound();
+}
+
+#endif
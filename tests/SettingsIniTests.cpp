@@ -0,0 +1,204 @@
+#include "TestHarness.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string>
+#include <string_view>
+
+#include "../source/effects/SettingsIni.h"
+
+using namespace Effects;
+
+// Decodes a value the way GetPrivateProfileStructW does, including the checksum
+static bool DecodeStruct( std::string_view encoded, void* data, size_t size )
+{
+	if ( encoded.size() != (size + 1) * 2 ) return false;
+
+	auto fromHex = []( char c ) -> int {
+		if ( c >= '0' && c <= '9' ) return c - '0';
+		if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+		return -1;
+	};
+
+	uint8_t* bytes = static_cast<uint8_t*>(data);
+	uint8_t checksum = 0;
+	for ( size_t i = 0; i <= size; i++ )
+	{
+		const int high = fromHex( encoded[i * 2] );
+		const int low = fromHex( encoded[i * 2 + 1] );
+		if ( high < 0 || low < 0 ) return false;
+
+		const uint8_t byte = static_cast<uint8_t>((high << 4) | low);
+		if ( i == size ) return byte == checksum;
+
+		bytes[i] = byte;
+		checksum += byte;
+	}
+	return false;
+}
+
+// Returns the value of a key written by SetValue, sets found to false if the key isn't in the section
+static std::string_view GetValue( std::string_view ini, std::string_view section, std::string_view key, bool& found )
+{
+	const std::string header = "[" + std::string(section) + "]";
+	found = false;
+
+	size_t pos = ini.find( header );
+	if ( pos == std::string_view::npos ) return {};
+
+	const size_t sectionEnd = ini.find( "\n[", pos );
+	const std::string entry = "\n" + std::string(key) + "=";
+	pos = ini.find( entry, pos );
+	if ( pos == std::string_view::npos || pos > sectionEnd ) return {};
+
+	const size_t valueStart = pos + entry.size();
+	size_t valueEnd = ini.find_first_of( "\r\n", valueStart );
+	if ( valueEnd == std::string_view::npos ) valueEnd = ini.size();
+
+	found = true;
+	return ini.substr( valueStart, valueEnd - valueStart );
+}
+
+TEST_CASE(SettingsIni_EncodeStructRoundTrips)
+{
+	const float values[4] = { 0.85f, -0.25f, 1.0e-7f, 1234.5f };
+	const std::string encoded = Ini::EncodeStruct( values, sizeof(values) );
+	CHECK( encoded.size() == (sizeof(values) + 1) * 2 );
+
+	float decoded[4] {};
+	CHECK( DecodeStruct( encoded, decoded, sizeof(decoded) ) );
+	CHECK( memcmp( values, decoded, sizeof(values) ) == 0 );
+
+	// Known output of WritePrivateProfileStructW
+	const uint8_t bytes[] = { 0x00, 0x7F, 0xFF };
+	CHECK( Ini::EncodeStruct( bytes, sizeof(bytes) ) == "007FFF7E" );
+	CHECK( Ini::EncodeStruct( nullptr, 0 ) == "00" );
+}
+
+TEST_CASE(SettingsIni_SetValueReplacesAndAppends)
+{
+	std::string ini =
+		"; Comment\r\n"
+		"[basic]\r\n"
+		"bloomstyle = 0\r\n"
+		"Other=Kept\r\n"
+		"\r\n"
+		"[Advanced]\r\n"
+		"UseLUT=1";
+
+	// Existing key, matched case-insensitively, keeps its line ending
+	Ini::SetValue( ini, "Basic", "BloomStyle", "1" );
+	CHECK( ini.find( "bloomstyle =1\r\nOther=Kept\r\n" ) != std::string::npos );
+
+	// New key goes after the last entry of its section, not after the blank line
+	Ini::SetValue( ini, "Basic", "LightingStyle", "2" );
+	CHECK( ini.find( "Other=Kept\r\nLightingStyle=2\r\n\r\n[Advanced]" ) != std::string::npos );
+
+	// Last line has no line break
+	Ini::SetValue( ini, "Advanced", "Vignette", "00" );
+	CHECK( ini.find( "UseLUT=1\r\nVignette=00\r\n" ) != std::string::npos );
+
+	// New section
+	Ini::SetValue( ini, "Shaders", "Key", "Value" );
+	CHECK( ini.find( "Vignette=00\r\n[Shaders]\r\nKey=Value\r\n" ) != std::string::npos );
+	CHECK( ini.find( "; Comment\r\n" ) == 0 );
+
+	// Setting the same values again changes nothing
+	const std::string before = ini;
+	Ini::SetValue( ini, "Basic", "BloomStyle", "1" );
+	Ini::SetValue( ini, "Shaders", "Key", "Value" );
+	CHECK( ini == before );
+
+	// Files with Unix line breaks keep them
+	std::string unixIni = "[Basic]\nBloomStyle=0\n";
+	Ini::SetValue( unixIni, "Basic", "LightingStyle", "1" );
+	CHECK( unixIni == "[Basic]\nBloomStyle=0\nLightingStyle=1\n" );
+}
+
+TEST_CASE(SettingsIni_WriteSettingsRoundTrips)
+{
+	Settings settings {};
+	settings.isShown = true;
+	settings.colorGradingEnabled = true;
+	settings.bloomType = 1;
+	settings.lightingType = 2;
+	settings.colorGradingLut = false;
+	settings.filterRedundantState = true;
+	for ( size_t i = 0; i < 5; i++ )
+	{
+		for ( size_t j = 0; j < 4; j++ )
+		{
+			settings.colorGradingAttributes[i][j] = 0.1f * i + 0.37f * j;
+		}
+	}
+
+	const std::string userIni = "[Shaders]\nf3896ba8-4f0671da-a690e62a-c9168288=None\n[Basic]\nBloomStyle=0\n";
+	const std::string ini = Ini::WriteSettings( userIni, settings );
+
+	// Keys we don't own are preserved
+	CHECK( ini.find( "[Shaders]\nf3896ba8-4f0671da-a690e62a-c9168288=None\n" ) == 0 );
+
+	bool found = false;
+	CHECK( GetValue( ini, "Basic", "EnableColorGrading", found ) == "1" && found );
+	CHECK( GetValue( ini, "Basic", "BloomStyle", found ) == "1" && found );
+	CHECK( GetValue( ini, "Basic", "LightingStyle", found ) == "2" && found );
+	CHECK( GetValue( ini, "Advanced", "UseLUT", found ) == "0" && found );
+	CHECK( GetValue( ini, "Advanced", "FilterRedundantState", found ) == "1" && found );
+
+	// isShown doesn't save
+	CHECK( ini.find( "isShown" ) == std::string::npos );
+
+	Settings decoded {};
+	const char* const structKeys[] = { "Attribs", "Color1", "Color2", "Color3" };
+	for ( size_t i = 0; i < 4; i++ )
+	{
+		CHECK( DecodeStruct( GetValue( ini, "Advanced", structKeys[i], found ), decoded.colorGradingAttributes[i], sizeof(float) * 3 ) );
+	}
+	CHECK( DecodeStruct( GetValue( ini, "Advanced", "Vignette", found ), decoded.colorGradingAttributes[4], sizeof(float) * 4 ) );
+	for ( size_t i = 0; i < 4; i++ )
+	{
+		CHECK( memcmp( decoded.colorGradingAttributes[i], settings.colorGradingAttributes[i], sizeof(float) * 3 ) == 0 );
+	}
+	CHECK( memcmp( decoded.colorGradingAttributes[4], settings.colorGradingAttributes[4], sizeof(float) * 4 ) == 0 );
+
+	// Writing over our own output only changes what changed
+	settings.bloomType = 0;
+	const std::string rewritten = Ini::WriteSettings( ini, settings );
+	CHECK( rewritten.size() == ini.size() );
+	CHECK( GetValue( rewritten, "Basic", "BloomStyle", found ) == "0" && found );
+	CHECK( Ini::WriteSettings( rewritten, settings ) == rewritten );
+}
+
+TEST_CASE(Settings_CompareFieldByField)
+{
+	// Different padding bytes must not make equal settings differ
+	alignas(Settings) unsigned char lhsStorage[sizeof(Settings)];
+	alignas(Settings) unsigned char rhsStorage[sizeof(Settings)];
+	memset( lhsStorage, 0x00, sizeof(lhsStorage) );
+	memset( rhsStorage, 0xCD, sizeof(rhsStorage) );
+	Settings& lhs = *new (lhsStorage) Settings {};
+	Settings& rhs = *new (rhsStorage) Settings {};
+	lhs.colorGradingEnabled = rhs.colorGradingEnabled = true;
+	lhs.bloomType = rhs.bloomType = 1;
+	lhs.lightingType = rhs.lightingType = 2;
+	lhs.colorGradingLut = rhs.colorGradingLut = false;
+	lhs.filterRedundantState = rhs.filterRedundantState = true;
+	CHECK( lhs == rhs );
+
+	// A NaN read from a broken INI still equals itself
+	lhs.colorGradingAttributes[2][1] = rhs.colorGradingAttributes[2][1] = std::numeric_limits<float>::quiet_NaN();
+	CHECK( lhs == rhs );
+
+	Settings other = lhs;
+	CHECK( other == lhs );
+	other.isShown = !lhs.isShown;
+	CHECK( other != lhs );
+	other = lhs;
+	other.colorGradingAttributes[4][3] = 0.5f;
+	CHECK( other != lhs );
+	other = lhs;
+	other.lightingType = 0;
+	CHECK( other != lhs );
+}
@@ -0,0 +1,81 @@
+#include "TestHarness.h"
+
+#include <string_view>
+
+#include "../source/effects/ShaderManifest.h"
+
+using namespace Effects;
+
+static constexpr std::string_view HASH = "f3896ba8-4f0671da-a690e62a-c9168288";
+
+TEST_CASE(ShaderManifest_ParsesEntry)
+{
+	constexpr std::string_view text =
+		"; Bloom merger\n"
+		"[f3896ba8-4f0671da-a690e62a-c9168288]\n"
+		"shader = bloom_merger_ps.cso   ; Relative to the manifest\r\n"
+		"cb3 = 1.5, 0.0 -2 .25\n"
+		"cb3_size = 40\n"
+		"srv0 = 2\n";
+
+	ShaderManifest manifest;
+	CHECK( manifest.Parse( text ) == 0 );
+
+	ShaderHash hash;
+	CHECK( ParseShaderHash( HASH, hash ) );
+	const ShaderManifestEntry* entry = manifest.Find( hash );
+	CHECK( entry != nullptr );
+	if ( entry == nullptr ) return;
+
+	CHECK( entry->m_shaderPath == "bloom_merger_ps.cso" );
+	CHECK( entry->m_shaderResourceRemap[0] == 2 );
+	CHECK( entry->m_shaderResourceRemap[1] == ShaderManifestEntry::KEEP_SLOT );
+	CHECK( entry->HasBindingChanges() );
+
+	CHECK( entry->m_numConstantBuffers == 1 );
+	const ShaderManifestEntry::ConstantBuffer& cb = manifest.GetConstantBuffers()[entry->m_firstConstantBuffer];
+	CHECK( cb.m_slot == 3 );
+	CHECK( cb.m_size == 48 );
+	CHECK( cb.m_numValues == 4 );
+	CHECK( manifest.GetValues()[cb.m_firstValue + 2] == -2.0f );
+}
+
+TEST_CASE(ShaderManifest_KeepsHashInValues)
+{
+	constexpr std::string_view text =
+		"[f3896ba8-4f0671da-a690e62a-c9168288]\n"
+		"shader = shaders#2/merger;v2.cso # Comment after whitespace\n"
+		"#srv0 = 1\n"
+		"\t;srv1 = 1\n";
+
+	ShaderManifest manifest;
+	CHECK( manifest.Parse( text ) == 0 );
+	CHECK( manifest.GetEntries().size() == 1 );
+	if ( manifest.GetEntries().empty() ) return;
+
+	const ShaderManifestEntry& entry = manifest.GetEntries()[0];
+	CHECK( entry.m_shaderPath == "shaders#2/merger;v2.cso" );
+	CHECK( !entry.HasBindingChanges() );
+}
+
+TEST_CASE(ShaderManifest_SkipsMalformedLines)
+{
+	constexpr std::string_view text =
+		"shader = outside_a_section.cso\n"
+		"[not a hash]\n"
+		"shader = skipped_with_the_section.cso\n"
+		"[f3896ba8-4f0671da-a690e62a-c9168288]\n"
+		"shader = merger.cso\n"
+		"cb6 = 1.0\n"
+		"cb0 = 1.0 nan\n"
+		"srv0 = 4\n"
+		"unknown = 1\n"
+		"[00000000-00000000-00000000-00000001]\n"
+		"srv0 = 1\n";
+
+	ShaderManifest manifest;
+	CHECK( manifest.Parse( text ) == 8 );
+	CHECK( manifest.GetEntries().size() == 1 );
+	CHECK( manifest.GetConstantBuffers().empty() );
+	CHECK( manifest.GetValues().empty() );
+}
@@ -0,0 +1,101 @@
+#include "TestHarness.h"
+
+#include "../source/effects/ShadowState.h"
+
+using namespace Effects;
+
+// Objects are never dereferenced, so any distinct addresses will do
+template<typename T>
+static T* FakeObject( uintptr_t id )
+{
+	return reinterpret_cast<T*>(id * 16);
+}
+
+TEST_CASE(ShadowState_TracksAllRenderTargets)
+{
+	ShadowState shadowState;
+
+	ID3D11RenderTargetView* const renderTargets[] = { FakeObject<ID3D11RenderTargetView>(1), nullptr, FakeObject<ID3D11RenderTargetView>(3) };
+	ID3D11DepthStencilView* const depthStencil = FakeObject<ID3D11DepthStencilView>(4);
+	shadowState.OnOMSetRenderTargets( 3, renderTargets, depthStencil );
+
+	const ShadowState::State& state = shadowState.Get();
+	CHECK( state.m_renderTargets[0] == renderTargets[0] );
+	CHECK( state.m_renderTargets[1] == nullptr );
+	CHECK( state.m_renderTargets[2] == renderTargets[2] );
+	for ( uint32_t i = 3; i < ShadowState::NUM_RENDER_TARGETS; i++ )
+	{
+		CHECK( state.m_renderTargets[i] == nullptr );
+	}
+	CHECK( state.m_depthStencil == depthStencil );
+}
+
+TEST_CASE(ShadowState_FewerRenderTargetsUnbindTheRest)
+{
+	ShadowState shadowState;
+
+	ID3D11RenderTargetView* renderTargets[ShadowState::NUM_RENDER_TARGETS];
+	for ( uint32_t i = 0; i < ShadowState::NUM_RENDER_TARGETS; i++ )
+	{
+		renderTargets[i] = FakeObject<ID3D11RenderTargetView>(i + 1);
+	}
+	shadowState.OnOMSetRenderTargets( ShadowState::NUM_RENDER_TARGETS, renderTargets, nullptr );
+	CHECK( shadowState.Get().m_renderTargets[ShadowState::NUM_RENDER_TARGETS - 1] == renderTargets[ShadowState::NUM_RENDER_TARGETS - 1] );
+
+	shadowState.OnOMSetRenderTargets( 1, renderTargets, nullptr );
+	CHECK( shadowState.Get().m_renderTargets[0] == renderTargets[0] );
+	for ( uint32_t i = 1; i < ShadowState::NUM_RENDER_TARGETS; i++ )
+	{
+		CHECK( shadowState.Get().m_renderTargets[i] == nullptr );
+	}
+
+	// No views at all, or a null array
+	shadowState.OnOMSetRenderTargets( 0, nullptr, nullptr );
+	CHECK( shadowState.Get().m_renderTargets[0] == nullptr );
+	shadowState.OnOMSetRenderTargets( 2, nullptr, nullptr );
+	CHECK( shadowState.Get().m_renderTargets[0] == nullptr && shadowState.Get().m_renderTargets[1] == nullptr );
+}
+
+TEST_CASE(ShadowState_KeepRenderTargets)
+{
+	ShadowState shadowState;
+
+	ID3D11RenderTargetView* const renderTargets[] = { FakeObject<ID3D11RenderTargetView>(1), FakeObject<ID3D11RenderTargetView>(2) };
+	ID3D11DepthStencilView* const depthStencil = FakeObject<ID3D11DepthStencilView>(3);
+	shadowState.OnOMSetRenderTargets( 2, renderTargets, depthStencil );
+
+	// OMSetRenderTargetsAndUnorderedAccessViews only changing UAVs
+	shadowState.OnOMSetRenderTargets( ShadowState::KEEP_RENDER_TARGETS, nullptr, nullptr );
+	CHECK( shadowState.Get().m_renderTargets[0] == renderTargets[0] );
+	CHECK( shadowState.Get().m_renderTargets[1] == renderTargets[1] );
+	CHECK( shadowState.Get().m_depthStencil == depthStencil );
+}
+
+TEST_CASE(ShadowState_ClearStateUnbindsRenderTargets)
+{
+	ShadowState shadowState;
+
+	ID3D11RenderTargetView* const renderTargets[] = { FakeObject<ID3D11RenderTargetView>(1), FakeObject<ID3D11RenderTargetView>(2) };
+	shadowState.OnOMSetRenderTargets( 2, renderTargets, FakeObject<ID3D11DepthStencilView>(3) );
+	shadowState.OnClearState();
+
+	for ( ID3D11RenderTargetView* renderTarget : shadowState.Get().m_renderTargets )
+	{
+		CHECK( renderTarget == nullptr );
+	}
+	CHECK( shadowState.Get().m_depthStencil == nullptr );
+}
+
+TEST_CASE(ShadowState_OutputBindingsInvalidateShaderResources)
+{
+	ShadowState shadowState;
+
+	ID3D11ShaderResourceView* const view = FakeObject<ID3D11ShaderResourceView>(1);
+	shadowState.OnPSSetShaderResources( 0, 1, &view );
+	CHECK( shadowState.AreShaderResourcesBound( 0, 1, &view ) );
+
+	// Runtime may have unbound it, so rebinding must not be filtered
+	ID3D11RenderTargetView* const renderTarget = FakeObject<ID3D11RenderTargetView>(2);
+	shadowState.OnOMSetRenderTargets( 1, &renderTarget, nullptr );
+	CHECK( !shadowState.AreShaderResourcesBound( 0, 1, &view ) );
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+// Minimal self-registering test runner, so tests build with nothing but the standard library.
+// Every test case is a function registered with TEST_CASE, failed checks are reported and the test carries on
+namespace Tests
+{
+
+struct TestCase
+{
+	const char* m_name;
+	void (*m_function)();
+};
+
+std::vector<TestCase>& GetTestCases();
+
+// Thread-safe, checks may fail on worker threads
+void ReportFailure( const char* file, int line, const char* expression );
+
+struct TestRegistrar
+{
+	TestRegistrar( const char* name, void (*function)() )
+	{
+		GetTestCases().push_back( { name, function } );
+	}
+};
+
+};
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static const Tests::TestRegistrar name##Registrar( #name, &name ); \
+	static void name()
+
+#define CHECK(expression) ((expression) ? (void)0 : Tests::ReportFailure( __FILE__, __LINE__, #expression ))
+#define CHECK_NEAR(value, expected, tolerance) CHECK( std::abs( (value) - (expected) ) <= (tolerance) )
@@ -0,0 +1,50 @@
+#include "TestHarness.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+static std::atomic<unsigned int> numFailures { 0 };
+static std::mutex outputMutex;
+
+std::vector<Tests::TestCase>& Tests::GetTestCases()
+{
+	// Function local, so registrars in other translation units never see it uninitialized
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+void Tests::ReportFailure(const char* file, int line, const char* expression)
+{
+	numFailures++;
+
+	std::lock_guard lock( outputMutex );
+	fprintf( stderr, "%s(%d): check failed: %s\n", file, line, expression );
+}
+
+// Runs all tests, or only those with names containing the first argument
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+
+	unsigned int numRun = 0, numFailed = 0;
+	for ( const Tests::TestCase& test : Tests::GetTestCases() )
+	{
+		if ( filter != nullptr && strstr( test.m_name, filter ) == nullptr ) continue;
+
+		const unsigned int failuresBefore = numFailures;
+		test.m_function();
+		numRun++;
+
+		const bool passed = numFailures == failuresBefore;
+		if ( !passed )
+		{
+			numFailed++;
+		}
+		printf( "[%s] %s\n", passed ? "PASS" : "FAIL", test.m_name );
+	}
+
+	printf( "%u of %u tests passed\n", numRun - numFailed, numRun );
+	return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include "TestHarness.h"
+
+#include "../source/effects/TimingStatistics.h"
+
+using namespace Effects;
+
+TEST_CASE(TimingStatistics_EmptyWindowHasNoSamples)
+{
+	TimingStatistics stats;
+	TimingStatistics::Summary summary = stats.GetSummary();
+	CHECK( summary.m_count == 0 );
+	CHECK( summary.m_min == 0.0 && summary.m_avg == 0.0 && summary.m_p99 == 0.0 );
+
+	stats.AddSample( 5.0 );
+	stats.Reset();
+	summary = stats.GetSummary();
+	CHECK( summary.m_count == 0 );
+	CHECK( summary.m_p99 == 0.0 );
+}
+
+TEST_CASE(TimingStatistics_SummarizesKnownSamples)
+{
+	// 1..100 in shuffled order, so sorting matters
+	TimingStatistics stats;
+	for ( int i = 0; i < 100; i++ )
+	{
+		stats.AddSample( static_cast<double>((i * 37) % 100 + 1) );
+	}
+
+	const TimingStatistics::Summary summary = stats.GetSummary();
+	CHECK( summary.m_count == 100 );
+	CHECK( summary.m_min == 1.0 );
+	CHECK_NEAR( summary.m_avg, 50.5, 1e-9 );
+	CHECK( summary.m_p99 == 99.0 ); // Nearest rank, ceil(100 * 0.99) = 99
+
+	// A single sample is its own percentile
+	TimingStatistics single;
+	single.AddSample( 2.5 );
+	const TimingStatistics::Summary singleSummary = single.GetSummary();
+	CHECK( singleSummary.m_count == 1 );
+	CHECK( singleSummary.m_min == 2.5 && singleSummary.m_avg == 2.5 && singleSummary.m_p99 == 2.5 );
+}
+
+TEST_CASE(TimingStatistics_OldestSamplesWrapAround)
+{
+	TimingStatistics stats;
+
+	// Spikes in the top 1% of a full window, ceil(240 * 0.99) = 238 puts the percentile on the first of them
+	for ( size_t i = 0; i < 3; i++ )
+	{
+		stats.AddSample( 1000.0 );
+	}
+	for ( size_t i = 0; i < TimingStatistics::NUM_SAMPLES - 3; i++ )
+	{
+		stats.AddSample( 2.0 );
+	}
+	CHECK( stats.GetSummary().m_count == TimingStatistics::NUM_SAMPLES );
+	CHECK( stats.GetSummary().m_p99 == 1000.0 );
+
+	// Overwrites the spikes, which must leave the window
+	for ( size_t i = 0; i < 3; i++ )
+	{
+		stats.AddSample( 4.0 );
+	}
+	const TimingStatistics::Summary summary = stats.GetSummary();
+	CHECK( summary.m_count == TimingStatistics::NUM_SAMPLES );
+	CHECK( summary.m_min == 2.0 );
+	CHECK( summary.m_p99 == 4.0 );
+	CHECK_NEAR( summary.m_avg, (2.0 * (TimingStatistics::NUM_SAMPLES - 3) + 4.0 * 3) / TimingStatistics::NUM_SAMPLES, 1e-9 );
+
+	// Keep going for more than a full window, only the newest samples count
+	for ( size_t i = 0; i < TimingStatistics::NUM_SAMPLES * 2 + 7; i++ )
+	{
+		stats.AddSample( 3.0 );
+	}
+	const TimingStatistics::Summary wrapped = stats.GetSummary();
+	CHECK( wrapped.m_count == TimingStatistics::NUM_SAMPLES );
+	CHECK( wrapped.m_min == 3.0 && wrapped.m_p99 == 3.0 );
+	CHECK_NEAR( wrapped.m_avg, 3.0, 1e-9 );
+}
+
+TEST_CASE(TimingStatistics_ConvertsTicks)
+{
+	CHECK_NEAR( TicksToMilliseconds( 1000, 4000, 1000000 ), 3.0, 1e-12 );
+	CHECK( TicksToMilliseconds( 4000, 1000, 1000000 ) == 0.0 );
+	CHECK( TicksToMilliseconds( 1000, 4000, 0 ) == 0.0 );
+}
@@ -0,0 +1,188 @@
+#include "TestHarness.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "../source/effects/TraceEncoding.h"
+
+using namespace Effects;
+
+static bool CallsEqual( const Call& lhs, const Call& rhs )
+{
+	if ( lhs.m_type != rhs.m_type || lhs.m_context != rhs.m_context ) return false;
+	for ( size_t i = 0; i < GetCallArgumentCount( lhs.m_type ); i++ )
+	{
+		if ( lhs.m_args[i] != rhs.m_args[i] ) return false;
+	}
+	return true;
+}
+
+TEST_CASE(TraceEncoding_CallsRoundTrip)
+{
+	// Every call type, with arguments of every varint length
+	const uint32_t values[] = { 0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0x1FFFFF, 0x200000, 0xFFFFFFF, 0x10000000, UINT32_MAX };
+
+	std::vector<Call> calls;
+	for ( size_t type = 0; type < static_cast<size_t>(CallType::NumCallTypes); type++ )
+	{
+		for ( size_t i = 0; i < std::size(values); i++ )
+		{
+			Call call { static_cast<CallType>(type), values[(i + 3) % std::size(values)] };
+			for ( size_t arg = 0; arg < GetCallArgumentCount( call.m_type ); arg++ )
+			{
+				call.m_args[arg] = values[(i + arg) % std::size(values)];
+			}
+			calls.push_back( call );
+		}
+	}
+
+	std::vector<uint8_t> stream;
+	for ( const Call& call : calls )
+	{
+		uint8_t buffer[MAX_ENCODED_CALL_SIZE];
+		const size_t size = EncodeCall( call, buffer );
+		CHECK( size >= 2 && size <= MAX_ENCODED_CALL_SIZE );
+		stream.insert( stream.end(), buffer, buffer + size );
+	}
+
+	const uint8_t* cur = stream.data();
+	const uint8_t* const end = stream.data() + stream.size();
+	for ( const Call& expected : calls )
+	{
+		Call call;
+		CHECK( DecodeCall( cur, end, call ) );
+		CHECK( CallsEqual( call, expected ) );
+	}
+	CHECK( cur == end );
+}
+
+TEST_CASE(TraceEncoding_RejectsTruncatedCalls)
+{
+	const Call call { CallType::DrawIndexedInstanced, 300, { UINT32_MAX, 0x4000, 0, 0x80, 1 } };
+
+	uint8_t buffer[MAX_ENCODED_CALL_SIZE];
+	const size_t size = EncodeCall( call, buffer );
+	CHECK( size == 15 ); // 1 + 2 + 5 + 3 + 1 + 2 + 1
+
+	// Every prefix is rejected, without consuming anything
+	for ( size_t length = 0; length < size; length++ )
+	{
+		const uint8_t* cur = buffer;
+		Call decoded;
+		CHECK( !DecodeCall( cur, buffer + length, decoded ) );
+		CHECK( cur == buffer );
+	}
+
+	const uint8_t* cur = buffer;
+	Call decoded;
+	CHECK( DecodeCall( cur, buffer + size, decoded ) );
+	CHECK( CallsEqual( decoded, call ) );
+}
+
+TEST_CASE(TraceEncoding_RejectsMalformedCalls)
+{
+	auto decodes = []( std::vector<uint8_t> data ) {
+		const uint8_t* cur = data.data();
+		Call call;
+		return DecodeCall( cur, data.data() + data.size(), call );
+	};
+
+	const uint8_t blendState = static_cast<uint8_t>(CallType::OMSetBlendState);
+
+	// Longest valid varint
+	CHECK( decodes( { blendState, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F } ) );
+
+	// Bits above 32 in the fifth byte
+	CHECK( !decodes( { blendState, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0x1F } ) );
+
+	// Varints longer than 5 bytes, even if the extra bytes carry no bits
+	CHECK( !decodes( { blendState, 0, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 } ) );
+	CHECK( !decodes( { blendState, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 } ) );
+	CHECK( !decodes( { blendState, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, 0 } ) );
+
+	// Unknown call types
+	CHECK( !decodes( { static_cast<uint8_t>(CallType::NumCallTypes), 0 } ) );
+	CHECK( !decodes( { 0xFF, 0 } ) );
+}
+
+TEST_CASE(ObjectIds_AreSequentialAndStable)
+{
+	ObjectIds ids( 16 );
+	int objects[4];
+
+	CHECK( ids.Get( nullptr ) == 0 );
+	CHECK( ids.Get( &objects[2] ) == 1 );
+	CHECK( ids.Get( &objects[0] ) == 2 );
+	CHECK( ids.Get( &objects[2] ) == 1 );
+	CHECK( ids.Get( &objects[1] ) == 3 );
+	CHECK( ids.Get( &objects[0] ) == 2 );
+
+	ids.Clear();
+	CHECK( ids.Get( &objects[3] ) == 1 );
+	CHECK( ids.Get( &objects[2] ) == 2 );
+}
+
+TEST_CASE(ObjectIds_OverflowWhenFull)
+{
+	ObjectIds ids( 4 );
+	alignas(16) char objects[6][16];
+
+	for ( size_t i = 0; i < 4; i++ )
+	{
+		CHECK( ids.Get( objects[i] ) == i + 1 );
+	}
+	CHECK( ids.Get( objects[4] ) == ObjectIds::OVERFLOW_ID );
+	CHECK( ids.Get( objects[5] ) == ObjectIds::OVERFLOW_ID );
+	CHECK( ids.Get( objects[3] ) == 4 );
+}
+
+TEST_CASE(ObjectIds_AreUniqueAcrossThreads)
+{
+	constexpr size_t NUM_THREADS = 4;
+	constexpr size_t NUM_OBJECTS = 1024;
+
+	ObjectIds ids( NUM_OBJECTS * 2 );
+	std::vector<uint64_t> objects( NUM_OBJECTS );
+
+	// Every thread sees every object, in a different order - odd strides visit all of a power of two
+	std::vector<std::vector<uint32_t>> seenIds( NUM_THREADS, std::vector<uint32_t>( NUM_OBJECTS ) );
+	std::atomic<bool> go { false };
+	std::vector<std::thread> threads;
+	for ( size_t thread = 0; thread < NUM_THREADS; thread++ )
+	{
+		threads.emplace_back( [&, thread] {
+			while ( !go.load() )
+			{
+			}
+			for ( size_t i = 0; i < NUM_OBJECTS; i++ )
+			{
+				const size_t object = (i * (thread * 2 + 1)) % NUM_OBJECTS;
+				seenIds[thread][object] = ids.Get( &objects[object] );
+			}
+		} );
+	}
+	go.store( true );
+	for ( std::thread& thread : threads )
+	{
+		thread.join();
+	}
+
+	std::vector<bool> used( NUM_OBJECTS + 1, false );
+	for ( size_t object = 0; object < NUM_OBJECTS; object++ )
+	{
+		const uint32_t id = seenIds[0][object];
+		CHECK( id >= 1 && id <= NUM_OBJECTS );
+		if ( id < 1 || id > NUM_OBJECTS ) continue;
+
+		CHECK( !used[id] );
+		used[id] = true;
+
+		for ( size_t thread = 1; thread < NUM_THREADS; thread++ )
+		{
+			CHECK( seenIds[thread][object] == id );
+		}
+	}
+}